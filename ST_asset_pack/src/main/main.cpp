@@ -11,16 +11,89 @@
 #include <string>
 #include <vector>
 #include <sstream>
+#include <chrono>
+#include <cstdint>
 
 #ifndef TESTING
 #include <ST_loaders/loaders.hpp>
 #include <ST_util/test_util.hpp>
 #endif
 
+#ifndef TESTING
+/**
+ * Converts the value of the --textures argument.
+ * @param textures "raw", "rle", "lz4" or "none".
+ * @return The matching texture packing.
+ */
+static ST::texture_packing get_texture_packing(const std::string& textures){
+    if(textures == "raw"){
+        return ST::texture_packing::RAW;
+    }else if(textures == "rle"){
+        return ST::texture_packing::RLE;
+    }else if(textures == "lz4"){
+        return ST::texture_packing::LZ4;
+    }
+    return ST::texture_packing::NONE;
+}
+
+/**
+ * Packs the given files with each compression and times how long unpacking the result takes.
+ * @param args The files to pack.
+ */
+static void run_benchmark(const std::vector<std::string>& args){
+    const std::string binary_name = "ST_asset_pack_benchmark.bin";
+    const std::vector<std::pair<std::string, uint8_t>> levels = {{"raw", 0}, {"lz4", 1}, {"zstd", 19}};
+    const std::vector<ST::pack_compression> codecs = {ST::pack_compression::NONE, ST::pack_compression::LZ4, ST::pack_compression::ZSTD};
+    for(size_t i = 0; i < levels.size(); i++){
+        const auto& level = levels[i];
+        if(!ST::is_pack_compression_supported(codecs[i])){
+            fprintf(stdout, "%s: not built in\n", level.first.c_str());
+            continue;
+        }
+        remove(binary_name.c_str());
+        if(ST::pack_to_binary(binary_name, args, level.second) != 0){
+            fprintf(stderr, "Error packing files!\n");
+            return;
+        }
+        FILE* file = fopen(binary_name.c_str(), "rb");
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fclose(file);
+
+        auto start = std::chrono::steady_clock::now();
+        ST::assets_named* assets = ST::unpack_binary(binary_name);
+        auto end = std::chrono::steady_clock::now();
+        double time = std::chrono::duration<double, std::milli>(end - start).count();
+        if(assets != nullptr){
+            for(const auto& surface : assets->surfaces){
+                SDL_FreeSurface(surface.second);
+            }
+            for(const auto& chunk : assets->chunks){
+                Mix_FreeChunk(chunk.second);
+            }
+            for(const auto& music : assets->music){
+                Mix_FreeMusic(music.second);
+            }
+            delete assets;
+        }
+        fprintf(stdout, "%s: %ld bytes, loaded in %.2f ms\n", level.first.c_str(), size, time);
+    }
+    remove(binary_name.c_str());
+}
+#endif
+
 /**
  * \mainpage A small program that will combine multiple png, wav and ogg files into a single file that can
  * then be read by the ST game engine.
- * File format version: v0.9
+ * File format version: v2 (v0.9 binaries can still be read and are upgraded when added to)
+ * Usage:
+ * -p/--pack [--level N] [--textures raw|rle|lz4] binary files... - pack files, N is 0 for no compression, 1 for LZ4
+ * (default) or up to 22 for zstd. With --textures, png files are stored pre-decoded so they can be uploaded to the GPU
+ * without decoding them at load time.
+ * -r/--rebuild [--level N] [--textures raw|rle|lz4] binary files... - make the binary contain exactly these files,
+ * files that haven't changed since they were packed are not compressed again.
+ * -u/--unpack binaries... - unpack binaries to disk.
+ * -b/--benchmark files... - compare load times of the files packed raw, with LZ4 and with zstd.
  * Maxim Atanasov
  */
 
@@ -48,21 +121,83 @@ int asset_pack_main(int argc, char *argv[]) {
          args.emplace_back(argv[i]);
      }
 
+     //Read the compression level, if given
+     uint8_t compression_level = 1;
+     for (uint64_t i = 0; i < args.size(); i++) {
+         if (args.at(i) == "--level") {
+             int level = -1;
+             if (i + 1 < args.size()) {
+                 std::stringstream s_stream(args.at(i + 1));
+                 s_stream >> level;
+                 if (s_stream.fail() || !s_stream.eof()) {
+                     level = -1;
+                 }
+             }
+             if (level < 0 || level > 22) {
+                 fprintf(stderr, "Invalid compression level!\n");
+                 return -1;
+             }
+             compression_level = static_cast<uint8_t>(level);
+             args.erase(args.begin() + static_cast<long>(i), args.begin() + static_cast<long>(i) + 2);
+             break;
+         }
+     }
+
+     //Read the texture packing, if given
+     std::string textures = "none";
+     for (uint64_t i = 0; i < args.size(); i++) {
+         if (args.at(i) == "--textures") {
+             textures = i + 1 < args.size() ? args.at(i + 1) : "";
+             if (textures != "raw" && textures != "rle" && textures != "lz4") {
+                 fprintf(stderr, "Invalid texture packing!\n");
+                 return -1;
+             }
+             args.erase(args.begin() + static_cast<long>(i), args.begin() + static_cast<long>(i) + 2);
+             break;
+         }
+     }
+     if (args.empty()) {
+         fprintf(stderr, "Not enough arguments!\n");
+         return -1;
+     }
+
      if (pack_arg == "-p" || pack_arg == "--pack") { //Pack assets to a binary
          std::string binary_name = args.at(0);
          args.erase(args.begin(), args.begin() + 1);
+         #ifdef TESTING
+         (void)compression_level;
+         (void)textures;
+         #endif
          #ifndef TESTING
-         int8_t return_code = ST::pack_to_binary(binary_name, args);
+         int8_t return_code = ST::pack_to_binary(binary_name, args, compression_level, get_texture_packing(textures));
          if(return_code == -1){
             fprintf(stderr, "Error packing files to existing binary, maybe it is corrupted!\n");
          }
          else if(return_code == -2){
              fprintf(stderr, "Error packing files to existing binary, it already contains a file named the same as one of the ones you are adding!\n");
          }
+         else if(return_code == -3){
+             fprintf(stderr, "Error packing files, two of the file names have the same hash (listed above) - rename one of them!\n");
+         }
          else if(return_code == 0)
          #endif
             fprintf(stdout, "Binary generated!\n");
      }
+     else if (pack_arg == "-r" || pack_arg == "--rebuild") { //Rebuild a binary, reusing the files that haven't changed
+         std::string binary_name = args.at(0);
+         args.erase(args.begin(), args.begin() + 1);
+         #ifndef TESTING
+         int8_t return_code = ST::rebuild_binary(binary_name, args, compression_level, get_texture_packing(textures));
+         if(return_code == -1){
+             fprintf(stderr, "Error rebuilding binary!\n");
+         }
+         else if(return_code == -3){
+             fprintf(stderr, "Error packing files, two of the file names have the same hash (listed above) - rename one of them!\n");
+         }
+         else if(return_code == 0)
+         #endif
+            fprintf(stdout, "Binary rebuilt!\n");
+     }
      else if (pack_arg == "-u" || pack_arg == "--unpack") { //Or unpack a binary to disk
          for (const auto &path : args) {
             #ifndef TESTING
@@ -77,6 +212,13 @@ int asset_pack_main(int argc, char *argv[]) {
             #endif
          }
      }
+     else if (pack_arg == "-b" || pack_arg == "--benchmark") { //Compare load times of the different compressions
+         #ifndef TESTING
+         run_benchmark(args);
+         #elif defined(TESTING)
+         fprintf(stdout, "Benchmark done!\n");
+         #endif
+     }
      else {
          fprintf(stderr, "Unknown argument!\n");
      }
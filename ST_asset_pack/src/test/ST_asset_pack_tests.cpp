@@ -88,6 +88,106 @@ TEST(ST_asset_pack_tests, test_unpack_binary_unpack){
     ASSERT_EQ("Binary unpacked!\n", output);
 }
 
+TEST(ST_asset_pack_tests, test_pack_to_binary_level){
+
+    testing::internal::CaptureStdout();
+
+    auto args = static_cast<char**>(malloc(50));
+    args[0] = const_cast<char*>("");
+    args[1] = const_cast<char*>("-p");
+    args[2] = const_cast<char*>("--level");
+    args[3] = const_cast<char*>("19");
+    args[4] = const_cast<char*>("no_asset");
+    ASSERT_EQ(0, asset_pack_main(5, args));
+    free(args);
+
+    std::string output = testing::internal::GetCapturedStdout();
+    remove("no_asset");
+    ASSERT_EQ("Binary generated!\n", output);
+}
+
+TEST(ST_asset_pack_tests, test_pack_to_binary_invalid_level){
+
+    testing::internal::CaptureStderr();
+
+    auto args = static_cast<char**>(malloc(50));
+    args[0] = const_cast<char*>("");
+    args[1] = const_cast<char*>("-p");
+    args[2] = const_cast<char*>("--level");
+    args[3] = const_cast<char*>("fast");
+    args[4] = const_cast<char*>("no_asset");
+    ASSERT_EQ(-1, asset_pack_main(5, args));
+    free(args);
+
+    std::string output = testing::internal::GetCapturedStderr();
+    ASSERT_EQ("Invalid compression level!\n", output);
+}
+
+TEST(ST_asset_pack_tests, test_pack_to_binary_textures){
+
+    testing::internal::CaptureStdout();
+
+    auto args = static_cast<char**>(malloc(50));
+    args[0] = const_cast<char*>("");
+    args[1] = const_cast<char*>("-p");
+    args[2] = const_cast<char*>("--textures");
+    args[3] = const_cast<char*>("rle");
+    args[4] = const_cast<char*>("no_asset");
+    ASSERT_EQ(0, asset_pack_main(5, args));
+    free(args);
+
+    std::string output = testing::internal::GetCapturedStdout();
+    remove("no_asset");
+    ASSERT_EQ("Binary generated!\n", output);
+}
+
+TEST(ST_asset_pack_tests, test_pack_to_binary_invalid_textures){
+
+    testing::internal::CaptureStderr();
+
+    auto args = static_cast<char**>(malloc(50));
+    args[0] = const_cast<char*>("");
+    args[1] = const_cast<char*>("-p");
+    args[2] = const_cast<char*>("--textures");
+    args[3] = const_cast<char*>("bc7");
+    args[4] = const_cast<char*>("no_asset");
+    ASSERT_EQ(-1, asset_pack_main(5, args));
+    free(args);
+
+    std::string output = testing::internal::GetCapturedStderr();
+    ASSERT_EQ("Invalid texture packing!\n", output);
+}
+
+TEST(ST_asset_pack_tests, test_rebuild_binary_r){
+
+    testing::internal::CaptureStdout();
+
+    auto args = static_cast<char**>(malloc(50));
+    args[0] = const_cast<char*>("");
+    args[1] = const_cast<char*>("-r");
+    args[2] = const_cast<char*>("no_asset");
+    ASSERT_EQ(0, asset_pack_main(3, args));
+    free(args);
+
+    std::string output = testing::internal::GetCapturedStdout();
+    ASSERT_EQ("Binary rebuilt!\n", output);
+}
+
+TEST(ST_asset_pack_tests, test_benchmark_b){
+
+    testing::internal::CaptureStdout();
+
+    auto args = static_cast<char**>(malloc(50));
+    args[0] = const_cast<char*>("");
+    args[1] = const_cast<char*>("-b");
+    args[2] = const_cast<char*>("no_asset");
+    ASSERT_EQ(0, asset_pack_main(3, args));
+    free(args);
+
+    std::string output = testing::internal::GetCapturedStdout();
+    ASSERT_EQ("Benchmark done!\n", output);
+}
+
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -11,6 +11,7 @@
 #define ASSTS_DEF
 
 #include <string>
+#include <vector>
 
 #include <ST_util/bytell_hash_map.hpp>
 #include <SDL.h>
@@ -27,6 +28,22 @@ namespace ST {
         ska::bytell_hash_map<uint16_t, Mix_Music *> music;
         ska::bytell_hash_map<uint16_t, Mix_Chunk *> chunks;
     };
+
+    ///A handle to a loaded asset of type T.
+    template <class T>
+    struct asset_handle {
+        uint16_t id = 0; //The hash of the asset name
+        uint32_t generation = 0; //Incremented every time the asset is loaded or unloaded
+        T* asset = nullptr; //nullptr once the asset is unloaded
+    };
+
+    ///The assets that were loaded or unloaded since the last change was sent - only the latest handle of each asset.
+    struct assets_delta {
+        std::vector<asset_handle<SDL_Surface>> surfaces;
+        std::vector<asset_handle<TTF_Font>> fonts;
+        std::vector<asset_handle<Mix_Music>> music;
+        std::vector<asset_handle<Mix_Chunk>> chunks;
+    };
 }
 
 #endif
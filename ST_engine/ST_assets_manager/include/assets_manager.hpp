@@ -17,8 +17,24 @@
 #include <message_bus.hpp>
 #include <task_manager.hpp>
 #include <cstdint>
+#include <type_traits>
 #include <ST_loaders/loaders.hpp>
 
+namespace ST {
+    ///A binary loaded by the assets_manager, cached so it never has to be decoded again to unload it.
+    struct binary_pack {
+        ST::pack* pack = nullptr; //nullptr for v0.9 binaries
+        std::vector<std::string> names; //The assets loaded from the binary as a whole
+        uint16_t count = 0;
+        uint16_t asset_count = 0; //The number of single assets loaded from the binary
+    };
+
+    ///Where a surface was loaded from, so it can be decoded again after it is freed.
+    struct surface_source {
+        std::string path; //The path to the image or to the binary it is in
+        std::string name; //The name of the asset in the binary, empty for images
+    };
+}
 
 ///This object is responsible for loading/unloading assets.
 class assets_manager{
@@ -29,14 +45,34 @@ private:
         subscriber msg_sub{};
         ST::assets all_assets;
         ska::bytell_hash_map<std::string, uint16_t> count;
+        ska::bytell_hash_map<std::string, ST::binary_pack> binaries;
+        ska::bytell_hash_map<uint16_t, uint32_t> generations;
+        ska::bytell_hash_map<uint16_t, ST::surface_source> sources;
+        ST::assets_delta changes;
+        uint32_t sent_deltas = 0;
+        //unloaded assets that an ASSETS_DELTA already sent may still point to, with the delta that unloads them
+        std::vector<std::pair<uint32_t, SDL_Surface*>> unloaded_surfaces;
+        std::vector<std::pair<uint32_t, TTF_Font*>> unloaded_fonts;
         int8_t load_asset(std::string path);
         int8_t unload_asset(std::string path);
         int8_t unload_assets_from_list(const std::string& path);
         int8_t load_assets_from_list(const std::string& path);
         int8_t load_assets_from_binary(const std::string& path);
         int8_t unload_assets_from_binary(const std::string& path);
+        int8_t load_asset_from_binary(const std::string& path, const std::string& name);
+        int8_t unload_asset_from_binary(const std::string& path, const std::string& name);
+        int8_t load_pack_entry(const std::string& path, const ST::pack* pack, const ST::pack_entry* entry);
+        SDL_Surface* decode_surface(const ST::surface_source& source);
+        void release_surfaces(const std::vector<ST::asset_handle<SDL_Surface>>& handles);
+        void reload_surfaces(const std::vector<uint16_t>& ids);
+        void free_unloaded_assets(uint32_t applied_delta);
+        ST::pack* get_pack(const std::string& path);
+        void close_unused_binary(const std::string& path);
         void handle_messages();
 		void send_assets();
+        void send_assets_delta();
+        template <class T> void set_asset(ska::bytell_hash_map<uint16_t, T*>& assets, std::vector<ST::asset_handle<T>>& handles, uint16_t id, std::type_identity_t<T>* asset);
+        void send_list_progress(const std::string& path, uint16_t loaded, uint16_t total);
 
 public:
         assets_manager(message_bus &gMessageBus, task_manager& tsk_mngr);
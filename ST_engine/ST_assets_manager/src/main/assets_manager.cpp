@@ -9,6 +9,7 @@
 
 #include <ST_loaders/loaders.hpp>
 #include <assets_manager.hpp>
+#include <algorithm>
 
 static bool singleton_initialized = false;
 
@@ -32,6 +33,14 @@ assets_manager::assets_manager(message_bus &gMessageBus, task_manager &gTask_man
     gMessage_bus.subscribe(LOAD_ASSET, &msg_sub);
     gMessage_bus.subscribe(UNLOAD_ASSET, &msg_sub);
     gMessage_bus.subscribe(LOAD_BINARY, &msg_sub);
+    gMessage_bus.subscribe(LOAD_BINARY_ASSET, &msg_sub);
+    gMessage_bus.subscribe(UNLOAD_BINARY_ASSET, &msg_sub);
+    gMessage_bus.subscribe(RELEASE_SURFACES, &msg_sub);
+    gMessage_bus.subscribe(ASSETS_DELTA_APPLIED, &msg_sub);
+    gMessage_bus.subscribe(RELOAD_SURFACES, &msg_sub);
+
+    //let the other subsystems know where the assets live, after this only the changes to them are sent
+    send_assets();
 
     //load the global assets
     load_assets_from_list("levels/assets_global.list");
@@ -54,103 +63,395 @@ void assets_manager::update_task(void* arg){
 void assets_manager::handle_messages(){
     message* temp = msg_sub.get_next_message();
     while(temp != nullptr){
-        auto path = *static_cast<std::string *>(temp->get_data());
+        //all other messages contain a path
+        std::string path;
+        if(temp->msg_name != RELEASE_SURFACES && temp->msg_name != RELOAD_SURFACES && temp->msg_name != ASSETS_DELTA_APPLIED
+        && temp->msg_name != LOAD_BINARY_ASSET && temp->msg_name != UNLOAD_BINARY_ASSET){
+            path = *static_cast<std::string *>(temp->get_data());
+        }
         switch (temp->msg_name) {
+            case RELEASE_SURFACES:
+                release_surfaces(*static_cast<std::vector<ST::asset_handle<SDL_Surface>>*>(temp->get_data()));
+                break;
+            case RELOAD_SURFACES:
+                reload_surfaces(*static_cast<std::vector<uint16_t>*>(temp->get_data()));
+                break;
+            case ASSETS_DELTA_APPLIED:
+                free_unloaded_assets(temp->base_data0);
+                break;
             case LOAD_LIST:
                 load_assets_from_list(path);
                 break;
             case UNLOAD_LIST:
                 unload_assets_from_list(path);
                 break;
-            case LOAD_ASSET: {
-                if (load_asset(path) == 0) {
-                    send_assets();
-                }
+            case LOAD_ASSET:
+                load_asset(path);
                 break;
-            }
-            case UNLOAD_ASSET: {
-                if (unload_asset(path) == 0) {
-                    send_assets();
-                }
+            case UNLOAD_ASSET:
+                unload_asset(path);
                 break;
-            }
             case LOAD_BINARY:
                 load_assets_from_binary(path);
                 break;
+            case LOAD_BINARY_ASSET: {
+                auto asset = static_cast<std::pair<std::string, std::string>*>(temp->get_data());
+                load_asset_from_binary(asset->first, asset->second);
+                break;
+            }
+            case UNLOAD_BINARY_ASSET: {
+                auto asset = static_cast<std::pair<std::string, std::string>*>(temp->get_data());
+                unload_asset_from_binary(asset->first, asset->second);
+                break;
+            }
         }
         delete temp;
         temp = msg_sub.get_next_message();
     }
+    //everything that changed while handling this batch of messages is sent together
+    send_assets_delta();
 }
 
+/**
+ * Stores an asset (or nullptr when it is unloaded) and records the change to send in the next ST::assets_delta.
+ * Only the latest change to each asset is sent, see send_assets_delta().
+ * @tparam T The type of the asset.
+ * @param assets The assets of this type.
+ * @param handles The changed assets of this type.
+ * @param id The hash of the name of the asset.
+ * @param asset The asset.
+ */
+template <class T>
+void assets_manager::set_asset(ska::bytell_hash_map<uint16_t, T*>& assets, std::vector<ST::asset_handle<T>>& handles,
+                               uint16_t id, std::type_identity_t<T>* asset){
+    assets[id] = asset;
+    ST::asset_handle<T> handle;
+    handle.id = id;
+    handle.generation = ++generations[id];
+    handle.asset = asset;
+    handles.emplace_back(handle);
+}
 
 /**
- * Loads assets contained within a binary.
- * @param path The path to the .bin (binary) file.
- * @return -1 on failure or 0 on success.
+ * Removes the handles that were replaced by a newer handle to the same asset.
+ * An asset that is loaded and unloaded in one batch must not be sent as loaded, it has already been freed.
+ * @tparam T The type of the asset.
+ * @param handles The changed assets of this type.
+ * @param generations The latest generation of each asset.
  */
-int8_t assets_manager::load_assets_from_binary(const std::string& path) {
-    ST::assets_named* assets1 = ST::unpack_binary(path);
-    if(assets1 != nullptr){
-        for(const auto &surface : assets1->surfaces){
-            if(count[surface.first] == 0){
-                gMessage_bus.send_msg(new message(LOG_SUCCESS, make_data<std::string>("Unpacking " + surface.first)));
-                uint16_t hashed = ST::hash_string(surface.first);
-                all_assets.surfaces[hashed] = surface.second;
-            }
-            ++count[surface.first];
+template <class T>
+static void remove_old_handles(std::vector<ST::asset_handle<T>>& handles, ska::bytell_hash_map<uint16_t, uint32_t>& generations){
+    handles.erase(std::remove_if(handles.begin(), handles.end(), [&generations](const ST::asset_handle<T>& handle){
+        return generations[handle.id] != handle.generation;
+    }), handles.end());
+}
+
+
+/**
+ * Frees surfaces that were uploaded to the GPU.
+ * Only surfaces that can be decoded again from their file or binary are freed, and only if they weren't
+ * replaced after the upload.
+ * @param handles The uploaded surfaces.
+ */
+void assets_manager::release_surfaces(const std::vector<ST::asset_handle<SDL_Surface>>& handles) {
+    for(const auto& handle : handles){
+        auto generation = generations.find(handle.id);
+        if(generation == generations.end() || generation->second != handle.generation
+        || sources.find(handle.id) == sources.end()){
+            continue;
         }
-        for(const auto &chunk : assets1->chunks){
-            if(count[chunk.first] == 0){
-                gMessage_bus.send_msg(new message(LOG_SUCCESS, make_data<std::string>("Unpacking " + chunk.first)));
-                uint16_t hashed = ST::hash_string(chunk.first);
-                all_assets.chunks[hashed] = chunk.second;
-            }
-            ++count[chunk.first];
+        auto surface = all_assets.surfaces.find(handle.id);
+        if(surface != all_assets.surfaces.end() && surface->second == handle.asset){
+            SDL_FreeSurface(surface->second);
+            surface->second = nullptr;
+        }
+    }
+}
+
+/**
+ * Frees the unloaded surfaces and fonts once the delta that unloads them is applied.
+ * Deltas are applied in order, so nothing can point to them anymore.
+ * @param applied_delta The number of the last applied delta.
+ */
+void assets_manager::free_unloaded_assets(uint32_t applied_delta) {
+    std::erase_if(unloaded_surfaces, [applied_delta](const std::pair<uint32_t, SDL_Surface*>& surface){
+        if(surface.first > applied_delta){
+            return false;
+        }
+        SDL_FreeSurface(surface.second);
+        return true;
+    });
+    std::erase_if(unloaded_fonts, [applied_delta](const std::pair<uint32_t, TTF_Font*>& font){
+        if(font.first > applied_delta){
+            return false;
         }
-        for(const auto &music : assets1->music){
-            if(count[music.first] == 0){
-                gMessage_bus.send_msg(new message(LOG_SUCCESS, make_data<std::string>("Unpacking " + music.first)));
-                count[music.first]++;
-                uint16_t hashed = ST::hash_string(music.first);
-                all_assets.music[hashed] = music.second;
+        TTF_CloseFont(font.second);
+        return true;
+    });
+}
+
+/**
+ * Sends surfaces again so their textures can be recreated, decoding those that were freed.
+ * Surfaces that are no longer loaded are ignored.
+ * @param ids The hashes of the names of the surfaces.
+ */
+void assets_manager::reload_surfaces(const std::vector<uint16_t>& ids) {
+    for(uint16_t id : ids){
+        auto surface = all_assets.surfaces.find(id);
+        if(surface == all_assets.surfaces.end()){
+            continue;
+        }
+        SDL_Surface* reloaded = surface->second;
+        if(reloaded == nullptr){
+            auto source = sources.find(id);
+            if(source == sources.end()){
+                continue;
+            }
+            reloaded = decode_surface(source->second);
+            if(reloaded == nullptr){
+                gMessage_bus.send_msg(new message(LOG_ERROR, make_data<std::string>("Error reloading " + source->second.path + " " + source->second.name)));
+                continue;
             }
-            ++count[music.first];
         }
-        delete assets1;
-    }else{
+        set_asset(all_assets.surfaces, changes.surfaces, id, reloaded);
+    }
+}
+
+/**
+ * Decodes a surface again from the image or binary it was loaded from.
+ * @param source Where the surface was loaded from.
+ * @return The surface or nullptr on failure.
+ */
+SDL_Surface* assets_manager::decode_surface(const ST::surface_source& source) {
+    if(source.name.empty()){
+        return IMG_Load(source.path.c_str());
+    }
+    ST::pack* pack = get_pack(source.path);
+    if(pack == nullptr){
+        return nullptr;
+    }
+    const ST::pack_entry* entry = ST::find_pack_entry(pack, ST::pack_name_hash(source.name));
+    ST::assets_named decoded;
+    if(entry == nullptr || ST::unpack_pack_entry(pack, entry, &decoded) != 0 || decoded.surfaces.empty()){
+        return nullptr;
+    }
+    return decoded.surfaces.begin()->second;
+}
+
+/**
+ * Get a v2 binary, memory mapping it the first time it is needed.
+ * @param path The path to the .bin (binary) file.
+ * @return The binary, <b>nullptr</b> if it can't be opened or is not a v2 binary.
+ */
+ST::pack* assets_manager::get_pack(const std::string& path) {
+    ST::binary_pack& binary = binaries[path];
+    if(binary.pack == nullptr){
+        binary.pack = ST::open_pack(path);
+    }
+    return binary.pack;
+}
+
+/**
+ * Unmaps a binary once nothing loaded from it is left.
+ * @param path The path to the .bin (binary) file.
+ */
+void assets_manager::close_unused_binary(const std::string& path) {
+    auto binary = binaries.find(path);
+    if(binary != binaries.end() && binary->second.count == 0 && binary->second.asset_count == 0){
+        ST::close_pack(binary->second.pack);
+        binaries.erase(binary);
+    }
+}
+
+/**
+ * Loads a single asset from a v2 binary, decoding it only if it isn't loaded already.
+ * @param path The path to the .bin (binary) file.
+ * @param pack The binary.
+ * @param entry The entry of the asset in the binary.
+ * @return -1 on failure or 0 on success.
+ */
+int8_t assets_manager::load_pack_entry(const std::string& path, const ST::pack* pack, const ST::pack_entry* entry) {
+    std::string name = ST::get_pack_entry_name(pack, entry);
+    uint16_t& asset_count = count[name];
+    if(asset_count > 0){
+        ++asset_count;
+        return 0;
+    }
+    ST::assets_named decoded;
+    if(ST::unpack_pack_entry(pack, entry, &decoded) != 0){
+        gMessage_bus.send_msg(new message(LOG_ERROR, make_data<std::string>("Error unpacking " + name)));
         return -1;
     }
+    gMessage_bus.send_msg(new message(LOG_SUCCESS, make_data<std::string>("Unpacking " + name)));
+    uint16_t hashed = ST::hash_string(name);
+    for(const auto &surface : decoded.surfaces){
+        set_asset(all_assets.surfaces, changes.surfaces, hashed, surface.second);
+        sources[hashed] = {path, name};
+    }
+    for(const auto &chunk : decoded.chunks){
+        set_asset(all_assets.chunks, changes.chunks, hashed, chunk.second);
+    }
+    for(const auto &music : decoded.music){
+        set_asset(all_assets.music, changes.music, hashed, music.second);
+    }
+    ++asset_count;
     return 0;
 }
 
 /**
- * Unloads assets contained within a binary.
+ * Loads assets contained within a binary.
+ * v2 binaries are memory mapped and only assets that aren't loaded yet are decoded.
  * @param path The path to the .bin (binary) file.
  * @return -1 on failure or 0 on success.
  */
-int8_t assets_manager::unload_assets_from_binary(const std::string& path) {
+int8_t assets_manager::load_assets_from_binary(const std::string& path) {
+    ST::pack* pack = get_pack(path);
+    ST::binary_pack& binary = binaries[path];
+    if(pack != nullptr){
+        if(binary.count == 0){
+            binary.names.clear();
+            for(uint32_t i = 0; i < pack->header->entry_count; i++){
+                binary.names.emplace_back(ST::get_pack_entry_name(pack, &pack->entries[i]));
+            }
+        }
+        for(uint32_t i = 0; i < pack->header->entry_count; i++){
+            load_pack_entry(path, pack, &pack->entries[i]);
+        }
+        ++binary.count;
+        return 0;
+    }
+
+    //v0.9 binaries have no index, so they have to be decoded as a whole
     ST::assets_named* assets1 = ST::unpack_binary(path);
-    if(assets1 != nullptr){
-        for(const auto &surface : assets1->surfaces){
-            unload_asset(surface.first);
+    if(assets1 == nullptr){
+        close_unused_binary(path);
+        return -1;
+    }
+    binary.names.clear();
+    for(const auto &surface : assets1->surfaces){
+        binary.names.emplace_back(surface.first);
+        if(count[surface.first] == 0){
+            gMessage_bus.send_msg(new message(LOG_SUCCESS, make_data<std::string>("Unpacking " + surface.first)));
+            uint16_t hashed = ST::hash_string(surface.first);
+            set_asset(all_assets.surfaces, changes.surfaces, hashed, surface.second);
+        }else{
             SDL_FreeSurface(surface.second);
         }
-        for(const auto &chunk : assets1->chunks){
-            unload_asset(chunk.first);
+        ++count[surface.first];
+    }
+    for(const auto &chunk : assets1->chunks){
+        binary.names.emplace_back(chunk.first);
+        if(count[chunk.first] == 0){
+            gMessage_bus.send_msg(new message(LOG_SUCCESS, make_data<std::string>("Unpacking " + chunk.first)));
+            uint16_t hashed = ST::hash_string(chunk.first);
+            set_asset(all_assets.chunks, changes.chunks, hashed, chunk.second);
+        }else{
             Mix_FreeChunk(chunk.second);
         }
-        for(const auto &music : assets1->music){
-            unload_asset(music.first);
+        ++count[chunk.first];
+    }
+    for(const auto &music : assets1->music){
+        binary.names.emplace_back(music.first);
+        if(count[music.first] == 0){
+            gMessage_bus.send_msg(new message(LOG_SUCCESS, make_data<std::string>("Unpacking " + music.first)));
+            uint16_t hashed = ST::hash_string(music.first);
+            set_asset(all_assets.music, changes.music, hashed, music.second);
+        }else{
             Mix_FreeMusic(music.second);
         }
-        delete assets1;
-    }else{
+        ++count[music.first];
+    }
+    ++binary.count;
+    delete assets1;
+    return 0;
+}
+
+/**
+ * Unloads assets contained within a binary.
+ * Uses the names cached when the binary was loaded, so nothing is decoded.
+ * @param path The path to the .bin (binary) file.
+ * @return -1 if the binary isn't loaded or 0 on success.
+ */
+int8_t assets_manager::unload_assets_from_binary(const std::string& path) {
+    auto binary = binaries.find(path);
+    if(binary == binaries.end() || binary->second.count == 0){
+        return -1;
+    }
+    for(const auto &name : binary->second.names){
+        unload_asset(name);
+    }
+    --binary->second.count;
+    close_unused_binary(path);
+    return 0;
+}
+
+/**
+ * Loads a single asset from a v2 binary.
+ * The asset is found through the index of the binary, so nothing else in it is read.
+ * The binary stays mapped until every asset loaded from it this way is unloaded with unload_asset_from_binary().
+ * @param path The path to the .bin (binary) file.
+ * @param name The name of the asset inside the binary.
+ * @return -1 on failure or 0 on success.
+ */
+int8_t assets_manager::load_asset_from_binary(const std::string& path, const std::string& name) {
+    ST::pack* pack = get_pack(path);
+    if(pack == nullptr){
+        close_unused_binary(path);
+        gMessage_bus.send_msg(new message(LOG_ERROR, make_data<std::string>("Binary " + path + " not found or not a v2 binary")));
+        return -1;
+    }
+    const ST::pack_entry* entry = ST::find_pack_entry(pack, ST::pack_name_hash(name));
+    if(entry == nullptr){
+        close_unused_binary(path);
+        gMessage_bus.send_msg(new message(LOG_ERROR, make_data<std::string>("File " + name + " not found in " + path)));
         return -1;
     }
+    if(load_pack_entry(path, pack, entry) != 0){
+        close_unused_binary(path);
+        return -1;
+    }
+    ++binaries[path].asset_count;
     return 0;
 }
 
+/**
+ * Unloads a single asset loaded with load_asset_from_binary().
+ * The binary is unmapped when nothing loaded from it is left.
+ * @param path The path to the .bin (binary) file.
+ * @param name The name of the asset inside the binary.
+ * @return -1 on failure or 0 on success.
+ */
+int8_t assets_manager::unload_asset_from_binary(const std::string& path, const std::string& name) {
+    auto binary = binaries.find(path);
+    if(binary == binaries.end() || binary->second.asset_count == 0
+    || ST::find_pack_entry(binary->second.pack, ST::pack_name_hash(name)) == nullptr){
+        return -1;
+    }
+    --binary->second.asset_count;
+    int8_t result = unload_asset(name);
+    close_unused_binary(path);
+    return result;
+}
+
+/**
+ * Sends the assets that were loaded or unloaded since the last time in a single ASSETS_DELTA message.
+ * Nothing is sent if no asset changed.
+ */
+void assets_manager::send_assets_delta() {
+    if(changes.surfaces.empty() && changes.fonts.empty() && changes.music.empty() && changes.chunks.empty()){
+        return;
+    }
+    remove_old_handles(changes.surfaces, generations);
+    remove_old_handles(changes.fonts, generations);
+    remove_old_handles(changes.music, generations);
+    remove_old_handles(changes.chunks, generations);
+    gMessage_bus.send_msg(new message(ASSETS_DELTA, ++sent_deltas, make_data<ST::assets_delta>(changes)));
+    changes = ST::assets_delta();
+}
+
+/**
+ * Sends pointers to all assets, only needed once as the maps themselves never move.
+ */
 void assets_manager::send_assets() {
 	gMessage_bus.send_msg(new message(SURFACES_ASSETS, make_data(&all_assets.surfaces)));
     gMessage_bus.send_msg(new message(FONTS_ASSETS, make_data(&all_assets.fonts)));
@@ -191,9 +492,11 @@ int8_t assets_manager::load_asset(std::string path){
     if(extension == ST::asset_file_type::PNG || extension == ST::asset_file_type::WEBP){
         SDL_Surface* temp1 = IMG_Load(path.c_str());
         if(temp1 != nullptr) {
+            std::string file = path;
             path = ST::trim_path(path);
             uint16_t string_hash = ST::hash_string(path);
-            all_assets.surfaces[string_hash] = temp1;
+            set_asset(all_assets.surfaces, changes.surfaces, string_hash, temp1);
+            sources[string_hash] = {file, ""};
             ++count.at(path);
         }else{
             gMessage_bus.send_msg(new message(LOG_ERROR, make_data<std::string>("File " + path + " not found")));
@@ -204,7 +507,7 @@ int8_t assets_manager::load_asset(std::string path){
         if (temp1 != nullptr){
             path = ST::trim_path(path);
             uint16_t string_hash = ST::hash_string(path);
-            all_assets.chunks[string_hash] = temp1;
+            set_asset(all_assets.chunks, changes.chunks, string_hash, temp1);
             ++count.at(path);
         }
         else{
@@ -216,7 +519,7 @@ int8_t assets_manager::load_asset(std::string path){
         if (temp1 != nullptr) {
             path = ST::trim_path(path);
             uint16_t string_hash = ST::hash_string(path);
-            all_assets.music[string_hash] = temp1;
+            set_asset(all_assets.music, changes.music, string_hash, temp1);
             ++count.at(path);
         }
         else {
@@ -246,7 +549,7 @@ int8_t assets_manager::load_asset(std::string path){
         if(tempFont != nullptr){
             font = ST::trim_path(font);
             std::string font_and_size = font + " " + result.at(1);
-            all_assets.fonts[ST::hash_string(font_and_size)] = tempFont;
+            set_asset(all_assets.fonts, changes.fonts, ST::hash_string(font_and_size), tempFont);
             ++count.at(font_and_size);
         }else{
             gMessage_bus.send_msg(new message(LOG_ERROR, make_data<std::string>("File " + font + " not found!")));
@@ -256,29 +559,56 @@ int8_t assets_manager::load_asset(std::string path){
     return 0;
 }
 
+/**
+ * Sends a LOAD_LIST_PROGRESS message for a list.
+ * @param path The path to the .list file.
+ * @param loaded The number of assets loaded so far.
+ * @param total The total number of assets in the list.
+ */
+void assets_manager::send_list_progress(const std::string& path, uint16_t loaded, uint16_t total) {
+    uint32_t loaded_total = loaded | (static_cast<uint32_t>(total) << 16U);
+    gMessage_bus.send_msg(new message(LOAD_LIST_PROGRESS, loaded_total, make_data<std::string>(path)));
+}
+
 /**
  * Loads assets from a .list file.
+ * Reports the progress with LOAD_LIST_PROGRESS messages after every asset.
+ * The final (complete) progress message is always sent after the assets themselves, so anyone
+ * waiting on it can rely on the assets being available to the other subsystems.
  * @param path The path to the .list file.
  * @return -1 on failure or 0 on success.
  */
 int8_t assets_manager::load_assets_from_list(const std::string& path){
     std::ifstream file;
     file.open(path.c_str());
+    std::vector<std::string> entries;
     if(file.is_open()){
         std::string temp;
         while(!file.eof()){
             getline(file, temp);
             if(!temp.empty()) {
-                load_asset(temp);
+                entries.emplace_back(temp);
             }
         }
         file.close();
     }
     else{
         gMessage_bus.send_msg(new message(LOG_ERROR, make_data<std::string>("File " + path + " not found")));
+        //Nothing will ever be loaded from this list, report it as done so nobody waits on it
+        send_list_progress(path, 0, 0);
         return -1;
     }
-	send_assets();
+    auto total = static_cast<uint16_t>(entries.size());
+    uint16_t loaded = 0;
+    for(const auto& entry : entries) {
+        load_asset(entry);
+        ++loaded;
+        if(loaded < total) {
+            send_list_progress(path, loaded, total);
+        }
+    }
+    send_assets_delta();
+    send_list_progress(path, total, total);
     return 0;
 }
 
@@ -307,7 +637,7 @@ int8_t assets_manager::unload_assets_from_list(const std::string& path){
         gMessage_bus.send_msg(new message(LOG_ERROR, make_data<std::string>("File " + path + " not found")));
         return -1;
     }
-	send_assets();
+    send_assets_delta();
     return 0;
 }
 
@@ -331,27 +661,29 @@ int8_t assets_manager::unload_asset(std::string path){
     if(extension == ST::asset_file_type::PNG || extension == ST::asset_file_type::WEBP){
         path = ST::trim_path(path);
         uint16_t string_hash = ST::hash_string(path);
-        SDL_FreeSurface(all_assets.surfaces[string_hash]);
-        all_assets.surfaces[string_hash] = nullptr;
+        //a delta that was already sent may still point to the surface, it is freed once the next one is applied
+        unloaded_surfaces.emplace_back(sent_deltas + 1, all_assets.surfaces[string_hash]);
+        set_asset(all_assets.surfaces, changes.surfaces, string_hash, nullptr);
+        sources.erase(string_hash);
         --count.at(path);
     }else if(extension == ST::asset_file_type::WAV){
         path = ST::trim_path(path);
         uint16_t string_hash = ST::hash_string(path);
         Mix_FreeChunk(all_assets.chunks[string_hash]);
-        all_assets.chunks[string_hash] = nullptr;
+        set_asset(all_assets.chunks, changes.chunks, string_hash, nullptr);
         --count.at(path);
     }else if(extension == ST::asset_file_type::OGG){
         path = ST::trim_path(path);
         uint16_t string_hash = ST::hash_string(path);
         Mix_FreeMusic(all_assets.music[string_hash]);
-        all_assets.music[string_hash] = nullptr;
+        set_asset(all_assets.music, changes.music, string_hash, nullptr);
         --count.at(path);
     }else if(extension == ST::asset_file_type::BIN){
         return unload_assets_from_binary(path);
     }else{ //if file is a font
         path = ST::trim_path(path);
-        TTF_CloseFont(all_assets.fonts[ST::hash_string(path)]);
-        all_assets.fonts[ST::hash_string(path)] = nullptr;
+        unloaded_fonts.emplace_back(sent_deltas + 1, all_assets.fonts[ST::hash_string(path)]);
+        set_asset(all_assets.fonts, changes.fonts, ST::hash_string(path), nullptr);
         --count.at(path);
     }
     return 0;
@@ -368,5 +700,9 @@ assets_manager::~assets_manager(){
             unload_asset(i.first);
         }
     }
+    for(auto& binary : binaries){
+        ST::close_pack(binary.second.pack);
+    }
+    free_unloaded_assets(UINT32_MAX);
     singleton_initialized = false;
 }
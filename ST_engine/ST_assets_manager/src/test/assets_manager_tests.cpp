@@ -32,6 +32,30 @@ protected:
         return test_mngr->load_assets_from_binary(path);
     }
 
+    int8_t unload_assets_from_binary(const std::string& path){
+        return test_mngr->unload_assets_from_binary(path);
+    }
+
+    int8_t load_asset_from_binary(const std::string& path, const std::string& name){
+        return test_mngr->load_asset_from_binary(path, name);
+    }
+
+    int8_t unload_asset_from_binary(const std::string& path, const std::string& name){
+        return test_mngr->unload_asset_from_binary(path, name);
+    }
+
+    size_t get_unloaded_surfaces_count(){
+        return test_mngr->unloaded_surfaces.size();
+    }
+
+    size_t get_unloaded_fonts_count(){
+        return test_mngr->unloaded_fonts.size();
+    }
+
+    bool is_binary_open(const std::string& path){
+        return test_mngr->binaries.count(path) != 0;
+    }
+
     int8_t load_assets_from_list(const std::string& path){
         return test_mngr->load_assets_from_list(path);
     }
@@ -40,6 +64,10 @@ protected:
         return test_mngr->unload_assets_from_list(path);
     }
 
+    void handle_messages(){
+        test_mngr->handle_messages();
+    }
+
     uint16_t get_count(const std::string& asset_name){
         return test_mngr->count[asset_name];
     };
@@ -246,6 +274,74 @@ TEST_F(asset_manager_test, loadBinary_complex) {
     SDL_FreeSurface(test_surface_3);
 }
 
+TEST_F(asset_manager_test, unloadBinary_PNG) {
+    ASSERT_EQ(0, load_assets_from_binary("test_binary_png.bin"));
+    ASSERT_EQ(1, get_count("test_image.png"));
+    ASSERT_EQ(0, unload_assets_from_binary("test_binary_png.bin"));
+    ASSERT_EQ(0, get_count("test_image.png"));
+    ASSERT_FALSE(get_assets().surfaces[ST::hash_string("test_image.png")]);
+
+    //The binary is no longer loaded
+    ASSERT_EQ(-1, unload_assets_from_binary("test_binary_png.bin"));
+}
+
+TEST_F(asset_manager_test, loadBinaryAsset_single) {
+    //Set up
+    std::string binary_name = "test_binary_v2.bin";
+    remove(binary_name.c_str());
+    ASSERT_EQ(0, ST::pack_to_binary(binary_name, {"test_image_1.png", "test_sound.wav"}));
+
+    //Test - only the requested asset is loaded
+    ASSERT_EQ(0, load_asset_from_binary(binary_name, "test_sound.wav"));
+    ASSERT_TRUE(get_assets().chunks[ST::hash_string("test_sound.wav")]);
+    ASSERT_FALSE(get_assets().surfaces[ST::hash_string("test_image_1.png")]);
+    ASSERT_EQ(1, get_count("test_sound.wav"));
+    ASSERT_EQ(-1, load_asset_from_binary(binary_name, "not_in_binary.png"));
+
+    //Tear down
+    delete test_mngr;
+    test_mngr = new assets_manager(*msg_bus, *task_mngr);
+    remove(binary_name.c_str());
+}
+
+TEST_F(asset_manager_test, unloadBinaryAsset_single) {
+    //Set up
+    std::string binary_name = "test_binary_v2.bin";
+    remove(binary_name.c_str());
+    ASSERT_EQ(0, ST::pack_to_binary(binary_name, {"test_image_1.png", "test_sound.wav"}));
+    ASSERT_EQ(0, load_asset_from_binary(binary_name, "test_sound.wav"));
+    ASSERT_EQ(0, load_asset_from_binary(binary_name, "test_image_1.png"));
+    ASSERT_EQ(0, load_asset_from_binary(binary_name, "test_sound.wav"));
+
+    //Test - the binary stays mapped until the last asset loaded from it is unloaded
+    ASSERT_EQ(0, unload_asset_from_binary(binary_name, "test_sound.wav"));
+    ASSERT_EQ(1, get_count("test_sound.wav"));
+    ASSERT_EQ(0, unload_asset_from_binary(binary_name, "test_image_1.png"));
+    ASSERT_FALSE(get_assets().surfaces[ST::hash_string("test_image_1.png")]);
+    ASSERT_TRUE(is_binary_open(binary_name));
+    ASSERT_EQ(0, unload_asset_from_binary(binary_name, "test_sound.wav"));
+    ASSERT_FALSE(get_assets().chunks[ST::hash_string("test_sound.wav")]);
+    ASSERT_FALSE(is_binary_open(binary_name));
+    ASSERT_EQ(-1, unload_asset_from_binary(binary_name, "test_sound.wav"));
+
+    //Tear down
+    remove(binary_name.c_str());
+}
+
+TEST_F(asset_manager_test, loadBinaryAsset_missing_closes_binary) {
+    //Set up
+    std::string binary_name = "test_binary_v2.bin";
+    remove(binary_name.c_str());
+    ASSERT_EQ(0, ST::pack_to_binary(binary_name, {"test_image_1.png"}));
+
+    //Test
+    ASSERT_EQ(-1, load_asset_from_binary(binary_name, "not_in_binary.png"));
+    ASSERT_FALSE(is_binary_open(binary_name));
+
+    //Tear down
+    remove(binary_name.c_str());
+}
+
 TEST_F(asset_manager_test, test_load_assets_from_list){
 
     ASSERT_EQ(0, load_assets_from_list("test_list_1.list"));
@@ -295,6 +391,198 @@ TEST_F(asset_manager_test, test_fail_when_list_does_not_exist){
     ASSERT_EQ(-1, load_assets_from_list("no_list.list"));
 }
 
+TEST_F(asset_manager_test, test_load_assets_from_list_progress){
+    //Set up
+    subscriber subscriber1;
+    msg_bus->subscribe(LOAD_LIST_PROGRESS, &subscriber1);
+
+    //Test
+    ASSERT_EQ(0, load_assets_from_list("test_list_1.list"));
+
+    //Check result - expect one message per asset, the last one reporting the whole list as loaded
+    uint8_t message_count = 0;
+    uint32_t last_progress = 0;
+    message* result = subscriber1.get_next_message();
+    while(result != nullptr){
+        ASSERT_EQ("test_list_1.list", *static_cast<std::string*>(result->get_data()));
+        last_progress = result->base_data0;
+        ++message_count;
+        delete result;
+        result = subscriber1.get_next_message();
+    }
+    ASSERT_EQ(5, message_count);
+    ASSERT_EQ(5, last_progress & 0x0000ffffU);
+    ASSERT_EQ(5, (last_progress >> 16U) & 0x0000ffffU);
+}
+
+TEST_F(asset_manager_test, test_load_assets_from_list_progress_when_list_does_not_exist){
+    //Set up
+    subscriber subscriber1;
+    msg_bus->subscribe(LOAD_LIST_PROGRESS, &subscriber1);
+
+    //Test
+    ASSERT_EQ(-1, load_assets_from_list("no_list.list"));
+
+    //Check result - the list is reported as empty so waiting levels don't stall
+    message* result = subscriber1.get_next_message();
+    ASSERT_TRUE(result);
+    ASSERT_EQ(0, result->base_data0);
+    delete result;
+}
+
+TEST_F(asset_manager_test, test_load_asset_sends_delta){
+    //Set up
+    subscriber subscriber1;
+    msg_bus->subscribe(ASSETS_DELTA, &subscriber1);
+
+    //Test
+    msg_bus->send_msg(new message(LOAD_ASSET, make_data<std::string>("test_image_1.png")));
+    msg_bus->send_msg(new message(LOAD_ASSET, make_data<std::string>("test_sound.wav")));
+    handle_messages();
+
+    //Check result - both assets arrive in one message
+    message* result = subscriber1.get_next_message();
+    ASSERT_TRUE(result);
+    auto delta = static_cast<ST::assets_delta*>(result->get_data());
+    ASSERT_EQ(1, delta->surfaces.size());
+    ASSERT_EQ(1, delta->chunks.size());
+    ASSERT_EQ(0, delta->fonts.size());
+    ASSERT_EQ(0, delta->music.size());
+    ASSERT_EQ(ST::hash_string("test_image_1.png"), delta->surfaces.at(0).id);
+    ASSERT_EQ(1, delta->surfaces.at(0).generation);
+    ASSERT_EQ(get_assets().surfaces[ST::hash_string("test_image_1.png")], delta->surfaces.at(0).asset);
+    ASSERT_EQ(get_assets().chunks[ST::hash_string("test_sound.wav")], delta->chunks.at(0).asset);
+    delete result;
+    ASSERT_FALSE(subscriber1.get_next_message());
+}
+
+TEST_F(asset_manager_test, test_load_and_unload_asset_sends_latest_handle){
+    //Set up
+    subscriber subscriber1;
+    msg_bus->subscribe(ASSETS_DELTA, &subscriber1);
+
+    //Test
+    msg_bus->send_msg(new message(LOAD_ASSET, make_data<std::string>("test_image_1.png")));
+    msg_bus->send_msg(new message(UNLOAD_ASSET, make_data<std::string>("test_image_1.png")));
+    handle_messages();
+
+    //Check result - the freed surface must not be sent
+    message* result = subscriber1.get_next_message();
+    ASSERT_TRUE(result);
+    auto delta = static_cast<ST::assets_delta*>(result->get_data());
+    ASSERT_EQ(1, delta->surfaces.size());
+    ASSERT_EQ(2, delta->surfaces.at(0).generation);
+    ASSERT_FALSE(delta->surfaces.at(0).asset);
+    delete result;
+}
+
+TEST_F(asset_manager_test, test_unloaded_assets_freed_once_delta_applied){
+    //Set up
+    subscriber subscriber1;
+    msg_bus->subscribe(ASSETS_DELTA, &subscriber1);
+    msg_bus->send_msg(new message(LOAD_ASSET, make_data<std::string>("test_image_1.png")));
+    msg_bus->send_msg(new message(LOAD_ASSET, make_data<std::string>("test_font.ttf 40")));
+    handle_messages();
+
+    //Test - unloaded in the next batch, before the first delta is consumed
+    msg_bus->send_msg(new message(UNLOAD_ASSET, make_data<std::string>("test_image_1.png")));
+    msg_bus->send_msg(new message(UNLOAD_ASSET, make_data<std::string>("test_font.ttf 40")));
+    handle_messages();
+    ASSERT_EQ(1, get_unloaded_surfaces_count());
+    ASSERT_EQ(1, get_unloaded_fonts_count());
+
+    //Check result - the assets in the first delta are still valid
+    message* loaded = subscriber1.get_next_message();
+    ASSERT_TRUE(loaded);
+    ASSERT_EQ(1, loaded->base_data0);
+    auto delta = static_cast<ST::assets_delta*>(loaded->get_data());
+    SDL_Surface* test_surface = IMG_Load("test_image_1.png");
+    ASSERT_TRUE(test_surface);
+    ASSERT_TRUE(compare_surfaces(test_surface, delta->surfaces.at(0).asset));
+    ASSERT_GT(TTF_FontHeight(delta->fonts.at(0).asset), 0);
+    SDL_FreeSurface(test_surface);
+    delete loaded;
+
+    //Test - applying the first delta frees nothing, applying the one that unloads them frees them
+    msg_bus->send_msg(new message(ASSETS_DELTA_APPLIED, 1));
+    handle_messages();
+    ASSERT_EQ(1, get_unloaded_surfaces_count());
+    ASSERT_EQ(1, get_unloaded_fonts_count());
+    message* unloaded = subscriber1.get_next_message();
+    ASSERT_TRUE(unloaded);
+    ASSERT_EQ(2, unloaded->base_data0);
+    delete unloaded;
+    msg_bus->send_msg(new message(ASSETS_DELTA_APPLIED, 2));
+    handle_messages();
+    ASSERT_EQ(0, get_unloaded_surfaces_count());
+    ASSERT_EQ(0, get_unloaded_fonts_count());
+}
+
+TEST_F(asset_manager_test, test_no_delta_without_changes){
+    //Set up
+    subscriber subscriber1;
+    msg_bus->subscribe(ASSETS_DELTA, &subscriber1);
+
+    //Test
+    msg_bus->send_msg(new message(UNLOAD_ASSET, make_data<std::string>("test_image_1.png")));
+    handle_messages();
+
+    //Check result
+    ASSERT_FALSE(subscriber1.get_next_message());
+}
+
+TEST_F(asset_manager_test, test_release_and_reload_surface){
+    //Set up
+    subscriber subscriber1;
+    msg_bus->subscribe(ASSETS_DELTA, &subscriber1);
+    msg_bus->send_msg(new message(LOAD_ASSET, make_data<std::string>("test_image_1.png")));
+    handle_messages();
+    message* loaded = subscriber1.get_next_message();
+    ASSERT_TRUE(loaded);
+    auto uploaded = static_cast<ST::assets_delta*>(loaded->get_data())->surfaces;
+    delete loaded;
+
+    //Test - the surface is freed once it is uploaded, but stays loaded
+    msg_bus->send_msg(new message(RELEASE_SURFACES, make_data(uploaded)));
+    handle_messages();
+    ASSERT_FALSE(get_assets().surfaces[ST::hash_string("test_image_1.png")]);
+    ASSERT_EQ(1, get_count("test_image_1.png"));
+
+    //Test - it is decoded again when it is needed
+    msg_bus->send_msg(new message(RELOAD_SURFACES, make_data(std::vector<uint16_t>{ST::hash_string("test_image_1.png")})));
+    handle_messages();
+
+    //Check result
+    SDL_Surface* test_surface = IMG_Load("test_image_1.png");
+    ASSERT_TRUE(static_cast<bool>(test_surface));
+    ASSERT_TRUE(compare_surfaces(test_surface, get_assets().surfaces[ST::hash_string("test_image_1.png")]));
+    message* result = subscriber1.get_next_message();
+    ASSERT_TRUE(result);
+    auto delta = static_cast<ST::assets_delta*>(result->get_data());
+    ASSERT_EQ(1, delta->surfaces.size());
+    ASSERT_EQ(2, delta->surfaces.at(0).generation);
+    ASSERT_EQ(get_assets().surfaces[ST::hash_string("test_image_1.png")], delta->surfaces.at(0).asset);
+    delete result;
+    SDL_FreeSurface(test_surface);
+}
+
+TEST_F(asset_manager_test, test_release_replaced_surface){
+    //Set up
+    ASSERT_EQ(0, load_asset("test_image_1.png"));
+    ST::asset_handle<SDL_Surface> old_handle;
+    old_handle.id = ST::hash_string("test_image_1.png");
+    old_handle.generation = 1;
+    old_handle.asset = get_assets().surfaces[old_handle.id];
+    ASSERT_EQ(0, unload_asset("test_image_1.png"));
+    ASSERT_EQ(0, load_asset("test_image_1.png"));
+
+    //Test - a handle to a surface that was replaced after the upload frees nothing
+    msg_bus->send_msg(new message(RELEASE_SURFACES, make_data(std::vector<ST::asset_handle<SDL_Surface>>{old_handle})));
+    handle_messages();
+
+    //Check result
+    ASSERT_TRUE(get_assets().surfaces[ST::hash_string("test_image_1.png")]);
+}
 
 TEST_F(asset_manager_test, test_load_asset_twice){
 
@@ -44,7 +44,7 @@ class console{
 
     subscriber msg_sub{};
         bool shown = false;
-        std::vector<ST::console_log> entries;
+        ST::console_log_buffer entries{};
 		std::vector<std::string> command_entries;
         const uint8_t font_size = 40;
         int32_t scroll_offset = 0;
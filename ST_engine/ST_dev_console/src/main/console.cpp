@@ -213,11 +213,7 @@ void console::write(const std::string &arg, ST::log_type type){
     } else {
         fprintf(stdout, "%s\n", arg.c_str());
     }
-    entries.emplace_back(type, arg);
-    //remove an entry if there are too many
-    if(entries.size() > 1000) {
-        entries.erase(entries.begin());
-    }
+    entries.push(type, arg);
 }
 
 /**
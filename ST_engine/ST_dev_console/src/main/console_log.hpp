@@ -13,6 +13,8 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <SDL_pixels.h>
 
 namespace ST {
@@ -46,6 +48,65 @@ namespace ST {
             this->text = text;
         }
     };
+
+    ///Holds the latest log messages, once it is full every new message replaces the oldest one.
+    /**
+     * The slots are reused, so the text of a new message is copied in memory the slot already has and logging
+     * doesn't allocate once the buffer has filled up (unless a message is longer than the one it replaces).
+     */
+    class console_log_buffer {
+    public:
+        static constexpr uint16_t capacity = 1000;
+
+        void push(log_type type, std::string_view text);
+        void clear();
+        [[nodiscard]] size_t size() const;
+        [[nodiscard]] const console_log& operator[](size_t index) const;
+
+    private:
+        std::vector<console_log> entries{};
+        uint16_t next = 0; //the slot the next message is written to, the oldest message once the buffer is full
+    };
+
+    //INLINED METHODS
+
+    /**
+     * Adds a message, replacing the oldest one if the buffer is full.
+     * @param type The type of the message.
+     * @param text The text of the message.
+     */
+    inline void console_log_buffer::push(log_type type, std::string_view text) {
+        if(entries.size() < capacity){
+            entries.emplace_back(type, std::string(text));
+        }else{
+            entries[next].type = type;
+            entries[next].text.assign(text);
+        }
+        next = static_cast<uint16_t>((next + 1) % capacity);
+    }
+
+    /**
+     * Removes all messages.
+     */
+    inline void console_log_buffer::clear() {
+        entries.clear();
+        next = 0;
+    }
+
+    /**
+     * @return The number of messages in the buffer.
+     */
+    inline size_t console_log_buffer::size() const {
+        return entries.size();
+    }
+
+    /**
+     * @param index The age of the message, 0 being the newest one. Must be smaller than size().
+     * @return The message.
+     */
+    inline const console_log& console_log_buffer::operator[](size_t index) const {
+        return entries[(next + entries.size() - 1 - index) % entries.size()];
+    }
 }
 
 
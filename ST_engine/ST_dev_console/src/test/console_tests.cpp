@@ -25,6 +25,10 @@ protected:
         test_cnsl->write(text, type);
     }
 
+    const ST::console_log_buffer& get_entries(){
+        return test_cnsl->entries;
+    }
+
     message_bus* msg_bus{};
 
     void SetUp() override{
@@ -148,6 +152,49 @@ TEST_F(console_test, console_write_all) {
 
 }
 
+TEST_F(console_test, console_entries_newest_first) {
+    ::testing::internal::CaptureStdout();
+    ::testing::internal::CaptureStderr();
+
+    write(ST::log_type::INFO, "TEST_STRING");
+    write(ST::log_type::ERROR, "TEST_STRING2");
+
+    testing::internal::GetCapturedStdout();
+    testing::internal::GetCapturedStderr();
+    ASSERT_EQ(2, get_entries().size());
+    ASSERT_EQ("TEST_STRING2", get_entries()[0].text);
+    ASSERT_EQ(ST::log_type::ERROR, get_entries()[0].type);
+    ASSERT_EQ("TEST_STRING", get_entries()[1].text);
+    ASSERT_EQ(ST::log_type::INFO, get_entries()[1].type);
+}
+
+TEST_F(console_test, console_entries_replace_oldest) {
+    ::testing::internal::CaptureStdout();
+
+    for(uint32_t i = 0; i < ST::console_log_buffer::capacity + 5; i++) {
+        write(ST::log_type::INFO, std::to_string(i));
+    }
+
+    testing::internal::GetCapturedStdout();
+    ASSERT_EQ(ST::console_log_buffer::capacity, get_entries().size());
+    ASSERT_EQ(std::to_string(ST::console_log_buffer::capacity + 4), get_entries()[0].text);
+    ASSERT_EQ("5", get_entries()[ST::console_log_buffer::capacity - 1].text);
+}
+
+TEST_F(console_test, console_clear) {
+    ::testing::internal::CaptureStdout();
+    write(ST::log_type::INFO, "TEST_STRING");
+    write(ST::log_type::INFO, "TEST_STRING2");
+
+    msg_bus->send_msg(new message(CONSOLE_CLEAR));
+    test_cnsl->update();
+    write(ST::log_type::INFO, "TEST_STRING3");
+
+    testing::internal::GetCapturedStdout();
+    ASSERT_EQ(1, get_entries().size());
+    ASSERT_EQ("TEST_STRING3", get_entries()[0].text);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
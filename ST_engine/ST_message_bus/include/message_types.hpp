@@ -136,6 +136,14 @@ enum msg_type : uint8_t {
      */
     UNLOAD_LIST,
 
+    /**
+     * data must contain a std::string created with make_data() - the path of the list being loaded.
+     * base_data0 must be set. The first 16 bits must describe the number of assets loaded so far.
+     * The last 16 bits must describe the total number of assets in the list.
+     * The list is fully loaded (and its assets sent to the subsystems) once both values are equal.
+     */
+    LOAD_LIST_PROGRESS,
+
     /**
      * data must contain a ska::bytell_hash_map<uint16_t, SDL_Surface *>** created with make_data()
      */
@@ -156,6 +164,37 @@ enum msg_type : uint8_t {
      */
     MUSIC_ASSETS,
 
+    /**
+     * data must contain a ST::assets_delta created with make_data()
+     * Only the assets that were loaded or unloaded, sent instead of the full maps above once those are known.
+     * base_data0 is the number of the delta, counting from 1.
+     */
+    ASSETS_DELTA,
+
+    /**
+     * base_data0 must contain the number of the last ASSETS_DELTA that was applied.
+     * The assets unloaded in it and the deltas before it are no longer used and can be freed.
+     */
+    ASSETS_DELTA_APPLIED,
+
+    /**
+     * data must contain a std::vector<ST::asset_handle<SDL_Surface>> created with make_data()
+     * The surfaces that were uploaded to the GPU, they are not needed anymore and can be freed.
+     */
+    RELEASE_SURFACES,
+
+    /**
+     * data must contain a std::vector<uint16_t> created with make_data()
+     * The hashes of the names of the surfaces that have to be uploaded again, as their textures were evicted.
+     */
+    RELOAD_SURFACES,
+
+    /**
+     * base_data0 must be set. The first 16 bits must describe the texture budget in megabytes (0 for no budget).
+     * The last 16 bits must describe the number of frames a texture must not be drawn for before it can be evicted.
+     */
+    SET_TEXTURE_BUDGET,
+
     /**
      * base_data0 must be set and interpreted as type ST::key
      */
@@ -265,6 +304,13 @@ enum msg_type : uint8_t {
      */
     SHOW_FPS,
 
+    /**
+     * base_data0 must be set. The first 16 bits must describe the time spent collecting Lua garbage in the last frame
+     * in microseconds. The last 16 bits must describe the size of the Lua heap in kilobytes.
+     * Both are capped at 65535.
+     */
+    LUA_GC_STATS,
+
     /**
      * base_data0 must be set and interpreted as a boolean value.
      */
@@ -311,6 +357,18 @@ enum msg_type : uint8_t {
      */
     LOAD_BINARY,
 
+    /**
+     * data must contain a std::pair<std::string, std::string> created with make_data()
+     * The path to the binary and the name of the asset inside it.
+     */
+    LOAD_BINARY_ASSET,
+
+    /**
+     * data must contain a std::pair<std::string, std::string> created with make_data()
+     * The path to the binary and the name of the asset inside it.
+     */
+    UNLOAD_BINARY_ASSET,
+
     /**
      * base_data0 must be set. The first 16 bits must describe the width.
      * The last 16 bits must describe the height.
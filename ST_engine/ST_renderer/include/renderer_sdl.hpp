@@ -14,6 +14,8 @@
 #include <SDL_ttf.h>
 #include <ST_util/bytell_hash_map.hpp>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <stdexcept>
 
 ///The renderer for the engine.
@@ -46,18 +48,47 @@ namespace ST::renderer_sdl {
 
     void draw_rectangle_filled(int32_t x, int32_t y, int32_t w, int32_t h, SDL_Color color);
 
+    void draw_lightmap(const std::vector<uint8_t>& lightmap, uint16_t lightmap_width, uint16_t lightmap_height, uint8_t cell_size,
+                       int32_t x, int32_t y);
+
+    bool begin_chunk(uint64_t id, uint16_t size);
+
+    void end_chunk();
+
+    bool draw_chunk(uint64_t id, int32_t x, int32_t y);
+
+    void remove_chunk(uint64_t id);
+
     void draw_sprite(uint16_t arg, int32_t x, int32_t y, uint8_t sprite, uint8_t animation, uint8_t animation_num, uint8_t sprite_num);
 
     void draw_sprite_scaled(uint16_t arg, int32_t x, int32_t y, uint8_t sprite, uint8_t animation, uint8_t animation_num, uint8_t sprite_num, float scale_x, float scale_y);
 
-    uint16_t draw_text_cached_glyphs(uint16_t font, const std::string& arg2, int x, int y, SDL_Color color_font);
+    uint16_t draw_text_cached_glyphs(uint16_t font, std::string_view arg2, int x, int y, SDL_Color color_font);
+
+    uint16_t draw_number_cached_glyphs(uint16_t font, int64_t number, int x, int y, SDL_Color color_font);
 
     uint16_t draw_text_lru_cached(uint16_t font, const std::string& arg2, int x, int y, SDL_Color color_font);
 
+    bool get_text_size(uint16_t font, const std::string& arg, uint16_t& width, uint16_t& height);
+
+    bool render_text(uint32_t id, uint16_t font, const std::string& arg, SDL_Color color_font);
+
+    bool draw_rendered_text(uint32_t id, int32_t x, int32_t y);
+
+    void remove_rendered_text(uint32_t id);
+
     void upload_surfaces(ska::bytell_hash_map<uint16_t, SDL_Surface *> *surfaces);
 
     void upload_fonts(ska::bytell_hash_map<uint16_t, TTF_Font *> *fonts);
 
+    void upload_surface(uint16_t id, SDL_Surface *surface);
+
+    void upload_font(uint16_t id, TTF_Font *font);
+
+    void set_texture_budget(uint64_t budget, uint32_t frames);
+
+    std::vector<uint16_t> get_requested_textures();
+
     void vsync_on();
 
     void vsync_off();
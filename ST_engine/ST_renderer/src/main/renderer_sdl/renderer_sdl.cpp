@@ -10,11 +10,22 @@
 
 #include "font_cache.hpp"
 #include <renderer_sdl.hpp>
+#include <algorithm>
+#include <charconv>
 
 namespace ST::renderer_sdl {
         void cache_font(TTF_Font *Font, uint16_t font_and_size);
+        void destroy_textures();
+        void evict_textures();
     }
 
+///A texture on the GPU along with what is needed to decide when to evict it.
+struct gpu_texture {
+    SDL_Texture* texture = nullptr;
+    uint32_t size = 0; //in bytes
+    uint64_t last_used = 0; //the last frame the texture was drawn in
+};
+
 static SDL_Renderer *sdl_renderer;
 
 //reference to a window
@@ -25,10 +36,44 @@ static int16_t width;
 static int16_t height;
 
 //Textures with no corresponding surface in our assets need to be freed
-static ska::bytell_hash_map<uint16_t, SDL_Texture *> textures{};
+static ska::bytell_hash_map<uint16_t, gpu_texture> textures{};
+
+//Textures that were evicted (or lost when the renderer was recreated) and are requested again once they are drawn
+static ska::bytell_hash_set<uint16_t> evicted_textures{};
+static std::vector<uint16_t> requested_textures{};
+
+//The total size of the textures in bytes and the budget for it, 0 means there is no budget
+static uint64_t textures_size = 0;
+static uint64_t texture_budget = 0;
+
+//Textures drawn in the last texture_budget_frames frames are never evicted
+static uint32_t texture_budget_frames = 0;
+static uint64_t frame = 0;
+
+//While over the budget with nothing to evict, no texture can be evicted before this frame
+static uint64_t next_eviction_frame = 0;
+
+//Textures that were replaced or unloaded, destroyed together once the current frame is presented
+static std::vector<SDL_Texture *> textures_to_destroy{};
+
+//The lightmap is streamed to this texture every frame, it is recreated when the size of the lightmap changes
+static SDL_Texture* lightmap_texture = nullptr;
+static uint16_t lightmap_texture_width = 0;
+static uint16_t lightmap_texture_height = 0;
+static std::vector<uint32_t> lightmap_pixels{};
+
+//Pre-rendered chunks of the level (render targets), each one is drawn with a single copy
+static ska::bytell_hash_map<uint64_t, SDL_Texture *> chunks{};
+
+///Text rendered by render_text(), empty text is rendered but has no texture.
+struct rendered_text {
+    SDL_Texture* texture = nullptr;
+    bool is_rendered = false;
+};
+
+//Retained text, indexed by the ids given to render_text(), each one is drawn with a single copy
+static std::vector<rendered_text> rendered_texts{};
 
-static ska::bytell_hash_map<uint16_t, SDL_Surface *> *surfaces_pointer;
-static ska::bytell_hash_map<uint16_t, TTF_Font *> *fonts_pointer;
 
 
 //the fonts in this table do not need to be cleaned - these are just pointer to Fonts stored in the asset_manager and
@@ -40,6 +85,9 @@ static ska::bytell_hash_map<uint16_t, std::vector<SDL_Texture *>> fonts_cache{};
 
 static bool vsync = false;
 
+//the texture formats the renderer supports natively
+static SDL_RendererInfo renderer_info{};
+
 static bool singleton_initialized = false;
 
 /**
@@ -67,6 +115,7 @@ int8_t ST::renderer_sdl::initialize(SDL_Window* r_window, int16_t r_width, int16
     }else{
         sdl_renderer = SDL_CreateRenderer( window, -1, SDL_RENDERER_ACCELERATED);
     }
+    SDL_GetRendererInfo(sdl_renderer, &renderer_info);
     SDL_RenderSetLogicalSize(sdl_renderer, width, height);
     SDL_SetRenderDrawBlendMode(sdl_renderer, SDL_BLENDMODE_BLEND);
     SDL_SetHint( SDL_HINT_RENDER_SCALE_QUALITY, "1" ); //Linear texture filtering
@@ -90,12 +139,31 @@ void ST::renderer_sdl::close(){
             it.second = nullptr;
         }
     }
+    fonts_cache.clear();
     for ( auto& it : textures){
-        if(it.second != nullptr ){
-            SDL_DestroyTexture(textures[it.first]);
-            it.second = nullptr;
+        if(it.second.texture != nullptr ){
+            SDL_DestroyTexture(it.second.texture);
+        }
+    }
+    textures.clear();
+    textures_size = 0;
+    if(lightmap_texture != nullptr){
+        SDL_DestroyTexture(lightmap_texture);
+        lightmap_texture = nullptr;
+    }
+    for(auto& it : chunks){
+        SDL_DestroyTexture(it.second);
+    }
+    chunks.clear();
+    for(auto& it : rendered_texts){
+        if(it.texture != nullptr){
+            SDL_DestroyTexture(it.texture);
         }
     }
+    rendered_texts.clear();
+    evicted_textures.clear();
+    requested_textures.clear();
+    destroy_textures();
     font_cache::clear();
     font_cache::close();
     SDL_DestroyRenderer(sdl_renderer);
@@ -103,6 +171,25 @@ void ST::renderer_sdl::close(){
     singleton_initialized = false;
 }
 
+/**
+ * Measures text the way draw_text_lru_cached() would draw it, without rendering anything.
+ * @param font The font to measure with.
+ * @param arg The text to measure.
+ * @param width Set to the width of the text in pixels.
+ * @param height Set to the height of the text in pixels.
+ * @return False if the font isn't loaded (yet) or the text can't be measured.
+ */
+bool ST::renderer_sdl::get_text_size(uint16_t font, const std::string& arg, uint16_t& width, uint16_t& height){
+    auto found = fonts.find(font);
+    int32_t texW, texH;
+    if(found == fonts.end() || found->second == nullptr || TTF_SizeUTF8(found->second, arg.c_str(), &texW, &texH) != 0){
+        return false;
+    }
+    width = static_cast<uint16_t>(texW);
+    height = static_cast<uint16_t>(texH);
+    return true;
+}
+
 /**
  * Text rendering method for non-ASCII text -- works with cyrillic, expanded Latin (Spanish, German, etc..) and I guess all of UTF8
  * @param arg The font to render with.
@@ -153,17 +240,16 @@ uint16_t ST::renderer_sdl::draw_text_lru_cached(uint16_t font, const std::string
  *
  * Note that the font must previously be loaded at the selected size.
  */
-uint16_t ST::renderer_sdl::draw_text_cached_glyphs(uint16_t font, const std::string& arg2, const int x, const int y, const SDL_Color color_font) {
+uint16_t ST::renderer_sdl::draw_text_cached_glyphs(uint16_t font, std::string_view arg2, const int x, const int y, const SDL_Color color_font) {
     int32_t tempX = 0;
     auto cached_vector = fonts_cache.find(font);
     if(cached_vector != fonts_cache.end()) [[likely]] {
-        std::vector<SDL_Texture*> tempVector = cached_vector->second;
+        const std::vector<SDL_Texture*>& tempVector = cached_vector->second;
         if(!tempVector.empty()) [[likely]] {
             int32_t texW, texH;
             tempX = x;
-            const char* arg3 = arg2.c_str();
-            for(int j = 0; arg3[j] != 0; j++){
-                SDL_Texture* texture = tempVector.at(static_cast<unsigned int>(arg3[j]-32));
+            for(char j : arg2){
+                SDL_Texture* texture = tempVector.at(static_cast<unsigned int>(j-32));
                 SDL_QueryTexture(texture, nullptr, nullptr, &texW, &texH);
                 SDL_Rect Rect = {tempX, y - texH, texW, texH};
                 SDL_SetTextureColorMod(texture, color_font.r, color_font.g, color_font.b);
@@ -175,25 +261,147 @@ uint16_t ST::renderer_sdl::draw_text_cached_glyphs(uint16_t font, const std::str
     return static_cast<uint16_t>(tempX - x);
 }
 
+/**
+ * Draws a number using cached glyphs, see draw_text_cached_glyphs().
+ * The number is formatted on the stack, so nothing is allocated.
+ * @param font The font to render with.
+ * @param number The number to render.
+ * @param x The x position to render at.
+ * @param y The y position to render at.
+ * @param color_font The color to render with.
+ * @return The width of the rendered number in pixels
+ */
+uint16_t ST::renderer_sdl::draw_number_cached_glyphs(uint16_t font, int64_t number, int x, int y, SDL_Color color_font) {
+    char buffer[20]; //the longest int64_t is 19 digits and a sign
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+    return draw_text_cached_glyphs(font, std::string_view(buffer, static_cast<size_t>(result.ptr - buffer)), x, y, color_font);
+}
+
+/**
+ * Creates a texture from a surface.
+ * Surfaces that are already in a format the renderer supports (such as the pre-decoded textures from asset packs)
+ * are copied straight to the GPU, everything else is converted by SDL first.
+ * @param surface The surface to create the texture from.
+ * @return The new texture or nullptr on failure.
+ */
+static SDL_Texture* create_texture(SDL_Surface* surface){
+    if(surface->format->palette == nullptr && !SDL_HasColorKey(surface) && !SDL_MUSTLOCK(surface)){
+        for(uint32_t i = 0; i < renderer_info.num_texture_formats; i++){
+            if(renderer_info.texture_formats[i] != surface->format->format){
+                continue;
+            }
+            SDL_Texture* texture = SDL_CreateTexture(sdl_renderer, surface->format->format, SDL_TEXTUREACCESS_STATIC, surface->w, surface->h);
+            if(texture == nullptr){
+                break;
+            }
+            SDL_UpdateTexture(texture, nullptr, surface->pixels, surface->pitch);
+            if(SDL_ISPIXELFORMAT_ALPHA(surface->format->format)){
+                SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+            }
+            return texture;
+        }
+    }
+    return SDL_CreateTextureFromSurface(sdl_renderer, surface);
+}
+
 /**
  * Upload all surface to the GPU. (Create textures from them).
  * @param surfaces The surfaces to upload.
  */
 void ST::renderer_sdl::upload_surfaces(ska::bytell_hash_map<uint16_t, SDL_Surface*>* surfaces){
 	if(surfaces != nullptr){
-		surfaces_pointer = surfaces;
         for ( auto& it : *surfaces){
-            if(it.second == nullptr && textures[it.first] != nullptr){
-                SDL_DestroyTexture(textures[it.first]);
-                textures[it.first] = nullptr;
-            }
-            else if(it.second != nullptr){
-                    if(textures[it.first] != nullptr){
-                    SDL_DestroyTexture(textures[it.first]);
-                    textures[it.first] = nullptr;
-                }
-                textures[it.first] = SDL_CreateTextureFromSurface(sdl_renderer, it.second);
-            }
+            upload_surface(it.first, it.second);
+        }
+    }
+}
+
+/**
+ * Upload a single surface to the GPU, replacing the texture with the same id.
+ * The replaced texture is destroyed once the current frame is presented, as destroying a texture
+ * in the middle of a frame forces SDL to flush its batched draw calls.
+ * The surface is not needed by the renderer after this and can be freed.
+ * @param id The hash of the name of the surface.
+ * @param surface The surface to upload, nullptr to only remove the texture.
+ */
+void ST::renderer_sdl::upload_surface(uint16_t id, SDL_Surface* surface){
+    auto texture = textures.find(id);
+    if(texture != textures.end()){
+        if(texture->second.texture != nullptr){
+            textures_to_destroy.emplace_back(texture->second.texture);
+        }
+        textures_size -= texture->second.size;
+        textures.erase(texture);
+    }
+    evicted_textures.erase(id);
+    if(surface != nullptr){
+        gpu_texture uploaded;
+        uploaded.texture = create_texture(surface);
+        if(uploaded.texture != nullptr){
+            uint32_t format;
+            int tex_w, tex_h;
+            SDL_QueryTexture(uploaded.texture, &format, nullptr, &tex_w, &tex_h);
+            uploaded.size = static_cast<uint32_t>(tex_w * tex_h * SDL_BYTESPERPIXEL(format));
+        }
+        //a texture that was just uploaded counts as used, otherwise it could be evicted before it is ever drawn
+        uploaded.last_used = frame;
+        textures_size += uploaded.size;
+        textures[id] = uploaded;
+    }
+}
+
+/**
+ * Sets a budget for the memory used by textures.
+ * Once the textures take more than the budget, the least recently drawn ones are evicted until they fit again.
+ * Evicted textures are requested again (see get_requested_textures()) the next time they are drawn.
+ * @param budget The budget in bytes, 0 for no budget.
+ * @param frames Textures drawn in this many of the last frames are never evicted.
+ */
+void ST::renderer_sdl::set_texture_budget(uint64_t budget, uint32_t frames){
+    texture_budget = budget;
+    texture_budget_frames = frames;
+    next_eviction_frame = 0;
+}
+
+/**
+ * Get the textures that were drawn after they were evicted, they have to be uploaded again.
+ * Each texture is only returned once after it is evicted.
+ * @return The hashes of the names of the textures.
+ */
+std::vector<uint16_t> ST::renderer_sdl::get_requested_textures(){
+    std::vector<uint16_t> requested;
+    requested.swap(requested_textures);
+    return requested;
+}
+
+/**
+ * Evicts the least recently drawn textures until the textures fit in the budget.
+ * Textures drawn in the last texture_budget_frames frames are kept even if that is not enough.
+ */
+void ST::renderer_sdl::evict_textures(){
+    std::vector<std::pair<uint64_t, uint16_t>> unused;
+    for(const auto& it : textures){
+        if(frame - it.second.last_used > texture_budget_frames){
+            unused.emplace_back(it.second.last_used, it.first);
+        }
+    }
+    std::sort(unused.begin(), unused.end());
+    for(const auto& it : unused){
+        if(textures_size <= texture_budget){
+            break;
+        }
+        auto texture = textures.find(it.second);
+        SDL_DestroyTexture(texture->second.texture);
+        textures_size -= texture->second.size;
+        textures.erase(texture);
+        evicted_textures.insert(it.second);
+    }
+    //the textures left were all drawn recently, the oldest of them is the first one that can be evicted
+    next_eviction_frame = 0;
+    if(textures_size > texture_budget){
+        next_eviction_frame = UINT64_MAX;
+        for(const auto& it : textures){
+            next_eviction_frame = std::min(next_eviction_frame, it.second.last_used + texture_budget_frames + 1);
         }
     }
 }
@@ -203,28 +411,39 @@ void ST::renderer_sdl::upload_surfaces(ska::bytell_hash_map<uint16_t, SDL_Surfac
  */
 void ST::renderer_sdl::upload_fonts(ska::bytell_hash_map<uint16_t, TTF_Font*>* fonts_t){
     if(fonts_t != nullptr){
-		fonts_pointer = fonts_t;
         for ( auto& it : *fonts_t){
-            if(it.second == nullptr){
-                for(auto& k : fonts_cache[it.first]){
-                    SDL_DestroyTexture(k);
-                }
-                fonts[it.first] = nullptr;
-            }
-            else if(it.second != nullptr){
-                if(fonts[it.first] != nullptr){
-                    for(auto& k : fonts_cache[it.first]){
-                        SDL_DestroyTexture(k);
-                    }
-                    fonts[it.first] = nullptr;
-                }
-                fonts[it.first] = it.second;
-                cache_font(fonts[it.first], it.first);
-            }
+            upload_font(it.first, it.second);
         }
     }
 }
 
+/**
+ * Upload a single font to the GPU (cache its glyphs), replacing the font with the same id.
+ * @param id The hash of the name and size of the font.
+ * @param font The font to upload, nullptr to only remove the font.
+ */
+void ST::renderer_sdl::upload_font(uint16_t id, TTF_Font* font){
+    auto cached = fonts_cache.find(id);
+    if(cached != fonts_cache.end()){
+        textures_to_destroy.insert(textures_to_destroy.end(), cached->second.begin(), cached->second.end());
+        fonts_cache.erase(cached);
+    }
+    fonts[id] = font;
+    if(font != nullptr){
+        cache_font(font, id);
+    }
+}
+
+/**
+ * Destroys the textures that were replaced or unloaded since the last frame.
+ */
+void ST::renderer_sdl::destroy_textures(){
+    for(auto texture : textures_to_destroy){
+        SDL_DestroyTexture(texture);
+    }
+    textures_to_destroy.clear();
+}
+
 /**
  * Caches all glyphs of a font at a given size.
  * Works with the draw_text_cached method.
@@ -248,6 +467,30 @@ void ST::renderer_sdl::cache_font(TTF_Font* Font, uint16_t font_and_size){
     fonts_cache[font_and_size] = tempVector;
 }
 
+/**
+ * Recreates the renderer along with all textures and fonts.
+ * All textures are requested again (see get_requested_textures()) the next time they are drawn, the surfaces are
+ * owned by the assets_manager and can't be read here as it may be freeing or reloading them at the same time.
+ */
+static void reinitialize(){
+    std::vector<uint16_t> uploaded;
+    uploaded.reserve(textures.size());
+    for(const auto& it : textures){
+        uploaded.emplace_back(it.first);
+    }
+    uploaded.insert(uploaded.end(), evicted_textures.begin(), evicted_textures.end());
+    //the renderer's own copy of the font pointers, close() clears it
+    ska::bytell_hash_map<uint16_t, TTF_Font *> uploaded_fonts = fonts;
+    ST::renderer_sdl::close();
+    ST::renderer_sdl::initialize(window, width, height);
+    evicted_textures.insert(uploaded.begin(), uploaded.end());
+    for(const auto& it : uploaded_fonts){
+        if(it.second != nullptr){
+            ST::renderer_sdl::upload_font(it.first, it.second);
+        }
+    }
+}
+
 /**
  * Turns on vsync.
  */
@@ -256,10 +499,7 @@ void ST::renderer_sdl::vsync_on(){
     SDL_GetRendererInfo(sdl_renderer, &info);
     if(!(info.flags & SDL_RENDERER_PRESENTVSYNC)){ // NOLINT(hicpp-signed-bitwise)
         vsync = true;
-        close();
-        initialize(window, width, height);
-        upload_surfaces(surfaces_pointer);
-        upload_fonts(fonts_pointer);
+        reinitialize();
     }
 }
 
@@ -271,15 +511,30 @@ void ST::renderer_sdl::vsync_off(){
     SDL_GetRendererInfo(sdl_renderer, &info);
     if(info.flags & SDL_RENDERER_PRESENTVSYNC){ // NOLINT(hicpp-signed-bitwise)
         vsync = false;
-        close();
-        initialize(window, width, height);
-        upload_surfaces(surfaces_pointer);
-        upload_fonts(fonts_pointer);
+        reinitialize();
     }
 }
 
 //INLINED METHODS
 
+/**
+ * Get the texture to draw and mark it as used in the current frame.
+ * An evicted texture is requested again and nothing is drawn until it is uploaded.
+ * @param id The hash of the texture name.
+ * @return The texture or nullptr if there is none.
+ */
+static inline SDL_Texture* use_texture(uint16_t id){
+    auto data = textures.find(id);
+    if(data != textures.end()) [[likely]] {
+        data->second.last_used = frame;
+        return data->second.texture;
+    }
+    if(evicted_textures.erase(id) > 0){
+        requested_textures.emplace_back(id);
+    }
+    return nullptr;
+}
+
 /**
  * Draw a texture at a given position.
  * @param arg The hash of the texture name.
@@ -287,8 +542,7 @@ void ST::renderer_sdl::vsync_off(){
  * @param y The Y position to render at.
  */
 void ST::renderer_sdl::draw_texture(const uint16_t arg, int32_t x, int32_t y) {
-    auto data = textures.find(arg);
-    auto texture = reinterpret_cast<SDL_Texture*>((data != textures.end())*reinterpret_cast<uint64_t>(data->second));
+    SDL_Texture* texture = use_texture(arg);
     int tex_w, tex_h;
     SDL_QueryTexture(texture, nullptr, nullptr, &tex_w, &tex_h);
     SDL_Rect src_rect = {x, y - tex_h, tex_w, tex_h};
@@ -302,8 +556,7 @@ void ST::renderer_sdl::draw_texture(const uint16_t arg, int32_t x, int32_t y) {
  * @param y The Y position to render at.
  */
 void ST::renderer_sdl::draw_texture_scaled(const uint16_t arg, int32_t x, int32_t y, float scale_x, float scale_y) {
-    auto data = textures.find(arg);
-    auto texture = reinterpret_cast<SDL_Texture*>((data != textures.end())*reinterpret_cast<uint64_t>(data->second));
+    SDL_Texture* texture = use_texture(arg);
     int tex_w, tex_h;
     SDL_QueryTexture(texture, nullptr, nullptr, &tex_w, &tex_h);
     SDL_Rect dst_rect = {x,
@@ -328,6 +581,174 @@ void ST::renderer_sdl::draw_rectangle_filled(int32_t x, int32_t y, int32_t w, in
     SDL_SetRenderDrawColor(sdl_renderer, 0, 0, 0, 255);
 }
 
+/**
+ * Draws a lightmap over the screen.
+ * The lightmap is uploaded to a streaming texture and drawn with a single scaled copy in modulate blend mode,
+ * so each cell darkens the part of the screen it covers.
+ * @param lightmap The darkness of each cell of the lightmap row by row, from 0 (lit) to 255 (black).
+ * @param lightmap_width The width of the lightmap in cells.
+ * @param lightmap_height The height of the lightmap in cells.
+ * @param cell_size The width and height of a cell on the screen.
+ * @param x The X position of the top left corner of the lightmap on the screen.
+ * @param y The Y position of the top left corner of the lightmap on the screen.
+ */
+void ST::renderer_sdl::draw_lightmap(const std::vector<uint8_t>& lightmap, uint16_t lightmap_width, uint16_t lightmap_height, uint8_t cell_size,
+                                     int32_t x, int32_t y) {
+    if(lightmap_texture == nullptr || lightmap_texture_width != lightmap_width || lightmap_texture_height != lightmap_height){
+        if(lightmap_texture != nullptr){
+            SDL_DestroyTexture(lightmap_texture);
+        }
+        lightmap_texture = SDL_CreateTexture(sdl_renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, lightmap_width, lightmap_height);
+        if(lightmap_texture == nullptr){
+            return;
+        }
+        SDL_SetTextureBlendMode(lightmap_texture, SDL_BLENDMODE_MOD);
+        lightmap_texture_width = lightmap_width;
+        lightmap_texture_height = lightmap_height;
+    }
+    lightmap_pixels.resize(lightmap.size());
+    std::transform(lightmap.begin(), lightmap.end(), lightmap_pixels.begin(), [](uint8_t darkness){
+        return 0xff000000U | static_cast<uint32_t>(255 - darkness) * 0x00010101U;
+    });
+    SDL_UpdateTexture(lightmap_texture, nullptr, lightmap_pixels.data(), lightmap_width * static_cast<int32_t>(sizeof(uint32_t)));
+    SDL_Rect dst = {x, y, lightmap_width * cell_size, lightmap_height * cell_size};
+    SDL_RenderCopy(sdl_renderer, lightmap_texture, nullptr, &dst);
+}
+
+/**
+ * Starts rendering a chunk - everything drawn until end_chunk() is drawn in the texture of the chunk instead of on
+ * the screen, at coordinates relative to the chunk.
+ * The texture is created the first time a chunk is rendered and is cleared to transparent every time after that.
+ * @param id The id of the chunk.
+ * @param size The width and height of the chunk, only used when the texture is created.
+ * @return True if the chunk can be rendered, false if the renderer doesn't support rendering to textures.
+ */
+bool ST::renderer_sdl::begin_chunk(uint64_t id, uint16_t size) {
+    SDL_Texture*& texture = chunks[id];
+    if(texture == nullptr){
+        texture = SDL_CreateTexture(sdl_renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, size, size);
+        if(texture == nullptr){
+            chunks.erase(id);
+            return false;
+        }
+        //the colors in the chunk are already multiplied by their alpha when drawn in it
+        SDL_SetTextureBlendMode(texture, SDL_ComposeCustomBlendMode(
+                SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD,
+                SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD));
+    }
+    if(SDL_SetRenderTarget(sdl_renderer, texture) != 0){
+        return false;
+    }
+    uint8_t r, g, b, a;
+    SDL_GetRenderDrawColor(sdl_renderer, &r, &g, &b, &a);
+    SDL_SetRenderDrawColor(sdl_renderer, 0, 0, 0, 0);
+    SDL_RenderClear(sdl_renderer);
+    SDL_SetRenderDrawColor(sdl_renderer, r, g, b, a);
+    return true;
+}
+
+/**
+ * Finishes rendering a chunk, see begin_chunk().
+ */
+void ST::renderer_sdl::end_chunk() {
+    SDL_SetRenderTarget(sdl_renderer, nullptr);
+}
+
+/**
+ * Draws a chunk that was rendered before.
+ * Chunks are lost when the renderer is recreated and have to be rendered again.
+ * @param id The id of the chunk.
+ * @param x The X position to render at.
+ * @param y The Y position to render at.
+ * @return False if there is no such chunk.
+ */
+bool ST::renderer_sdl::draw_chunk(uint64_t id, int32_t x, int32_t y) {
+    auto chunk = chunks.find(id);
+    if(chunk == chunks.end()){
+        return false;
+    }
+    int tex_w, tex_h;
+    SDL_QueryTexture(chunk->second, nullptr, nullptr, &tex_w, &tex_h);
+    SDL_Rect dst = {x, y, tex_w, tex_h};
+    SDL_RenderCopy(sdl_renderer, chunk->second, nullptr, &dst);
+    return true;
+}
+
+/**
+ * Removes a chunk, its texture is destroyed once the current frame is presented.
+ * @param id The id of the chunk.
+ */
+void ST::renderer_sdl::remove_chunk(uint64_t id) {
+    auto chunk = chunks.find(id);
+    if(chunk != chunks.end()){
+        textures_to_destroy.emplace_back(chunk->second);
+        chunks.erase(chunk);
+    }
+}
+
+/**
+ * Renders text in a texture that is kept until the text is rendered again with the same id or removed.
+ * Unlike draw_text_lru_cached() nothing is hashed or looked up when the text is drawn.
+ * @param id The id of the text, ids should be small as they index a vector.
+ * @param font The font to render with.
+ * @param arg The text to render.
+ * @param color_font The color to render with.
+ * @return False if the font isn't loaded (yet).
+ */
+bool ST::renderer_sdl::render_text(uint32_t id, uint16_t font, const std::string& arg, SDL_Color color_font) {
+    auto found = fonts.find(font);
+    if(found == fonts.end() || found->second == nullptr){
+        return false;
+    }
+    remove_rendered_text(id);
+    if(id >= rendered_texts.size()){
+        rendered_texts.resize(id + 1);
+    }
+    //empty text can't be rendered, it is kept without a texture and never drawn
+    SDL_Surface* text = TTF_RenderUTF8_Blended(found->second, arg.c_str(), color_font);
+    if(text != nullptr){
+        rendered_texts[id].texture = SDL_CreateTextureFromSurface(sdl_renderer, text);
+        SDL_FreeSurface(text);
+    }
+    rendered_texts[id].is_rendered = true;
+    return true;
+}
+
+/**
+ * Draws text that was rendered with render_text().
+ * Rendered text is lost when the renderer is recreated and has to be rendered again.
+ * @param id The id of the text.
+ * @param x The x position to render at.
+ * @param y The y position to render at (the bottom of the text).
+ * @return False if there is no such rendered text.
+ */
+bool ST::renderer_sdl::draw_rendered_text(uint32_t id, int32_t x, int32_t y) {
+    if(id >= rendered_texts.size() || !rendered_texts[id].is_rendered) [[unlikely]] {
+        return false;
+    }
+    SDL_Texture* texture = rendered_texts[id].texture;
+    if(texture != nullptr) [[likely]] {
+        int tex_w, tex_h;
+        SDL_QueryTexture(texture, nullptr, nullptr, &tex_w, &tex_h);
+        SDL_Rect dst = {x, y - tex_h, tex_w, tex_h};
+        SDL_RenderCopy(sdl_renderer, texture, nullptr, &dst);
+    }
+    return true;
+}
+
+/**
+ * Removes rendered text, its texture is destroyed once the current frame is presented.
+ * @param id The id of the text.
+ */
+void ST::renderer_sdl::remove_rendered_text(uint32_t id) {
+    if(id < rendered_texts.size()){
+        if(rendered_texts[id].texture != nullptr){
+            textures_to_destroy.emplace_back(rendered_texts[id].texture);
+        }
+        rendered_texts[id] = rendered_text{};
+    }
+}
+
 /**
  * Draws a rectangle on the screen.
  * @param x The X position to draw at.
@@ -348,8 +769,7 @@ void ST::renderer_sdl::draw_rectangle(int32_t x, int32_t y, int32_t w, int32_t h
  * @param arg The hash of the texture name.
  */
 void ST::renderer_sdl::draw_background(const uint16_t arg) {
-    auto data = textures.find(arg);
-    auto texture = reinterpret_cast<SDL_Texture*>((data != textures.end())*reinterpret_cast<uint64_t>(data->second));
+    SDL_Texture* texture = use_texture(arg);
     SDL_RenderCopy(sdl_renderer, texture, nullptr, nullptr);
 }
 
@@ -358,8 +778,7 @@ void ST::renderer_sdl::draw_background(const uint16_t arg) {
  * @param offset The offset in the texture for the parallax effect
  */
 void ST::renderer_sdl::draw_background_parallax(const uint16_t arg, const uint16_t offset) {
-    auto data = textures.find(arg);
-    auto texture = reinterpret_cast<SDL_Texture*>((data != textures.end())*reinterpret_cast<uint64_t>(data->second));
+    SDL_Texture* texture = use_texture(arg);
 
     int tex_w, tex_h;
     SDL_QueryTexture(texture, nullptr, nullptr, &tex_w, &tex_h);
@@ -386,8 +805,7 @@ void ST::renderer_sdl::draw_background_parallax(const uint16_t arg, const uint16
  * @param sprite_num The total number of sprites in a spritesheet. (Columns in a spritesheet).
  */
 void ST::renderer_sdl::draw_sprite(uint16_t arg, int32_t x, int32_t y, uint8_t sprite, uint8_t animation, uint8_t animation_num, uint8_t sprite_num) {
-    auto data = textures.find(arg);
-    auto texture = reinterpret_cast<SDL_Texture*>((data != textures.end())*reinterpret_cast<uint64_t>(data->second));
+    SDL_Texture* texture = use_texture(arg);
 
     int tex_w, tex_h;
     SDL_QueryTexture(texture, nullptr, nullptr, &tex_w, &tex_h);
@@ -409,8 +827,7 @@ void ST::renderer_sdl::draw_sprite(uint16_t arg, int32_t x, int32_t y, uint8_t s
  * @param sprite_num The total number of sprites in a spritesheet. (Columns in a spritesheet).
  */
 void ST::renderer_sdl::draw_sprite_scaled(uint16_t arg, int32_t x, int32_t y, uint8_t sprite, uint8_t animation, uint8_t animation_num, uint8_t sprite_num, float scale_x, float scale_y) {
-    auto data = textures.find(arg);
-    auto texture = reinterpret_cast<SDL_Texture*>((data != textures.end())*reinterpret_cast<uint64_t>(data->second));
+    SDL_Texture* texture = use_texture(arg);
 
     int tex_w, tex_h;
     SDL_QueryTexture(texture, nullptr, nullptr, &tex_w, &tex_h);
@@ -433,8 +850,7 @@ void ST::renderer_sdl::draw_sprite_scaled(uint16_t arg, int32_t x, int32_t y, ui
  * @param sprite_num The total number of frames this spritesheet has.
  */
 void ST::renderer_sdl::draw_overlay(uint16_t arg, uint8_t sprite, uint8_t sprite_num) {
-    auto data = textures.find(arg);
-    auto texture = reinterpret_cast<SDL_Texture*>((data != textures.end())*reinterpret_cast<uint64_t>(data->second));
+    SDL_Texture* texture = use_texture(arg);
 
     int32_t tex_w, tex_h;
     SDL_QueryTexture(texture, nullptr, nullptr, &tex_w, &tex_h);
@@ -474,6 +890,13 @@ void ST::renderer_sdl::set_draw_color(uint8_t r, uint8_t g, uint8_t b, uint8_t a
  */
 void ST::renderer_sdl::present() {
     SDL_RenderPresent(sdl_renderer);
+    if(!textures_to_destroy.empty()){
+        destroy_textures();
+    }
+    ++frame;
+    if(texture_budget != 0 && textures_size > texture_budget && frame >= next_eviction_frame){
+        evict_textures();
+    }
 }
 
 /**
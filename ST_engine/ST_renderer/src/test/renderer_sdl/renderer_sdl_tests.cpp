@@ -157,6 +157,116 @@ TEST_F(renderer_sdl_tests, test_draw_texture){
     SDL_Delay(wait_duration);
 }
 
+TEST_F(renderer_sdl_tests, test_upload_single_surface){
+    SDL_Surface* test_surface = IMG_Load("test_image_1.png");
+    ASSERT_TRUE(static_cast<bool>(test_surface));
+    ST::renderer_sdl::upload_surface(1, test_surface);
+    ST::renderer_sdl::draw_texture(1, 300, 300);
+    ST::renderer_sdl::present();
+    //Replacing and removing the texture in the middle of a frame destroys the old one only after it is presented
+    ST::renderer_sdl::upload_surface(1, test_surface);
+    ST::renderer_sdl::draw_texture(1, 800, 300);
+    ST::renderer_sdl::upload_surface(1, nullptr);
+    ST::renderer_sdl::draw_texture(1, 300, 700);
+    ST::renderer_sdl::present();
+    SDL_Delay(wait_duration);
+    SDL_FreeSurface(test_surface);
+}
+
+TEST_F(renderer_sdl_tests, test_texture_budget){
+    SDL_Surface* test_surface = IMG_Load("test_image_1.png");
+    ASSERT_TRUE(static_cast<bool>(test_surface));
+    ST::renderer_sdl::upload_surface(1, test_surface);
+    ST::renderer_sdl::upload_surface(2, test_surface);
+    ST::renderer_sdl::set_texture_budget(1, 1);
+
+    //Only the texture that wasn't drawn in the last frame is evicted, even though both don't fit
+    for(uint8_t i = 0; i < 2; i++) {
+        ST::renderer_sdl::draw_texture(1, 300, 300);
+        ST::renderer_sdl::present();
+    }
+    ST::renderer_sdl::draw_texture(2, 800, 300);
+    ASSERT_EQ(std::vector<uint16_t>{2}, ST::renderer_sdl::get_requested_textures());
+    ASSERT_TRUE(ST::renderer_sdl::get_requested_textures().empty());
+
+    //Once it is uploaded again it can be drawn
+    ST::renderer_sdl::upload_surface(2, test_surface);
+    ST::renderer_sdl::draw_texture(1, 300, 300);
+    ST::renderer_sdl::draw_texture(2, 800, 300);
+    ST::renderer_sdl::present();
+    ASSERT_TRUE(ST::renderer_sdl::get_requested_textures().empty());
+    ST::renderer_sdl::set_texture_budget(0, 0);
+    SDL_Delay(wait_duration);
+    SDL_FreeSurface(test_surface);
+}
+
+TEST_F(renderer_sdl_tests, test_texture_budget_evicts_once_unused){
+    SDL_Surface* test_surface = IMG_Load("test_image_1.png");
+    ASSERT_TRUE(static_cast<bool>(test_surface));
+    ST::renderer_sdl::upload_surface(1, test_surface);
+    ST::renderer_sdl::set_texture_budget(1, 3);
+
+    //The texture doesn't fit but it is drawn every frame so it is kept
+    for(uint8_t i = 0; i < 5; i++) {
+        ST::renderer_sdl::draw_texture(1, 300, 300);
+        ST::renderer_sdl::present();
+    }
+
+    //Once it isn't drawn for more than 3 frames it is evicted
+    for(uint8_t i = 0; i < 3; i++) {
+        ST::renderer_sdl::present();
+    }
+    ST::renderer_sdl::draw_texture(1, 300, 300);
+    ASSERT_EQ(std::vector<uint16_t>{1}, ST::renderer_sdl::get_requested_textures());
+    ST::renderer_sdl::upload_surface(1, nullptr);
+    ST::renderer_sdl::set_texture_budget(0, 0);
+    SDL_FreeSurface(test_surface);
+}
+
+TEST_F(renderer_sdl_tests, test_draw_lightmap){
+    SDL_Surface* test_surface = IMG_Load("test_image_1.png");
+    ASSERT_TRUE(static_cast<bool>(test_surface));
+    ST::renderer_sdl::upload_surface(1, test_surface);
+
+    //A gradient from lit on the left to black on the right
+    uint8_t cell_size = 5;
+    auto lightmap_width = static_cast<uint16_t>(test_window_width / cell_size + 1);
+    auto lightmap_height = static_cast<uint16_t>(test_window_height / cell_size + 1);
+    std::vector<uint8_t> lightmap(static_cast<size_t>(lightmap_width) * lightmap_height);
+    for(uint16_t y = 0; y < lightmap_height; y++){
+        for(uint16_t x = 0; x < lightmap_width; x++){
+            lightmap[y * lightmap_width + x] = static_cast<uint8_t>(x * 255 / lightmap_width);
+        }
+    }
+    ST::renderer_sdl::clear_screen({255, 255, 255, 255});
+    ST::renderer_sdl::draw_texture(1, 300, 300);
+    ST::renderer_sdl::draw_lightmap(lightmap, lightmap_width, lightmap_height, cell_size, 0, 0);
+    ST::renderer_sdl::present();
+    SDL_Delay(wait_duration);
+    SDL_FreeSurface(test_surface);
+}
+
+TEST_F(renderer_sdl_tests, test_draw_chunk){
+    SDL_Surface* test_surface = IMG_Load("test_image_1.png");
+    ASSERT_TRUE(static_cast<bool>(test_surface));
+    ST::renderer_sdl::upload_surface(1, test_surface);
+
+    //Render the texture twice in a chunk, then draw the chunk in two places
+    ASSERT_TRUE(ST::renderer_sdl::begin_chunk(1, 512));
+    ST::renderer_sdl::draw_texture(1, 0, 0);
+    ST::renderer_sdl::draw_texture_scaled(1, 256, 256, 0.5, 0.5);
+    ST::renderer_sdl::end_chunk();
+    ST::renderer_sdl::clear_screen({255, 255, 255, 255});
+    ASSERT_TRUE(ST::renderer_sdl::draw_chunk(1, 100, 100));
+    ASSERT_TRUE(ST::renderer_sdl::draw_chunk(1, 700, 100));
+    ST::renderer_sdl::present();
+
+    ST::renderer_sdl::remove_chunk(1);
+    ASSERT_FALSE(ST::renderer_sdl::draw_chunk(1, 100, 100));
+    SDL_Delay(wait_duration);
+    SDL_FreeSurface(test_surface);
+}
+
 TEST_F(renderer_sdl_tests, test_draw_texture_scaled){
     SDL_Surface* test_surface = IMG_Load("test_image_1.png");
     ASSERT_TRUE(static_cast<bool>(test_surface));
@@ -210,6 +320,24 @@ TEST_F(renderer_sdl_tests, test_draw_font_english_large){
     SDL_Delay(wait_duration);
 }
 
+TEST_F(renderer_sdl_tests, test_draw_number_cached_glyphs){
+    uint8_t font_size = 50;
+    TTF_Font* test_font = TTF_OpenFont("test_font.ttf", font_size);
+    uint16_t font_hash = ST::hash_string("test_font.ttf " + std::to_string(font_size));
+    ASSERT_TRUE(static_cast<bool>(test_font));
+    ska::bytell_hash_map<uint16_t , TTF_Font*> test_assets;
+    test_assets[font_hash] = test_font;
+    ST::renderer_sdl::upload_fonts(&test_assets);
+
+    //A number drawn after a label is as wide as the same text drawn at once
+    uint16_t label_width = ST::renderer_sdl::draw_text_cached_glyphs(font_hash, "fps:", 200, 300, {255, 0, 0, 255});
+    uint16_t number_width = ST::renderer_sdl::draw_number_cached_glyphs(font_hash, -1234567890, 200 + label_width, 300, {255, 0, 0, 255});
+    ASSERT_EQ(ST::renderer_sdl::draw_text_cached_glyphs(font_hash, "fps:-1234567890", 200, 500, {0, 255, 0, 255}), label_width + number_width);
+    ST::renderer_sdl::draw_number_cached_glyphs(font_hash, INT64_MIN, 200, 700, {0, 0, 255, 255});
+    ST::renderer_sdl::present();
+    SDL_Delay(wait_duration);
+}
+
 TEST_F(renderer_sdl_tests, test_draw_font_russian_small){
     uint8_t font_size = 20;
     TTF_Font* test_font = TTF_OpenFont("test_font.ttf", font_size);
@@ -249,6 +377,54 @@ TEST_F(renderer_sdl_tests, test_draw_font_russian_large){
     SDL_Delay(wait_duration);
 }
 
+TEST_F(renderer_sdl_tests, test_draw_rendered_text){
+    uint8_t font_size = 50;
+    TTF_Font* test_font = TTF_OpenFont("test_font.ttf", font_size);
+    uint16_t font_hash = ST::hash_string("test_font.ttf " + std::to_string(font_size));
+    ASSERT_TRUE(static_cast<bool>(test_font));
+    ASSERT_FALSE(ST::renderer_sdl::render_text(0, font_hash, "Этот тест тестирует шрифты!", {255, 0, 0, 255}));
+    ska::bytell_hash_map<uint16_t, TTF_Font*> test_assets;
+    test_assets[font_hash] = test_font;
+    ST::renderer_sdl::upload_fonts(&test_assets);
+
+    //Render two texts, replace the first one and draw both, the empty one isn't drawn
+    ASSERT_TRUE(ST::renderer_sdl::render_text(0, font_hash, "Этот тест тестирует шрифты!", {255, 0, 0, 255}));
+    ASSERT_TRUE(ST::renderer_sdl::render_text(2, font_hash, "The quick brown fox!", {0, 0, 255, 255}));
+    ASSERT_TRUE(ST::renderer_sdl::render_text(0, font_hash, "Этот тест тестирует шрифты!", {0, 255, 0, 255}));
+    ASSERT_TRUE(ST::renderer_sdl::render_text(1, font_hash, "", {0, 255, 0, 255}));
+    ASSERT_TRUE(ST::renderer_sdl::draw_rendered_text(0, 200, 300));
+    ASSERT_TRUE(ST::renderer_sdl::draw_rendered_text(1, 200, 500));
+    ASSERT_TRUE(ST::renderer_sdl::draw_rendered_text(2, 200, 700));
+    ST::renderer_sdl::remove_rendered_text(2);
+    ASSERT_FALSE(ST::renderer_sdl::draw_rendered_text(2, 200, 900));
+    ASSERT_FALSE(ST::renderer_sdl::draw_rendered_text(3, 200, 900));
+    ST::renderer_sdl::present();
+    SDL_Delay(wait_duration);
+}
+
+TEST_F(renderer_sdl_tests, test_rendered_text_lost_on_vsync){
+    uint8_t font_size = 50;
+    TTF_Font* test_font = TTF_OpenFont("test_font.ttf", font_size);
+    uint16_t font_hash = ST::hash_string("test_font.ttf " + std::to_string(font_size));
+    ASSERT_TRUE(static_cast<bool>(test_font));
+    ska::bytell_hash_map<uint16_t, TTF_Font*> test_assets;
+    test_assets[font_hash] = test_font;
+    ST::renderer_sdl::upload_fonts(&test_assets);
+    ASSERT_TRUE(ST::renderer_sdl::render_text(0, font_hash, "The quick brown fox!", {255, 0, 0, 255}));
+    ASSERT_TRUE(ST::renderer_sdl::render_text(1, font_hash, "", {255, 0, 0, 255}));
+
+    //Toggling vsync recreates the renderer, the text is lost but the font is kept so it can be rendered again
+    ST::renderer_sdl::vsync_on();
+    ST::renderer_sdl::vsync_off();
+    ASSERT_FALSE(ST::renderer_sdl::draw_rendered_text(0, 200, 300));
+    ASSERT_FALSE(ST::renderer_sdl::draw_rendered_text(1, 200, 300));
+    ASSERT_TRUE(ST::renderer_sdl::render_text(1, font_hash, "The quick brown fox!", {0, 255, 0, 255}));
+    ASSERT_FALSE(ST::renderer_sdl::draw_rendered_text(0, 200, 300));
+    ASSERT_TRUE(ST::renderer_sdl::draw_rendered_text(1, 200, 300));
+    ST::renderer_sdl::present();
+    SDL_Delay(wait_duration);
+}
+
 TEST_F(renderer_sdl_tests, test_draw_sprite_animated1){
     SDL_Surface* test_surface = IMG_Load("test_sprite.png");
     ASSERT_TRUE(static_cast<bool>(test_surface));
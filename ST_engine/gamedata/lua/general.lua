@@ -8,19 +8,21 @@
 
 local io = require "io"
 
-currentID = 0 --MUST start at 0
-currentTextID = 0 --MUST start at 0
-currentLightID = 0 --MUST start at 0
+--resets the ids of the objects, called by the engine before every level starts
+function resetLevelState()
+    currentID = 0 --MUST start at 0
+    currentTextID = 0 --MUST start at 0
+    currentLightID = 0 --MUST start at 0
+end
+resetLevelState()
 
 currentVolume = 100
 math.randomseed(os.time())
 
 --cleans up current level and start the specifed one
+--the current level keeps running until the new one is streamed in, the ids are reset when the new one starts
 function startLevel(arg)
     startLevelLua(arg)
-    currentID = 0
-    currentLightID = 0
-    currentTextID = 0
     error() --a dirty trick, but it works
 end
 
@@ -29,6 +31,13 @@ function reloadLevel(arg)
     startLevel(arg)
 end
 
+--waits inside a task (see startTask) until the assets of a level are loaded
+function waitForLevelLoaded(level)
+    if getLevelLoadProgress(level) < 100 then
+        waitForSignal("levelLoaded " .. level)
+    end
+end
+
 function exit()
     endGame()
 end
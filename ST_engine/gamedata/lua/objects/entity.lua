@@ -22,6 +22,15 @@ function newEntityID()
     return temp
 end
 
+--collects the IDs of a list of entities, to be used with the batch functions (getEntitiesPosition, setEntitiesPosition...)
+function entityIDs(objects)
+    local ids = {}
+    for i, object in ipairs(objects) do
+        ids[i] = object.ID
+    end
+    return ids
+end
+
 --default constructor for all entities
 function newEntity(self, x, y)
     local o = {}
@@ -16,10 +16,11 @@ static bool singleton_initialized = false;
 /**
  *
  * @param window A pointer to an SDL_Window to bind the renderer to.
- * @param msg_bus A pointer to the global message bus.
- * @param tsk_mngr A pointer to the global task_manager.
+ * @param gMessageBus The global message bus.
+ * @param gTaskManager The global task_manager, lights are processed on its worker threads.
  */
-drawing_manager::drawing_manager(SDL_Window *window, message_bus &gMessageBus) : gMessage_bus(gMessageBus) {
+drawing_manager::drawing_manager(SDL_Window *window, message_bus &gMessageBus, task_manager &gTaskManager) :
+        gMessage_bus(gMessageBus), gTask_manager(gTaskManager) {
 
     if(singleton_initialized){
         throw std::runtime_error("The drawing manager cannot be initialized more than once!");
@@ -37,11 +38,14 @@ drawing_manager::drawing_manager(SDL_Window *window, message_bus &gMessageBus) :
     gMessage_bus.subscribe(SET_VSYNC, &msg_sub);
     gMessage_bus.subscribe(SHOW_COLLISIONS, &msg_sub);
     gMessage_bus.subscribe(SHOW_FPS, &msg_sub);
+    gMessage_bus.subscribe(LUA_GC_STATS, &msg_sub);
     gMessage_bus.subscribe(SET_DARKNESS, &msg_sub);
     gMessage_bus.subscribe(SURFACES_ASSETS, &msg_sub);
     gMessage_bus.subscribe(FONTS_ASSETS, &msg_sub);
+    gMessage_bus.subscribe(ASSETS_DELTA, &msg_sub);
     gMessage_bus.subscribe(ENABLE_LIGHTING, &msg_sub);
     gMessage_bus.subscribe(SET_INTERNAL_RESOLUTION, &msg_sub);
+    gMessage_bus.subscribe(SET_TEXTURE_BUDGET, &msg_sub);
 
     //debug collisions aren't shown by default
     collisions_shown = false;
@@ -50,10 +54,6 @@ drawing_manager::drawing_manager(SDL_Window *window, message_bus &gMessageBus) :
     darkness_level = 0;
     lights_quality = 5;
 
-    //hash of default font
-    default_font_normal = ST::hash_string(DEFAULT_FONT_NORMAL);
-    default_font_small = ST::hash_string(DEFAULT_FONT_SMALL);
-
     //Initialize the rendering object
     ST::renderer_sdl::initialize(window, w_width, w_height);
     uint32_t screen_width_height = w_width | static_cast<uint32_t>(w_height << 16U);
@@ -72,17 +72,23 @@ void drawing_manager::update(const ST::level& temp, double fps, console& cnsl){
     handle_messages();
 
     ticks = SDL_GetTicks(); //CPU ticks since start
+    const std::vector<ST::entity>& entities = temp.entities;
+    if(scenery_enabled){
+        update_scenery(entities);
+    }
     ST::renderer_sdl::clear_screen(temp.background_color);
 
     draw_background(temp.background, temp.parallax_speed);
 
-    std::vector<ST::entity> entities{};
-
     // Filter entities on screen
-    std::copy_if (temp.entities.begin(), temp.entities.end(), std::back_inserter(entities), [this](ST::entity e) {
-        return is_onscreen(e);
-    });
+    temp.entity_index.query(camera.x, camera.y, w_width, w_height, visible_entities);
+    visible_entities.erase(std::remove_if(visible_entities.begin(), visible_entities.end(), [this, &entities](uint32_t id) {
+        return id >= entities.size() || !is_onscreen(entities[id]);
+    }), visible_entities.end());
 
+    if(scenery_enabled){
+        draw_scenery();
+    }
     draw_entities(entities);
     ST::renderer_sdl::draw_overlay(temp.overlay, static_cast<uint8_t>(ticks % temp.overlay_sprite_num), temp.overlay_sprite_num);
     draw_text_objects(temp.text_objects);
@@ -101,28 +107,66 @@ void drawing_manager::update(const ST::level& temp, double fps, console& cnsl){
     draw_console(cnsl);
 
     ST::renderer_sdl::present();
+
+    //textures that were evicted and drawn again have to be uploaded again
+    std::vector<uint16_t> requested = ST::renderer_sdl::get_requested_textures();
+    if(!requested.empty()){
+        gMessage_bus.send_msg(new message(RELOAD_SURFACES, make_data(requested)));
+    }
 }
 
 /**
- * Draws all visible text objects in the current level
+ * Draws all visible text objects in the current level.
+ * Text objects are measured the first time they are visible and after their text or font changes.
+ * They are rendered in a texture the first time they are on screen and after their text, font or color changes.
  * @param objects a pointer to a vector of text_objects
  */
-void drawing_manager::draw_text_objects(const std::vector<ST::text>& objects) const {
-    for(auto& i : objects) {
+void drawing_manager::draw_text_objects(const std::vector<ST::text>& objects) {
+    if(fonts_changed){
+        for(auto& i : objects) {
+            i.is_measured = false;
+            i.is_rendered = false;
+        }
+        fonts_changed = false;
+    }
+    //text objects that were removed
+    for(auto id = static_cast<uint32_t>(objects.size()); id < rendered_text_count; id++) {
+        ST::renderer_sdl::remove_rendered_text(id);
+    }
+    rendered_text_count = static_cast<uint32_t>(objects.size());
+
+    for(uint32_t id = 0; id < objects.size(); id++) {
+        const ST::text& i = objects[id];
+        if(i.is_visible && !i.is_measured) {
+            i.is_measured = ST::renderer_sdl::get_text_size(i.font, i.text_string, i.width, i.height);
+        }
         if (is_onscreen(i)) {
-            ST::renderer_sdl::draw_text_lru_cached(i.font, i.text_string, i.x, i.y, i.color);
+            if(!i.is_rendered) {
+                i.is_rendered = ST::renderer_sdl::render_text(id, i.font, i.text_string, i.color);
+            }
+            //the texture is lost when the renderer is recreated (when vsync is toggled), render it again next frame
+            if(i.is_rendered && !ST::renderer_sdl::draw_rendered_text(id, i.x, i.y)) {
+                i.is_rendered = false;
+            }
         }
     }
 }
 
 /**
- * Draws the fps counter on the screen.
+ * Draws the fps counter and the Lua garbage collector stats on the screen.
  * @param fps The current fps.
  */
 void drawing_manager::draw_fps(double fps) const{
     if(show_fps) {
         SDL_Color color_font = {255, 0, 255, 255};
-        ST::renderer_sdl::draw_text_cached_glyphs(default_font_normal, "fps:" + std::to_string(static_cast<int32_t>(fps)), 0, 50, color_font);
+        //drawn piece by piece so no strings are built every frame
+        int32_t x = ST::renderer_sdl::draw_text_cached_glyphs(default_font_normal, "fps:", 0, 50, color_font);
+        ST::renderer_sdl::draw_number_cached_glyphs(default_font_normal, static_cast<int32_t>(fps), x, 50, color_font);
+        x = ST::renderer_sdl::draw_text_cached_glyphs(default_font_normal, "lua gc:", 0, 100, color_font);
+        x += ST::renderer_sdl::draw_number_cached_glyphs(default_font_normal, lua_gc_time, x, 100, color_font);
+        x += ST::renderer_sdl::draw_text_cached_glyphs(default_font_normal, "us heap:", x, 100, color_font);
+        x += ST::renderer_sdl::draw_number_cached_glyphs(default_font_normal, lua_heap_size, x, 100, color_font);
+        ST::renderer_sdl::draw_text_cached_glyphs(default_font_normal, "kb", x, 100, color_font);
     }
 }
 
@@ -133,32 +177,37 @@ void drawing_manager::draw_fps(double fps) const{
 void drawing_manager::draw_console(console& cnsl) const {
     if(cnsl.is_open()) {
         ST::renderer_sdl::draw_rectangle_filled(0, 0, w_width, w_height/2, cnsl.color);
-        int pos = w_height/2;
+        //entries go up from the input line, newest first, only the ones between the top of the console and the
+        //input line are drawn
+        const int32_t line_height = cnsl.font_size + 5;
+        const int32_t bottom = w_height / 2 - cnsl.font_size + cnsl.scroll_offset;
+        const int32_t lowest_visible = bottom - (w_height / 2 + 50 - cnsl.font_size * 2);
+        size_t first = lowest_visible > 0 ? static_cast<size_t>((lowest_visible + line_height - 1) / line_height) : 0;
         SDL_Color log_entry_color;
-        for(auto i = cnsl.entries.rbegin(); i != cnsl.entries.rend(); ++i) {
-            int pos_offset = pos - cnsl.font_size + cnsl.scroll_offset;
-            if (pos_offset > 0 && pos_offset <= w_height / 2 + 50 - cnsl.font_size * 2) {
-                if(i->type == ST::log_type::ERROR) {
-                    log_entry_color = cnsl.color_error;
-                } else if(i->type == ST::log_type::INFO) {
-                    log_entry_color = cnsl.color_info;
-                } else {
-                    log_entry_color = cnsl.color_success;
-                }
-                ST::renderer_sdl::draw_text_cached_glyphs(default_font_normal, i->text, 0,
-                                                       pos - cnsl.font_size - 20 + cnsl.scroll_offset, log_entry_color);
+        for(size_t i = first; i < cnsl.entries.size(); i++) {
+            int32_t pos_offset = bottom - static_cast<int32_t>(i) * line_height;
+            if (pos_offset <= 0) {
+                break;
             }
-            pos -= cnsl.font_size + 5;
+            const ST::console_log& entry = cnsl.entries[i];
+            if(entry.type == ST::log_type::ERROR) {
+                log_entry_color = cnsl.color_error;
+            } else if(entry.type == ST::log_type::INFO) {
+                log_entry_color = cnsl.color_info;
+            } else {
+                log_entry_color = cnsl.color_success;
+            }
+            ST::renderer_sdl::draw_text_cached_glyphs(default_font_normal, entry.text, 0, pos_offset - 20, log_entry_color);
         }
         ST::renderer_sdl::draw_rectangle_filled(0, w_height/2 - cnsl.font_size - 12, w_width, 3, cnsl.color_text);
-        int32_t cursor_draw_position;
-        if (cnsl.cursor_position == cnsl.composition.size()) {
-            cursor_draw_position = ST::renderer_sdl::draw_text_cached_glyphs(default_font_normal, "Input: " + cnsl.composition, 0, w_height / 2, cnsl.color_text);
-        } else {
-            std::string to_cursor = cnsl.composition.substr(0, cnsl.cursor_position);
-            std::string after_cursor = cnsl.composition.substr(cnsl.cursor_position, INT_MAX);
-            cursor_draw_position = ST::renderer_sdl::draw_text_cached_glyphs(default_font_normal, "Input: " + to_cursor, 0, w_height / 2, cnsl.color_text);
-            ST::renderer_sdl::draw_text_cached_glyphs(default_font_normal, after_cursor, cursor_draw_position, w_height / 2, cnsl.color_text);
+        //the input is drawn in views of the composition, split at the cursor
+        std::string_view composition = cnsl.composition;
+        int32_t cursor_draw_position = ST::renderer_sdl::draw_text_cached_glyphs(default_font_normal, "Input: ", 0, w_height / 2, cnsl.color_text);
+        cursor_draw_position += ST::renderer_sdl::draw_text_cached_glyphs(default_font_normal, composition.substr(0, cnsl.cursor_position),
+                                                                          cursor_draw_position, w_height / 2, cnsl.color_text);
+        if (cnsl.cursor_position < composition.size()) {
+            ST::renderer_sdl::draw_text_cached_glyphs(default_font_normal, composition.substr(cnsl.cursor_position),
+                                                      cursor_draw_position, w_height / 2, cnsl.color_text);
         }
         if (ticks - cnsl.cursor_timer < 250 || cnsl.cursor_timer == 0) {
             ST::renderer_sdl::draw_rectangle_filled(
@@ -172,120 +221,43 @@ void drawing_manager::draw_console(console& cnsl) const {
 
 /**
  * Processes the lightmap given a vector of light objects.
- * TODO: tests must be written for this method, but the algorithm calculating  the lighting is not yet finished.
+ * The lightmap is processed at lights_quality resolution - one cell for every lights_quality x lights_quality pixels.
+ * Its cells are aligned to the level, so when the camera moves they are moved along with it and only the uncovered
+ * ones are drawn again.
+ * Only the parts of the lightmap touched by lights that changed (or static lights, which move with the camera) since
+ * the last frame are redrawn, with its tiles processed in parallel on the task manager.
  * @param lights A vector of <b>ST::light</b> objects.
  */
 void drawing_manager::process_lights(const std::vector<ST::light>& lights){
-    memset(lightmap, darkness_level, sizeof lightmap);
+    const int32_t quality = lights_quality;
+    const auto cell_size = static_cast<float>(quality);
+    lightmap_offset_x = (camera.x % quality + quality) % quality;
+    lightmap_offset_y = (camera.y % quality + quality) % quality;
+    //one more cell in each direction, as the lightmap doesn't start at the edge of the screen
+    auto width = static_cast<uint16_t>((w_width + quality - 1) / quality + 1);
+    auto height = static_cast<uint16_t>((w_height + quality - 1) / quality + 1);
+    if(lightmap.width != width || lightmap.height != height){
+        lightmap.reset(width, height, darkness_level);
+    }
+    lightmap_lights.clear();
     for (const auto &light : lights) {
-        int x = !light.is_static*(light.origin_x - camera.x) + light.is_static*light.origin_x;
-        int y = !light.is_static*(light.origin_y - camera.y) + light.is_static*light.origin_y;
-        double count = 0;
-        double step = darkness_level/ static_cast<double>(light.radius);
-        count = 0;
-        int radius = light.radius;
-        int intensity = light.intensity;
-        if(x - radius - intensity > w_width || y - radius - intensity > w_height) {
-            continue;
-        }
-        double step2 = 0;
-        for(int i = y; i < y + radius + intensity; ++i){
-            for(int j = x; j < x + radius + intensity; ++j){
-                if(j > 0 && j < w_width && i > 0 && i < w_height) {
-                    lightmap[j][i] = (uint8_t) light.brightness + static_cast<uint8_t>(count);
-                }
-                if(count + light.brightness < darkness_level && j > x + intensity) {
-                    count += step;
-                }
-            }
-            count = 0;
-            count += step2;
-            if(step2 + light.brightness < darkness_level && i > y + intensity)
-                step2 += step;
-        }
-        count = 0;
-        step2 = 0;
-        for(int i = y; i > y - radius - intensity; --i){
-            for(int j = x; j > x - radius - intensity; --j){
-                if(j > 0 && j < w_width && i > 0 && i < w_height) {
-                    lightmap[j][i] = light.brightness + (uint8_t) count;
-                }
-                if(count + light.brightness < darkness_level && j < x - intensity) {
-                    count += step;
-                }
-            }
-            count = 0;
-            count += step2;
-            if(step2 + light.brightness < darkness_level && i < y - intensity) {
-                step2 += step;
-            }
-        }
-        count = 0;
-        step2 = 0;
-        for(int i = y; i > y - radius - intensity; --i){
-            for(int j = x; j < x + radius + intensity; ++j){
-                if(j > 0 && j < w_width && i > 0 && i < w_height){
-                    lightmap[j][i] = light.brightness + (uint8_t)count;
-                }
-                if(count + light.brightness < darkness_level && j > x + intensity) {
-                    count += step;
-                }
-            }
-            count = 0;
-            count += step2;
-            if(step2 + light.brightness < darkness_level && i < y - intensity) {
-                step2 += step;
-            }
-        }
-        count = 0;
-        step2 = 0;
-        for(int i = y; i < y + radius + intensity; ++i){
-            for(int j = x; j > x - radius - intensity; --j){
-                if(j > 0 && j < w_width && i > 0 && i < w_height) {
-                    lightmap[j][i] = light.brightness + (uint8_t) count;
-                }
-                if(count + light.brightness< darkness_level && j < x - intensity) {
-                    count += step;
-                }
-            }
-            count = 0;
-            count += step2;
-            if(step2 + light.brightness < darkness_level && i > y + intensity) {
-                step2 += step;
-            }
-        }
+        int32_t x = light.origin_x + light.is_static*camera.x;
+        int32_t y = light.origin_y + light.is_static*camera.y;
+        lightmap_lights.push_back(ST::lightmap::light{static_cast<float>(x) / cell_size, static_cast<float>(y) / cell_size,
+                                                      static_cast<float>(light.radius) / cell_size,
+                                                      static_cast<float>(light.intensity) / cell_size,
+                                                      static_cast<uint8_t>(std::min<uint16_t>(light.brightness, UINT8_MAX))});
     }
+    lightmap.update_lights(lightmap_lights, darkness_level, (camera.x - lightmap_offset_x) / quality,
+                           (camera.y - lightmap_offset_y) / quality, gTask_manager);
 }
 
 /**
  * Draws the lightmap on the screen.
  */
 void drawing_manager::draw_lights() const{
-    //Losing a lot of fps here :)
-    SDL_Rect tempRect = {0, 0, lights_quality, lights_quality};
-    SDL_Color light_color;
-
-    for(int i = 0; i <= w_width-lights_quality; i += lights_quality){
-        int a = 1;
-        tempRect.x = i;
-        for(int j = 0; j <= w_height-lights_quality; j += lights_quality){
-            if(lightmap[i][j] == lightmap[i][j+lights_quality] && j+lights_quality == w_height){
-                tempRect.y = j - a*lights_quality;
-                tempRect.h = (a+1)*lights_quality;
-                light_color = {0, 0, 0, lightmap[i][j]};
-                ST::renderer_sdl::draw_rectangle_filled(tempRect.x, tempRect.y, tempRect.w, tempRect.h, light_color);
-            }
-            else if(lightmap[i][j] == lightmap[i][j+lights_quality]){
-                a++;
-            }else{
-                tempRect.h = a*lights_quality;
-                tempRect.y = j - a*lights_quality;
-                light_color = {0, 0, 0, lightmap[i][j]};
-                ST::renderer_sdl::draw_rectangle_filled(tempRect.x, tempRect.y, tempRect.w, tempRect.h, light_color);
-                a = 1;
-            }
-        }
-    }
+    ST::renderer_sdl::draw_lightmap(lightmap.cells, lightmap.width, lightmap.height, lights_quality,
+                                    -lightmap_offset_x, -lightmap_offset_y);
 }
 
 /**
@@ -315,17 +287,51 @@ void drawing_manager::handle_messages(){
             case SHOW_FPS:
                 show_fps = static_cast<bool>(temp->base_data0);
                 break;
+            case LUA_GC_STATS:
+                lua_gc_time = static_cast<uint16_t>(temp->base_data0 & 0x0000ffffU);
+                lua_heap_size = static_cast<uint16_t>((temp->base_data0 >> 16U) & 0x0000ffffU);
+                break;
             case ENABLE_LIGHTING:
                 lighting_enabled = static_cast<bool>(temp->base_data0);
                 break;
             case SURFACES_ASSETS: {
                 auto surfaces = *static_cast<ska::bytell_hash_map<uint16_t, SDL_Surface *>**>(temp->get_data());
                 ST::renderer_sdl::upload_surfaces(surfaces);
+                scenery.invalidate();
                 break;
             }
             case FONTS_ASSETS: {
                 auto fonts = *static_cast<ska::bytell_hash_map<uint16_t , TTF_Font *>**>(temp->get_data());
                 ST::renderer_sdl::upload_fonts(fonts);
+                fonts_changed = true;
+                break;
+            }
+            case ASSETS_DELTA: {
+                auto delta = static_cast<ST::assets_delta*>(temp->get_data());
+                std::vector<ST::asset_handle<SDL_Surface>> uploaded;
+                for(const auto& surface : delta->surfaces){
+                    ST::renderer_sdl::upload_surface(surface.id, surface.asset);
+                    scenery.invalidate_texture(surface.id);
+                    if(surface.asset != nullptr){
+                        uploaded.emplace_back(surface);
+                    }
+                }
+                for(const auto& font : delta->fonts){
+                    ST::renderer_sdl::upload_font(font.id, font.asset);
+                    fonts_changed = true;
+                }
+                //the surfaces live on the GPU now, the assets_manager can free them
+                if(!uploaded.empty()){
+                    gMessage_bus.send_msg(new message(RELEASE_SURFACES, make_data(uploaded)));
+                }
+                //as well as the assets that were unloaded, nothing points to them anymore
+                gMessage_bus.send_msg(new message(ASSETS_DELTA_APPLIED, temp->base_data0));
+                break;
+            }
+            case SET_TEXTURE_BUDGET: {
+                auto data = temp->base_data0;
+                uint64_t budget = static_cast<uint64_t>(data & 0x0000ffffU) << 20U;
+                ST::renderer_sdl::set_texture_budget(budget, (data >> 16U) & 0x0000ffffU);
                 break;
             }
             case SET_INTERNAL_RESOLUTION: {
@@ -349,16 +355,19 @@ void drawing_manager::handle_messages(){
  */
 void drawing_manager::set_darkness(uint8_t arg){
     darkness_level = arg;
-    memset(lightmap, arg, sizeof lightmap);
 }
 
 /**
- * Draws all visible entities on the screen.
- * @param entities A vector of entities in the current level.
+ * Draws all visible entities on the screen, except for the scenery which is drawn by draw_scenery().
+ * @param entities A vector of entities in the current level, only the ones in visible_entities are drawn.
  */
 void drawing_manager::draw_entities(const std::vector<ST::entity>& entities) const{
     uint32_t time = ticks >> 7U; //ticks/128
-    for(auto& i : entities){
+    for(uint32_t id : visible_entities){
+        const ST::entity& i = entities[id];
+        if(scenery_enabled && scenery.is_baked(id)){
+            continue;
+        }
         int32_t camera_offset_x = (!i.is_static())*camera.x; //If entity isn't static add camera offset
         int32_t camera_offset_y = (camera_offset_x != 0)*camera.y;
         ST::renderer_sdl::draw_sprite_scaled(i.texture,
@@ -373,6 +382,77 @@ void drawing_manager::draw_entities(const std::vector<ST::entity>& entities) con
     }
 }
 
+/**
+ * Brings the scenery up to date with the entities and renders the dirty chunks that are on screen.
+ * Chunks that were not drawn in the last chunk_lifetime ms are removed and rendered again when they come into view.
+ * @param entities A vector of entities in the current level.
+ */
+void drawing_manager::update_scenery(const std::vector<ST::entity>& entities){
+    scenery.update(entities);
+    for(auto it = scenery.chunks.begin(); it != scenery.chunks.end();){
+        if(ticks - it->second.last_drawn > chunk_lifetime){
+            ST::renderer_sdl::remove_chunk(it->first);
+            if(it->second.entities.empty()){
+                it = scenery.chunks.erase(it);
+                continue;
+            }
+            it->second.dirty = true;
+        }
+        ++it;
+    }
+    for(int32_t row = camera.y >> ST::scenery::chunk_shift; row <= (camera.y + w_height) >> ST::scenery::chunk_shift; row++){
+        for(int32_t column = camera.x >> ST::scenery::chunk_shift; column <= (camera.x + w_width) >> ST::scenery::chunk_shift; column++){
+            uint64_t key = ST::scenery::get_chunk_key(column, row);
+            auto chunk = scenery.chunks.find(key);
+            if(chunk == scenery.chunks.end() || !chunk->second.dirty){
+                continue;
+            }
+            if(chunk->second.entities.empty()){
+                ST::renderer_sdl::remove_chunk(key);
+                scenery.chunks.erase(chunk);
+                continue;
+            }
+            if(!ST::renderer_sdl::begin_chunk(key, ST::scenery::chunk_size)){
+                //the renderer can't render to textures, draw the scenery as any other entity
+                scenery_enabled = false;
+                return;
+            }
+            int32_t chunk_x = column * ST::scenery::chunk_size;
+            int32_t chunk_y = row * ST::scenery::chunk_size;
+            for(uint32_t id : chunk->second.entities){
+                const ST::entity& i = entities[id];
+                ST::renderer_sdl::draw_sprite_scaled(i.texture, i.x - chunk_x, i.y - chunk_y, 0, i.animation,
+                                                     i.animation_num, i.sprite_num, i.tex_scale_x, i.tex_scale_y);
+            }
+            ST::renderer_sdl::end_chunk();
+            chunk->second.dirty = false;
+            chunk->second.last_drawn = ticks;
+        }
+    }
+}
+
+/**
+ * Draws the scenery chunks on the screen.
+ * A chunk that was lost (because the renderer was recreated) is marked dirty and rendered again in the next frame.
+ */
+void drawing_manager::draw_scenery(){
+    for(int32_t row = camera.y >> ST::scenery::chunk_shift; row <= (camera.y + w_height) >> ST::scenery::chunk_shift; row++){
+        for(int32_t column = camera.x >> ST::scenery::chunk_shift; column <= (camera.x + w_width) >> ST::scenery::chunk_shift; column++){
+            uint64_t key = ST::scenery::get_chunk_key(column, row);
+            auto chunk = scenery.chunks.find(key);
+            if(chunk == scenery.chunks.end() || chunk->second.dirty){
+                continue;
+            }
+            if(ST::renderer_sdl::draw_chunk(key, column * ST::scenery::chunk_size - camera.x,
+                                            row * ST::scenery::chunk_size - camera.y)){
+                chunk->second.last_drawn = ticks;
+            }else{
+                chunk->second.dirty = true;
+            }
+        }
+    }
+}
+
 /**
  * Tells if an entity is visible on the screen.
  * @param i The entity to check.
@@ -388,19 +468,23 @@ bool drawing_manager::is_onscreen(const ST::entity& i) const{
 
 /**
  * Tells if a text object is visible on the screen.
- * @param i The text object to check.
+ * Text objects are drawn in screen coordinates with their bottom left corner at x,y.
+ * @param i The text object to check, it must be measured.
  * @return True if it is on screen and false otherwise.
  */
 bool drawing_manager::is_onscreen(const ST::text& i) const {
-    return i.is_visible && i.x < camera.x + w_width; //TODO: finish
+    return i.is_visible && i.is_measured &&
+    i.x + i.width >= 0 && i.x <= w_width &&
+    i.y >= 0 && i.y - i.height <= w_height;
 }
 
 /**
  * Draws the collision boxes for entities that are affected by physics.
- * @param entities A vector of entities in the current level.
+ * @param entities A vector of entities in the current level, only the ones in visible_entities are drawn.
  */
 void drawing_manager::draw_collisions(const std::vector<ST::entity>& entities) const{
-    for(auto& i : entities) {
+    for(uint32_t id : visible_entities) {
+        const ST::entity& i = entities[id];
         int32_t x_offset = (!i.is_static())*camera.x;
         int32_t y_offset = (x_offset != 0)*camera.y;
         uint8_t b = (!i.is_affected_by_physics())*220;
@@ -413,18 +497,23 @@ void drawing_manager::draw_collisions(const std::vector<ST::entity>& entities) c
 
 /**
  * Draws the coordinates for entities that are affected by physics.
- * @param entities A vector of entities in the current level.
+ * @param entities A vector of entities in the current level, only the ones in visible_entities are drawn.
  */
 void drawing_manager::draw_coordinates(const std::vector<ST::entity>& entities) const{
-    for(auto& i : entities) {
+    for(uint32_t id : visible_entities) {
+        const ST::entity& i = entities[id];
         if (i.is_affected_by_physics()) {
             int32_t x_offset = (!i.is_static())*camera.x;
             int32_t y_offset = (x_offset != 0)*camera.y;
             SDL_Color colour_text = {255, 255, 0, 255};
-            ST::renderer_sdl::draw_text_cached_glyphs(default_font_small, "x: " + std::to_string(i.x), i.x - x_offset,
-                                                      i.y - y_offset - i.tex_h, colour_text);
-            ST::renderer_sdl::draw_text_cached_glyphs(default_font_small, "y: " + std::to_string(i.y), i.x - x_offset,
-                                                      i.y - y_offset - i.tex_h + 30, colour_text);
+            int32_t label_width = ST::renderer_sdl::draw_text_cached_glyphs(default_font_small, "x: ", i.x - x_offset,
+                                                                            i.y - y_offset - i.tex_h, colour_text);
+            ST::renderer_sdl::draw_number_cached_glyphs(default_font_small, i.x, i.x - x_offset + label_width,
+                                                        i.y - y_offset - i.tex_h, colour_text);
+            label_width = ST::renderer_sdl::draw_text_cached_glyphs(default_font_small, "y: ", i.x - x_offset,
+                                                                    i.y - y_offset - i.tex_h + 30, colour_text);
+            ST::renderer_sdl::draw_number_cached_glyphs(default_font_small, i.y, i.x - x_offset + label_width,
+                                                        i.y - y_offset - i.tex_h + 30, colour_text);
         }
     }
 }
@@ -11,11 +11,16 @@
 #define DRAWING_DEF
 
 #include <game_manager/level/light.hpp>
+#include <drawing_manager/lightmap.hpp>
+#include <drawing_manager/scenery.hpp>
 #include <message_bus.hpp>
+#include <task_manager.hpp>
 #include <game_manager/level/camera.hpp>
 #include <renderer_sdl.hpp>
 #include <game_manager/level/level.hpp>
 #include <console.hpp>
+#include <assets.hpp>
+#include <ST_util/string_util.hpp>
 
 
 #define DEFAULT_FONT_NORMAL "OpenSans-Regular.ttf 40"
@@ -26,6 +31,7 @@ class drawing_manager{
     private:
         //external dependency - delivered in the constructor
         message_bus& gMessage_bus;
+        task_manager& gTask_manager;
 
         //a subscriber object - so we can subscribe to and recieve messages
         subscriber msg_sub{};
@@ -36,35 +42,59 @@ class drawing_manager{
         //Basically the viewport
         ST::camera camera{};
 
+        //ids of the entities on screen, filled every frame
+        std::vector<uint32_t> visible_entities{};
+
+        //scenery entities are rendered in chunks, which are removed if they are not drawn for chunk_lifetime ms
+        ST::scenery scenery{};
+        bool scenery_enabled = true;
+        static constexpr uint32_t chunk_lifetime = 5000;
+
         //Internal rendering resolution
         uint16_t w_width = 1920;
         uint16_t w_height = 1080;
 
         //variables for drawing light
-        uint8_t lightmap[1920][1080]{};
+        //the lightmap has one cell per lights_quality x lights_quality pixels, stored row by row
+        ST::lightmap lightmap{};
+        std::vector<ST::lightmap::light> lightmap_lights{};
+        //the lightmap is aligned to the cells of the level, it is drawn this many pixels up and to the left of the screen
+        int32_t lightmap_offset_x = 0;
+        int32_t lightmap_offset_y = 0;
         uint8_t darkness_level = 0;
         uint8_t lights_quality = 0;
 
-        uint16_t default_font_normal = 0;
-        uint16_t default_font_small = 0;
+        //hash of default font, known at compile time, the ids are reserved at startup (see main())
+        static constexpr uint16_t default_font_normal = ST::fnv_hash_string(DEFAULT_FONT_NORMAL);
+        static constexpr uint16_t default_font_small = ST::fnv_hash_string(DEFAULT_FONT_SMALL);
+
+        //set when fonts are uploaded, the text objects have to be measured and rendered again
+        bool fonts_changed = false;
+
+        //text objects are rendered with their index as id, this many ids may have a texture in the renderer
+        uint32_t rendered_text_count = 0;
 
         //debug
         bool collisions_shown = false;
         bool show_fps = true;
+        uint16_t lua_gc_time = 0; //microseconds
+        uint16_t lua_heap_size = 0; //kilobytes
         bool lighting_enabled = false;
 
         //Drawing functions
         void draw_entities(const std::vector<ST::entity>&) const;
+        void draw_scenery();
         void draw_collisions(const std::vector<ST::entity>&) const;
         void draw_coordinates(const std::vector<ST::entity>&) const;
         void draw_lights() const;
         void draw_fps(double fps) const;
         void draw_console(console& cnsl) const;
-        void draw_text_objects(const std::vector<ST::text>&) const;
+        void draw_text_objects(const std::vector<ST::text>&);
         void draw_background(const uint16_t background[PARALLAX_BG_LAYERS], const uint8_t parallax_speed[PARALLAX_BG_LAYERS]) const;
 
         //Pre-processing
         void process_lights(const std::vector<ST::light>& arg);
+        void update_scenery(const std::vector<ST::entity>& entities);
         [[nodiscard]] bool is_onscreen(const ST::entity& i) const;
         [[nodiscard]] bool is_onscreen(const ST::text& i) const;
 
@@ -73,7 +103,7 @@ class drawing_manager{
         void set_darkness(uint8_t arg);
 
     public:
-        drawing_manager(SDL_Window *window, message_bus &gMessageBus);
+        drawing_manager(SDL_Window *window, message_bus &gMessageBus, task_manager &gTaskManager);
         ~drawing_manager();
         void update(const ST::level& temp, double, console& gConsole);
 
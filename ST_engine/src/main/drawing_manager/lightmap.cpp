@@ -0,0 +1,349 @@
+/* This file is part of the "ST" project.
+ * You may use, distribute or modify this code under the terms
+ * of the GNU General Public License version 2.
+ * See LICENCE.txt in the root directory of the project.
+ *
+ * Author: Maxim Atanasov
+ * E-mail: maxim.atanasov@protonmail.com
+ */
+
+#include <drawing_manager/lightmap.hpp>
+#include <task_manager.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ST_LIGHTMAP_SSE2
+#include <emmintrin.h>
+#endif
+
+/**
+ * Adds a light to the cells of a row of the lightmap, see ST::lightmap::add_light().
+ * 16 cells are processed at a time with SSE2 when it is available.
+ * @param row The first cell of the row.
+ * @param begin The first column.
+ * @param end The column after the last one.
+ * @param x The column of the light.
+ * @param dy2 The squared distance between the row and the light.
+ * @param step The darkness added per cell of distance outside of the intensity of the light.
+ * @param intensity The distance in cells in which the light has its full brightness.
+ * @param brightness The darkness at the origin of the light.
+ * @param darkness The darkness where there is no light.
+ */
+static void add_light_row(uint8_t* row, int32_t begin, int32_t end, float x, float dy2, float step, float intensity,
+                          float brightness, float darkness){
+    int32_t column = begin;
+#ifdef ST_LIGHTMAP_SSE2
+    const __m128 v_x = _mm_set1_ps(x);
+    const __m128 v_dy2 = _mm_set1_ps(dy2);
+    const __m128 v_step = _mm_set1_ps(step);
+    const __m128 v_intensity = _mm_set1_ps(intensity);
+    const __m128 v_brightness = _mm_set1_ps(brightness);
+    const __m128 v_darkness = _mm_set1_ps(darkness);
+    const __m128 v_offsets = _mm_set_ps(3, 2, 1, 0);
+    const __m128 v_zero = _mm_setzero_ps();
+    for(; column + 16 <= end; column += 16){
+        __m128i values[4];
+        for(int32_t i = 0; i < 4; i++){
+            __m128 dx = _mm_sub_ps(_mm_add_ps(_mm_set1_ps(static_cast<float>(column + i * 4)), v_offsets), v_x);
+            __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), v_dy2));
+            __m128 value = _mm_mul_ps(v_step, _mm_max_ps(_mm_sub_ps(distance, v_intensity), v_zero));
+            value = _mm_min_ps(_mm_add_ps(v_brightness, value), v_darkness);
+            values[i] = _mm_cvttps_epi32(value);
+        }
+        __m128i packed = _mm_packus_epi16(_mm_packs_epi32(values[0], values[1]), _mm_packs_epi32(values[2], values[3]));
+        auto cells = reinterpret_cast<__m128i*>(row + column);
+        _mm_storeu_si128(cells, _mm_min_epu8(_mm_loadu_si128(cells), packed));
+    }
+#endif
+    for(; column < end; column++){
+        float dx = static_cast<float>(column) - x;
+        float distance = std::sqrt(dx * dx + dy2);
+        float value = std::min(brightness + step * std::max(distance - intensity, 0.0f), darkness);
+        row[column] = std::min(row[column], static_cast<uint8_t>(value));
+    }
+}
+
+/**
+ * Resizes the lightmap and fills it with darkness, its origin is moved back to 0,0.
+ * Anything baked by update_lights() is discarded.
+ * @param width The width in cells.
+ * @param height The height in cells.
+ * @param darkness The darkness where there is no light.
+ */
+void ST::lightmap::reset(uint16_t width, uint16_t height, uint8_t darkness) {
+    this->width = width;
+    this->height = height;
+    cells.assign(static_cast<size_t>(width) * height, darkness);
+    tile_width = (width + tiles_x - 1) / tiles_x;
+    tile_height = (height + tiles_y - 1) / tiles_y;
+    origin_x = 0;
+    origin_y = 0;
+    baked_lights.clear();
+    baked = false;
+}
+
+/**
+ * @param radius The radius of a light in cells.
+ * @param darkness The darkness where there is no light.
+ * @return The darkness added per cell of distance outside of the intensity of the light.
+ */
+static float get_step(float radius, uint8_t darkness){
+    return static_cast<float>(darkness) / std::max(radius, 0.001f);
+}
+
+/**
+ * Adds a light to the lightmap.
+ * The light has its full brightness up to its intensity away from its origin and then grows darker with the distance,
+ * reaching the darkness at its radius past the intensity (for a brightness of 0).
+ * Only the cells in the bounding box of the light, clipped to the lightmap, are processed.
+ * Overlapping lights are combined by keeping the brightest value, so the order of the lights doesn't matter.
+ * @param x The column of the origin of the light, relative to the origin of the lightmap.
+ * @param y The row of the origin of the light, relative to the origin of the lightmap.
+ * @param radius The radius of the light in cells.
+ * @param intensity The distance in cells in which the light has its full brightness.
+ * @param brightness The darkness at the origin of the light.
+ * @param darkness The darkness where there is no light.
+ */
+void ST::lightmap::add_light(float x, float y, float radius, float intensity, uint8_t brightness, uint8_t darkness) {
+    add_light(light{x, y, radius, intensity, brightness}, darkness, area{0, width, 0, height});
+}
+
+/**
+ * Adds a number of lights to the lightmap, same as calling add_light() for each one of them.
+ * The lightmap is split in a grid of tiles and each tile is processed as a separate task, with only the lights
+ * that touch it. Returns once all tiles are processed, doing work from the task queue in the meantime.
+ * @param lights The lights to add.
+ * @param darkness The darkness where there is no light.
+ * @param gTask_manager The task manager to run the tiles on.
+ */
+void ST::lightmap::add_lights(const std::vector<light>& lights, uint8_t darkness, task_manager& gTask_manager) {
+    process_tiles(lights, darkness, UINT32_MAX, false, gTask_manager);
+}
+
+/**
+ * Makes the lightmap show exactly the given lights, redrawing only what changed since the last call.
+ * When the origin moves, the cells are moved with it and only the rows and columns it uncovers are drawn again.
+ * The lights from the last call are kept and compared to the new ones by index - the tiles touched by a light that
+ * was added, removed or changed in any way (before and after the change) are cleared and drawn again,
+ * the rest are left as they are.
+ * Everything is redrawn after a reset() or when the darkness changes.
+ * @param lights The lights to show.
+ * @param darkness The darkness where there is no light.
+ * @param origin_x The column the first column of the lightmap shows.
+ * @param origin_y The row the first row of the lightmap shows.
+ * @param gTask_manager The task manager to run the tiles on.
+ */
+void ST::lightmap::update_lights(const std::vector<light>& lights, uint8_t darkness, int32_t origin_x, int32_t origin_y,
+                                 task_manager& gTask_manager) {
+    uint32_t dirty_tiles = 0;
+    if(!baked || darkness != baked_darkness){
+        this->origin_x = origin_x;
+        this->origin_y = origin_y;
+        dirty_tiles = UINT32_MAX;
+    }else{
+        dirty_tiles = scroll(origin_x - this->origin_x, origin_y - this->origin_y);
+        size_t common = std::min(lights.size(), baked_lights.size());
+        for(size_t i = 0; i < common; i++){
+            if(lights[i] != baked_lights[i]){
+                dirty_tiles |= get_light_tiles(baked_lights[i], darkness) | get_light_tiles(lights[i], darkness);
+            }
+        }
+        for(size_t i = common; i < baked_lights.size(); i++){
+            dirty_tiles |= get_light_tiles(baked_lights[i], darkness);
+        }
+        for(size_t i = common; i < lights.size(); i++){
+            dirty_tiles |= get_light_tiles(lights[i], darkness);
+        }
+    }
+    if(dirty_tiles != 0){
+        process_tiles(lights, darkness, dirty_tiles, true, gTask_manager);
+    }
+    baked_lights = lights;
+    baked_darkness = darkness;
+    baked = true;
+}
+
+/**
+ * Moves the origin of the lightmap and the cells along with it, so every cell keeps showing the same place.
+ * The cells that are uncovered are left as they are and have to be drawn again.
+ * @param columns The number of columns to move the origin by.
+ * @param rows The number of rows to move the origin by.
+ * @return One bit for each tile with uncovered cells, row by row.
+ */
+uint32_t ST::lightmap::scroll(int32_t columns, int32_t rows) {
+    origin_x += columns;
+    origin_y += rows;
+    if(columns == 0 && rows == 0){
+        return 0;
+    }
+    if(std::abs(columns) >= width || std::abs(rows) >= height){
+        return UINT32_MAX;
+    }
+    auto count = static_cast<size_t>(width - std::abs(columns));
+    int32_t source_column = std::max(columns, 0);
+    int32_t target_column = std::max(-columns, 0);
+    //go through the rows in the direction in which no row is overwritten before it is moved
+    int32_t first_row = rows >= 0 ? 0 : height - 1;
+    int32_t end_row = rows >= 0 ? height - rows : -rows - 1;
+    int32_t direction = rows >= 0 ? 1 : -1;
+    for(int32_t row = first_row; row != end_row; row += direction){
+        std::memmove(cells.data() + static_cast<size_t>(row) * width + target_column,
+                     cells.data() + static_cast<size_t>(row + rows) * width + source_column, count);
+    }
+    uint32_t result = 0;
+    if(columns > 0){
+        result |= get_area_tiles(area{width - columns, width, 0, height});
+    }else if(columns < 0){
+        result |= get_area_tiles(area{0, -columns, 0, height});
+    }
+    if(rows > 0){
+        result |= get_area_tiles(area{0, width, height - rows, height});
+    }else if(rows < 0){
+        result |= get_area_tiles(area{0, width, 0, -rows});
+    }
+    return result;
+}
+
+/**
+ * Adds lights to a number of tiles of the lightmap, each tile is processed as a separate task.
+ * Returns once all tiles are processed, doing work from the task queue in the meantime.
+ * @param lights The lights to add.
+ * @param darkness The darkness where there is no light.
+ * @param dirty_tiles One bit for each tile to process, row by row.
+ * @param clear True to fill the tiles with darkness before adding the lights to them.
+ * @param gTask_manager The task manager to run the tiles on.
+ */
+void ST::lightmap::process_tiles(const std::vector<light>& lights, uint8_t darkness, uint32_t dirty_tiles, bool clear,
+                                 task_manager& gTask_manager) {
+    if(tile_width == 0 || tile_height == 0){
+        return;
+    }
+    tiles.resize(tiles_x * tiles_y);
+    for(int32_t row = 0; row < tiles_y; row++){
+        for(int32_t column = 0; column < tiles_x; column++){
+            tile& current = tiles[row * tiles_x + column];
+            current.map = this;
+            current.lights = &lights;
+            current.darkness = darkness;
+            current.clear = clear;
+            current.binned_lights.clear();
+            current.bounds = area{std::min(column * tile_width, static_cast<int32_t>(width)),
+                                  std::min(column * tile_width + tile_width, static_cast<int32_t>(width)),
+                                  std::min(row * tile_height, static_cast<int32_t>(height)),
+                                  std::min(row * tile_height + tile_height, static_cast<int32_t>(height))};
+        }
+    }
+
+    //bin each light in the dirty tiles its bounding box touches
+    for(uint32_t i = 0; i < lights.size(); i++){
+        uint32_t light_tiles = get_light_tiles(lights[i], darkness) & dirty_tiles;
+        for(uint8_t j = 0; light_tiles != 0; j++, light_tiles >>= 1U){
+            if(light_tiles & 1U){
+                tiles[j].binned_lights.emplace_back(i);
+            }
+        }
+    }
+
+    std::array<task_id, tiles_x * tiles_y> ids{};
+    uint8_t started = 0;
+    for(uint8_t i = 0; i < tiles.size(); i++){
+        if((dirty_tiles >> i & 1U) && (clear || !tiles[i].binned_lights.empty())){
+            ids[started++] = gTask_manager.start_task(new ST::task(process_tile, &tiles[i], nullptr));
+        }
+    }
+    for(uint8_t i = 0; i < started; i++){
+        gTask_manager.work_wait_for_task(ids[i]);
+    }
+}
+
+/**
+ * Adds the lights binned in a tile to the lightmap, only writing the cells of that tile.
+ * Used as a task function.
+ * @param arg A pointer to the tile.
+ */
+void ST::lightmap::process_tile(void* arg) {
+    auto current = static_cast<tile*>(arg);
+    lightmap* map = current->map;
+    if(current->clear){
+        for(int32_t row = current->bounds.first_row; row < current->bounds.end_row; row++){
+            auto row_cells = map->cells.begin() + static_cast<ptrdiff_t>(row) * map->width;
+            std::fill(row_cells + current->bounds.first_column, row_cells + current->bounds.end_column, current->darkness);
+        }
+    }
+    for(uint32_t i : current->binned_lights){
+        map->add_light((*current->lights)[i], current->darkness, current->bounds);
+    }
+}
+
+/**
+ * @param arg A light.
+ * @param darkness The darkness where there is no light.
+ * @return The cells the light brightens, clipped to the lightmap.
+ */
+ST::lightmap::area ST::lightmap::get_light_area(const light& arg, uint8_t darkness) const {
+    float extent = arg.intensity + static_cast<float>(darkness - arg.brightness) / get_step(arg.radius, darkness);
+    float x = arg.x - static_cast<float>(origin_x);
+    float y = arg.y - static_cast<float>(origin_y);
+    area result;
+    result.first_column = static_cast<int32_t>(std::max(std::ceil(x - extent), 0.0f));
+    result.end_column = static_cast<int32_t>(std::min(std::floor(x + extent) + 1, static_cast<float>(width)));
+    result.first_row = static_cast<int32_t>(std::max(std::ceil(y - extent), 0.0f));
+    result.end_row = static_cast<int32_t>(std::min(std::floor(y + extent) + 1, static_cast<float>(height)));
+    return result;
+}
+
+/**
+ * @param arg A light.
+ * @param darkness The darkness where there is no light.
+ * @return One bit for each tile the light brightens, row by row.
+ */
+uint32_t ST::lightmap::get_light_tiles(const light& arg, uint8_t darkness) const {
+    if(arg.brightness >= darkness){
+        return 0;
+    }
+    return get_area_tiles(get_light_area(arg, darkness));
+}
+
+/**
+ * @param arg An area of cells within the lightmap.
+ * @return One bit for each tile the area touches, row by row.
+ */
+uint32_t ST::lightmap::get_area_tiles(const area& arg) const {
+    if(tile_width == 0 || tile_height == 0 || arg.first_column >= arg.end_column || arg.first_row >= arg.end_row){
+        return 0;
+    }
+    uint32_t result = 0;
+    for(int32_t row = arg.first_row / tile_height; row <= (arg.end_row - 1) / tile_height; row++){
+        for(int32_t column = arg.first_column / tile_width; column <= (arg.end_column - 1) / tile_width; column++){
+            result |= 1U << static_cast<uint32_t>(row * tiles_x + column);
+        }
+    }
+    return result;
+}
+
+/**
+ * Adds a light to the cells of the lightmap within an area, see the public add_light().
+ * @param arg The light.
+ * @param darkness The darkness where there is no light.
+ * @param clip The area of cells that may be written.
+ */
+void ST::lightmap::add_light(const light& arg, uint8_t darkness, const area& clip) {
+    if(arg.brightness >= darkness){
+        return;
+    }
+    area bounds = get_light_area(arg, darkness);
+    int32_t first_column = std::max(bounds.first_column, clip.first_column);
+    int32_t end_column = std::min(bounds.end_column, clip.end_column);
+    int32_t end_row = std::min(bounds.end_row, clip.end_row);
+    float step = get_step(arg.radius, darkness);
+    float x = arg.x - static_cast<float>(origin_x);
+    float y = arg.y - static_cast<float>(origin_y);
+    for(int32_t row = std::max(bounds.first_row, clip.first_row); row < end_row; row++){
+        float dy = static_cast<float>(row) - y;
+        add_light_row(cells.data() + static_cast<size_t>(row) * width, first_column, end_column, x, dy * dy,
+                      step, arg.intensity, arg.brightness, darkness);
+    }
+}
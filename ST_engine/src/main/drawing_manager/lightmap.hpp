@@ -0,0 +1,108 @@
+/* This file is part of the "ST" project.
+ * You may use, distribute or modify this code under the terms
+ * of the GNU General Public License version 2.
+ * See LICENCE.txt in the root directory of the project.
+ *
+ * Author: Maxim Atanasov
+ * E-mail: maxim.atanasov@protonmail.com
+ */
+
+#ifndef ST_LIGHTMAP_HPP
+#define ST_LIGHTMAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class task_manager;
+
+namespace ST {
+
+    ///A map of the darkness of the screen, with one value per cell, stored row by row.
+    /**
+     * A cell covers a number of pixels (the lights quality) in both directions.
+     * 0 is fully lit and 255 is black.
+     * The lightmap shows a part of a larger grid of cells, starting from its origin, and lights are positioned in that grid.
+     */
+    class lightmap {
+    public:
+        ///A light in the units of the lightmap, see add_light().
+        struct light {
+            float x = 0;
+            float y = 0;
+            float radius = 0;
+            float intensity = 0;
+            uint8_t brightness = 0;
+
+            bool operator==(const light&) const = default;
+        };
+
+        //the lightmap is split in a grid of tiles when processed in parallel, one bit per tile marks the dirty ones
+        static constexpr uint8_t tiles_x = 8;
+        static constexpr uint8_t tiles_y = 4;
+        static_assert(tiles_x * tiles_y <= 32, "the dirty tiles of the lightmap must fit in 32 bits");
+
+        std::vector<uint8_t> cells{};
+        uint16_t width = 0;
+        uint16_t height = 0;
+
+        void reset(uint16_t width, uint16_t height, uint8_t darkness);
+        void add_light(float x, float y, float radius, float intensity, uint8_t brightness, uint8_t darkness);
+        void add_lights(const std::vector<light>& lights, uint8_t darkness, task_manager& gTask_manager);
+        void update_lights(const std::vector<light>& lights, uint8_t darkness, int32_t origin_x, int32_t origin_y,
+                           task_manager& gTask_manager);
+        [[nodiscard]] uint8_t at(uint16_t x, uint16_t y) const;
+
+    private:
+        ///A rectangle of cells, from the first row and column up to (but not including) the end row and column.
+        struct area {
+            int32_t first_column = 0;
+            int32_t end_column = 0;
+            int32_t first_row = 0;
+            int32_t end_row = 0;
+        };
+
+        ///A tile of the lightmap and the lights that touch it.
+        struct tile {
+            lightmap* map = nullptr;
+            const std::vector<light>* lights = nullptr;
+            std::vector<uint32_t> binned_lights{};
+            area bounds{};
+            uint8_t darkness = 0;
+            bool clear = false;
+        };
+
+        std::vector<tile> tiles{};
+        int32_t tile_width = 0;
+        int32_t tile_height = 0;
+        int32_t origin_x = 0;
+        int32_t origin_y = 0;
+
+        //the lights the lightmap currently holds, if it was last drawn by update_lights()
+        std::vector<light> baked_lights{};
+        uint8_t baked_darkness = 0;
+        bool baked = false;
+
+        [[nodiscard]] area get_light_area(const light& arg, uint8_t darkness) const;
+        [[nodiscard]] uint32_t get_light_tiles(const light& arg, uint8_t darkness) const;
+        [[nodiscard]] uint32_t get_area_tiles(const area& arg) const;
+        uint32_t scroll(int32_t columns, int32_t rows);
+        void add_light(const light& arg, uint8_t darkness, const area& clip);
+        void process_tiles(const std::vector<light>& lights, uint8_t darkness, uint32_t dirty_tiles, bool clear,
+                           task_manager& gTask_manager);
+        static void process_tile(void* arg);
+    };
+
+    //INLINED METHODS
+
+    /**
+     * @param x The column of the cell.
+     * @param y The row of the cell.
+     * @return The darkness of the cell.
+     */
+    inline uint8_t lightmap::at(uint16_t x, uint16_t y) const {
+        return cells[static_cast<size_t>(y) * width + x];
+    }
+}
+
+#endif //ST_LIGHTMAP_HPP
@@ -0,0 +1,150 @@
+/* This file is part of the "ST" project.
+ * You may use, distribute or modify this code under the terms
+ * of the GNU General Public License version 2.
+ * See LICENCE.txt in the root directory of the project.
+ *
+ * Author: Maxim Atanasov
+ * E-mail: maxim.atanasov@protonmail.com
+ */
+
+#include <drawing_manager/scenery.hpp>
+#include <algorithm>
+#include <cstring>
+
+/**
+ * Calls a function for every chunk an entity overlaps (the right and bottom edges of the entity are excluded).
+ * @param arg The entity.
+ * @param function Called with the column and row of each chunk.
+ */
+template <typename F> static void for_each_chunk(const ST::entity& arg, F function){
+    auto width = static_cast<int32_t>(static_cast<float>(arg.tex_w) * arg.tex_scale_x);
+    auto height = static_cast<int32_t>(static_cast<float>(arg.tex_h) * arg.tex_scale_y);
+    int32_t last_column = (std::max(arg.x, arg.x + width) - 1) >> ST::scenery::chunk_shift;
+    int32_t last_row = (std::max(arg.y - height, arg.y) - 1) >> ST::scenery::chunk_shift;
+    for(int32_t row = std::min(arg.y - height, arg.y) >> ST::scenery::chunk_shift; row <= last_row; row++){
+        for(int32_t column = std::min(arg.x, arg.x + width) >> ST::scenery::chunk_shift; column <= last_column; column++){
+            function(column, row);
+        }
+    }
+}
+
+/**
+ * Tells if an entity is scenery - it is visible, moves with the camera, has a single sprite, no velocity and
+ * isn't affected by physics.
+ * @param arg The entity.
+ * @return True if it is scenery.
+ */
+bool ST::scenery::is_scenery(const ST::entity& arg) {
+    return arg.is_visible() && !arg.is_static() && !arg.is_affected_by_physics() && arg.sprite_num == 1 &&
+           arg.velocity_x == 0 && arg.velocity_y == 0;
+}
+
+/**
+ * @param column The column of a chunk.
+ * @param row The row of a chunk.
+ * @return The key of the chunk.
+ */
+uint64_t ST::scenery::get_chunk_key(int32_t column, int32_t row) {
+    return static_cast<uint64_t>(static_cast<uint32_t>(column)) << 32U | static_cast<uint32_t>(row);
+}
+
+/**
+ * Compares the entities to the ones from the last update.
+ * Only the scenery entities at the start of the level, before the first entity that isn't scenery, are put in chunks.
+ * The chunks are drawn before all other entities, so this keeps the order in which the level draws its entities.
+ * An entity that changed in any way, or stopped or started being in the chunks, is taken out of its old chunks and put
+ * in its new ones, all of these chunks are marked dirty.
+ * If there are fewer entities than before everything is built again.
+ * @param entities All entities in the level, their ids are their indexes in this vector.
+ */
+void ST::scenery::update(const std::vector<ST::entity>& entities) {
+    if(entities.size() < entities_snapshot.size()){
+        clear();
+    }
+    size_t known = entities_snapshot.size();
+    entities_snapshot.resize(entities.size());
+    baked.resize(entities.size(), false);
+    uint32_t background = 0;
+    while(background < entities.size() && is_scenery(entities[background])){
+        background++;
+    }
+    for(uint32_t i = 0; i < entities.size(); i++){
+        bool changed = i >= known || std::memcmp(&entities[i], &entities_snapshot[i], sizeof(ST::entity)) != 0;
+        bool bake = i < background;
+        if(!changed && bake == baked[i]){
+            continue;
+        }
+        if(baked[i]){
+            remove(i, entities_snapshot[i]);
+        }
+        baked[i] = bake;
+        if(bake){
+            insert(i, entities[i]);
+        }
+        entities_snapshot[i] = entities[i];
+    }
+}
+
+/**
+ * Marks all chunks dirty.
+ */
+void ST::scenery::invalidate() {
+    for(auto& it : chunks){
+        it.second.dirty = true;
+    }
+}
+
+/**
+ * Marks the chunks with entities using a texture dirty.
+ * @param texture The hash of the name of the texture.
+ */
+void ST::scenery::invalidate_texture(uint16_t texture) {
+    for(auto& it : chunks){
+        it.second.dirty = it.second.dirty || std::any_of(it.second.entities.begin(), it.second.entities.end(),
+                [this, texture](uint32_t id){ return entities_snapshot[id].texture == texture; });
+    }
+}
+
+/**
+ * Removes all entities. The chunks are kept (dirty and empty) so their textures can be removed.
+ */
+void ST::scenery::clear() {
+    for(auto& it : chunks){
+        it.second.entities.clear();
+        it.second.dirty = true;
+    }
+    entities_snapshot.clear();
+    baked.clear();
+}
+
+/**
+ * Adds an entity to the chunks it overlaps.
+ * @param id The id of the entity.
+ * @param arg The entity.
+ */
+void ST::scenery::insert(uint32_t id, const ST::entity& arg) {
+    for_each_chunk(arg, [this, id](int32_t column, int32_t row){
+        chunk& current = chunks[get_chunk_key(column, row)];
+        current.entities.insert(std::lower_bound(current.entities.begin(), current.entities.end(), id), id);
+        current.dirty = true;
+    });
+}
+
+/**
+ * Removes an entity from the chunks it overlaps.
+ * @param id The id of the entity.
+ * @param arg The entity as it was when it was added.
+ */
+void ST::scenery::remove(uint32_t id, const ST::entity& arg) {
+    for_each_chunk(arg, [this, id](int32_t column, int32_t row){
+        auto found = chunks.find(get_chunk_key(column, row));
+        if(found != chunks.end()){
+            auto& ids = found->second.entities;
+            auto position = std::lower_bound(ids.begin(), ids.end(), id);
+            if(position != ids.end() && *position == id){
+                ids.erase(position);
+            }
+            found->second.dirty = true;
+        }
+    });
+}
@@ -0,0 +1,69 @@
+/* This file is part of the "ST" project.
+ * You may use, distribute or modify this code under the terms
+ * of the GNU General Public License version 2.
+ * See LICENCE.txt in the root directory of the project.
+ *
+ * Author: Maxim Atanasov
+ * E-mail: maxim.atanasov@protonmail.com
+ */
+
+#ifndef ST_SCENERY_HPP
+#define ST_SCENERY_HPP
+
+#include <game_manager/level/entity.hpp>
+#include <ST_util/bytell_hash_map.hpp>
+#include <vector>
+
+namespace ST {
+
+    ///Keeps track of the scenery of a level - the entities that never animate or move on their own.
+    /**
+     * Scenery is split in square chunks of the level, each one is rendered once in a texture and drawn with a single copy.
+     * A chunk is marked dirty when any of its entities changes and has to be rendered again.
+     * Only the scenery at the start of the level (before the first entity that isn't scenery) is put in chunks, as the
+     * chunks are drawn below all other entities.
+     */
+    class scenery {
+    public:
+        //chunks are chunk_size x chunk_size pixels of the level
+        static constexpr uint8_t chunk_shift = 9;
+        static constexpr uint16_t chunk_size = 1U << chunk_shift;
+
+        ///A chunk of the level and the scenery entities that overlap it.
+        struct chunk {
+            std::vector<uint32_t> entities{}; //sorted, so they are drawn in the same order as the level
+            bool dirty = true;
+            uint32_t last_drawn = 0;
+        };
+
+        ska::bytell_hash_map<uint64_t, chunk> chunks{};
+
+        static bool is_scenery(const ST::entity& arg);
+        static uint64_t get_chunk_key(int32_t column, int32_t row);
+        void update(const std::vector<ST::entity>& entities);
+        void invalidate();
+        void invalidate_texture(uint16_t texture);
+        void clear();
+        [[nodiscard]] bool is_baked(uint32_t id) const;
+
+    private:
+        //the entities as they were at the last update and whether each of them is in the chunks
+        std::vector<ST::entity> entities_snapshot{};
+        std::vector<bool> baked{};
+
+        void insert(uint32_t id, const ST::entity& arg);
+        void remove(uint32_t id, const ST::entity& arg);
+    };
+
+    //INLINED METHODS
+
+    /**
+     * @param id The id of an entity.
+     * @return True if the entity is drawn as part of a chunk.
+     */
+    inline bool scenery::is_baked(uint32_t id) const {
+        return id < baked.size() && baked[id];
+    }
+}
+
+#endif //ST_SCENERY_HPP
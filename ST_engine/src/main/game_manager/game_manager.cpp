@@ -8,8 +8,10 @@
  */
 
 #include <game_manager/game_manager.hpp>
+#include <ST_util/string_util.hpp>
 #include <algorithm>
 #include <SDL_events.h>
+#include <SDL_timer.h>
 #include <fstream>
 
 
@@ -35,6 +37,7 @@ game_manager::game_manager(message_bus &gMessageBus) : gMessage_bus(gMessageBus)
     gMessage_bus.subscribe(START_LEVEL, &msg_sub);
     gMessage_bus.subscribe(UNLOAD_LEVEL, &msg_sub);
     gMessage_bus.subscribe(RELOAD_LEVEL, &msg_sub);
+    gMessage_bus.subscribe(LOAD_LIST_PROGRESS, &msg_sub);
     gMessage_bus.subscribe(KEY_PRESSED, &msg_sub);
     gMessage_bus.subscribe(KEY_HELD, &msg_sub);
     gMessage_bus.subscribe(KEY_RELEASED, &msg_sub);
@@ -93,6 +96,9 @@ void game_manager::handle_messages(){
             case UNLOAD_LEVEL:
                 unload_level(*static_cast<std::string*>(temp->get_data()));
                 break;
+            case LOAD_LIST_PROGRESS:
+                update_level_load_progress(*static_cast<std::string*>(temp->get_data()), temp->base_data0);
+                break;
             case KEY_PRESSED: {
                 uint8_t key_index = temp->base_data0;
                 keys_pressed_data[key_index] = true;
@@ -213,6 +219,9 @@ int8_t game_manager::load_level(const std::string& level_name){
  * @param level_name The name of the level to unload (this must the name of the folder).
  */
 void game_manager::unload_level(const std::string& level_name){
+    if(pending_level == level_name){
+        pending_level.clear();
+    }
     for(uint64_t i = 0; i < levels.size(); ++i) {
         if (levels[i].get_name() == level_name) {
             levels[i].unload();
@@ -248,36 +257,53 @@ void game_manager::reload_level(const std::string& level_name){
 
 /**
  * Starts a level given it's name.
+ * If another level is running, it keeps running until the assets of the new level are resident
+ * and the switch happens once the assets_manager reports the asset list as fully loaded.
  * @param level_name The name of the level to start (this must the name of the folder).
  */
 void game_manager::start_level(const std::string& level_name) {
 
-    //set the current level pointer
-    bool is_loaded = false;
+    //if the level wasn't loaded in advance, load it now
+    if(load_level(level_name) != 0){
+        gMessage_bus.send_msg(new message(LOG_ERROR, make_data<std::string>("Error starting level " + level_name)));
+        return;
+    }
+
+    //nothing is running yet, so there is nothing to keep on screen while loading
+    if(current_level_pointer == nullptr){
+        switch_level(level_name);
+        return;
+    }
+
     for (auto &level : levels) {
         if(level.get_name() == level_name) {
-            current_level_pointer = &level;
-            is_loaded = true;
+            if(level.assets_resident){
+                switch_level(level_name);
+            }else{
+                pending_level = level_name;
+                gMessage_bus.send_msg(new message(LOG_INFO, make_data<std::string>("Streaming level " + level_name)));
+            }
             break;
         }
     }
-    //if the level wasn't loaded in advance, load it now
-    if(!is_loaded){
-        if(load_level(level_name) == 0) {
-            for (auto &level : levels) {
-                if (level.get_name() == level_name) {
-                    current_level_pointer = &level;
-                    break;
-                }
-            }
-        } else {
-            gMessage_bus.send_msg(new message(LOG_ERROR, make_data<std::string>("Error starting level " + level_name)));
-            return;
+}
+
+/**
+ * Switches to a loaded level and runs its level.lua script.
+ * @param level_name The name of the level to switch to (this must the name of the folder).
+ */
+void game_manager::switch_level(const std::string& level_name) {
+
+    //set the current level pointer
+    for (auto &level : levels) {
+        if(level.get_name() == level_name) {
+            current_level_pointer = &level;
+            break;
         }
     }
+    pending_level.clear();
 
-    gScript_backend.close();
-    gScript_backend.initialize(&gMessage_bus, this);
+    gScript_backend.start_level();
     active_level = level_name;
 
     get_level()->lights.clear();
@@ -294,6 +320,66 @@ void game_manager::start_level(const std::string& level_name) {
     gScript_backend.run_file(temp);
 }
 
+/**
+ * Updates the asset streaming progress of the level using the given asset list.
+ * Switches to the pending level once all of its assets are loaded.
+ * @param list The path to the asset list, as sent in the LOAD_LIST_PROGRESS message.
+ * @param loaded_total The first 16 bits are the assets loaded so far, the last 16 the total.
+ */
+void game_manager::update_level_load_progress(const std::string& list, uint32_t loaded_total) {
+    for (auto &level : levels) {
+        if(level.get_assets_list() == list) {
+            level.assets_loaded = loaded_total & 0x0000ffffU;
+            level.assets_total = (loaded_total >> 16U) & 0x0000ffffU;
+            level.assets_resident = level.assets_loaded == level.assets_total;
+            if(level.assets_resident) {
+                //wake up the Lua tasks waiting for the level
+                gScript_backend.signal(ST::hash_string("levelLoaded " + level.get_name()));
+            }
+            if(level.assets_resident && level.get_name() == pending_level) {
+                std::string level_name = pending_level;
+                switch_level(level_name);
+            }
+            break;
+        }
+    }
+}
+
+/**
+ * Get the asset loading progress of a level.
+ * @param level_name The name of the level.
+ * @return The percentage of the assets of the level that are loaded, 0 if the level isn't loaded.
+ */
+uint8_t game_manager::get_level_load_progress(const std::string& level_name) const {
+    for (const auto &level : levels) {
+        if(level.get_name() == level_name) {
+            if(level.assets_resident) {
+                return 100;
+            } else if(level.assets_total == 0) {
+                return 0;
+            }
+            return static_cast<uint8_t>(level.assets_loaded * 100 / level.assets_total);
+        }
+    }
+    return 0;
+}
+
+/**
+ * Collects Lua garbage in the time left in a frame.
+ * The time spent and the size of the Lua heap are sent for the fps overlay, a few times per second.
+ * @param time_budget The time in milliseconds that can be spent collecting garbage.
+ */
+void game_manager::collect_garbage(double time_budget) {
+    gScript_backend.collect_garbage(time_budget);
+    uint32_t ticks = SDL_GetTicks();
+    if(ticks - gc_stats_sent_at > 64){
+        auto gc_time = static_cast<uint32_t>(std::min(gScript_backend.get_gc_time() * 1000, 65535.0));
+        uint32_t heap_size = std::min<uint32_t>(gScript_backend.get_heap_size(), 65535);
+        gMessage_bus.send_msg(new message(LUA_GC_STATS, gc_time | heap_size << 16U));
+        gc_stats_sent_at = ticks;
+    }
+}
+
 /**
  * Closes the game manager and the lua backend.
  */
@@ -20,10 +20,12 @@
 
 ///This class is responsible for managing all levels and the lua backend, it is the heart of the engine.
 class game_manager{
+    friend class game_manager_test;
     private:
 
         std::vector<ST::level> levels{};
         std::string active_level{};
+        std::string pending_level{}; //started, but waiting for its assets to become resident
         ST::level* current_level_pointer{};
         subscriber msg_sub{};
         std::atomic_bool game_is_running_{};
@@ -44,6 +46,7 @@ class game_manager{
 
         int16_t v_width = 1920;
         int16_t v_height = 1080;
+        uint32_t gc_stats_sent_at = 0; //the ticks when the Lua garbage collector stats were last sent
 
 
     //methods
@@ -52,6 +55,8 @@ class game_manager{
         void unload_level(const std::string&);
         void reload_level(const std::string&);
         void start_level(const std::string&);
+        void switch_level(const std::string&);
+        void update_level_load_progress(const std::string&, uint32_t);
         void reset_keys();
         void run_level_loop();
 
@@ -66,6 +71,7 @@ class game_manager{
         explicit game_manager(message_bus& msg_bus);
         ~game_manager();
         [[nodiscard]] std::string get_active_level() const;
+        [[nodiscard]] uint8_t get_level_load_progress(const std::string& level_name) const;
         [[nodiscard]] bool key_pressed(uint16_t arg) const;
         [[nodiscard]] bool key_held(uint16_t arg) const;
         [[nodiscard]] bool key_released(uint16_t arg) const;
@@ -78,6 +84,7 @@ class game_manager{
         [[nodiscard]] int16_t get_right_stick_vertical() const;
         [[nodiscard]] int16_t get_right_stick_horizontal() const;
         void update();
+        void collect_garbage(double time_budget);
         [[nodiscard]] bool game_is_running() const;
         [[nodiscard]] ST::level* get_level() const;
         void center_camera_on_entity(uint64_t id);
@@ -87,11 +94,12 @@ class game_manager{
 //INLINED METHODS
 
 /**
- * Listens to messages and runs one iteration of loop.lua for the specific level.
+ * Listens to messages, runs one iteration of loop.lua for the specific level and resumes the Lua tasks that are due.
  */
 inline void game_manager::update(){
     handle_messages();
     run_level_loop();
+    gScript_backend.run_tasks();
 }
 
 /**
@@ -39,8 +39,8 @@ int8_t ST::level::load(){
             }
         }
     }
-    std::string temp = "levels/" + name + "/assets.list";
-    gMessage_bus->send_msg(new message(LOAD_LIST, make_data(temp)));
+    assets_resident = false;
+    gMessage_bus->send_msg(new message(LOAD_LIST, make_data(get_assets_list())));
     return 0;
 }
 
@@ -48,7 +48,8 @@ int8_t ST::level::load(){
  * reloads the level.
  */
 void ST::level::reload(){
-    std::string temp = "levels/" + name + "/assets.list";
+    std::string temp = get_assets_list();
+    assets_resident = false;
     gMessage_bus->send_msg(new message(UNLOAD_LIST, make_data(temp)));
     for(const auto &i : actions_buttons) {
         for(const auto &key : i.second){
@@ -77,6 +78,14 @@ std::string ST::level::get_name() const{
     return name;
 }
 
+/**
+ * Get the path to the assets.list of the level.
+ * @return The path to the list of assets this level uses.
+ */
+std::string ST::level::get_assets_list() const{
+    return "levels/" + name + "/assets.list";
+}
+
 /**
  * Destroys the level.
  * Frees all data.
@@ -95,6 +104,14 @@ ST::level::~level(){
     lights.clear();
 }
 
+/**
+ * Brings the spatial index of the entities up to date with their positions.
+ * Should be called after the entities are updated and before they are drawn.
+ */
+void ST::level::update_entity_index(){
+    entity_index.update(entities);
+}
+
 /**
  * Unloads a level.
  * Sends a UNLOAD_LIST message to unload all assets and unregisters all keys.
@@ -107,14 +124,15 @@ void ST::level::unload(){
             }        }
     }
     //unload assets
-    std::string temp = "levels/" + name + "/assets.list";
-    gMessage_bus->send_msg(new message(UNLOAD_LIST, make_data(temp)));
+    gMessage_bus->send_msg(new message(UNLOAD_LIST, make_data(get_assets_list())));
+    assets_resident = false;
 
     //unload inputConf
     actions_buttons.clear();
 
     //unload entities
     entities.clear();
+    entity_index.clear();
 
     //unload text objects
     text_objects.clear();
@@ -12,6 +12,7 @@
 
 #include <key_definitions.hpp>
 #include <game_manager/level/entity.hpp>
+#include <game_manager/level/spatial_index.hpp>
 #include <game_manager/level/text.hpp>
 #include <game_manager/level/light.hpp>
 #include <message_bus.hpp>
@@ -45,6 +46,7 @@ namespace ST {
          */
         ska::bytell_hash_map<uint16_t , std::vector<ST::key>> actions_buttons{};
         std::vector<ST::entity> entities{};
+        ST::spatial_index entity_index{};
         std::vector<ST::light> lights{};
         std::vector<ST::text> text_objects{};
         uint16_t background [PARALLAX_BG_LAYERS] = {65535, 65535, 65535, 65535};
@@ -54,11 +56,18 @@ namespace ST {
         uint8_t overlay_sprite_num = 1;
         ST::camera camera = {0, 0, -1, 1920, 0, 1080};
 
+        //Asset streaming progress - updated by the game_manager from LOAD_LIST_PROGRESS messages.
+        uint16_t assets_loaded = 0;
+        uint16_t assets_total = 0;
+        bool assets_resident = false;
+
         level(const std::string&, message_bus*);
         int8_t load();
         void reload();
         void unload();
+        void update_entity_index();
         [[nodiscard]] std::string get_name() const;
+        [[nodiscard]] std::string get_assets_list() const;
         ~level();
         int8_t load_input_conf();
     };
@@ -0,0 +1,133 @@
+/* This file is part of the "ST" project.
+ * You may use, distribute or modify this code under the terms
+ * of the GNU General Public License version 2.
+ * See LICENCE.txt in the root directory of the project.
+ *
+ * Author: Maxim Atanasov
+ * E-mail: maxim.atanasov@protonmail.com
+ */
+
+#include <game_manager/level/spatial_index.hpp>
+#include <algorithm>
+
+/**
+ * Brings the index up to date with the entities.
+ * Only the entities that moved to other cells (or changed their size or static toggle) are moved in the grid.
+ * If there are fewer entities than before the index is built again.
+ * @param entities All entities in the level, their ids are their indexes in this vector.
+ */
+void ST::spatial_index::update(const std::vector<ST::entity>& entities) {
+    if(entities.size() < entity_cells.size()){
+        clear();
+    }
+    entity_cells.resize(entities.size());
+    for(uint32_t i = 0; i < entities.size(); i++){
+        cell_range range = get_cell_range(entities[i]);
+        if(range != entity_cells[i]){
+            remove(i, entity_cells[i]);
+            insert(i, range);
+            entity_cells[i] = range;
+        }
+    }
+}
+
+/**
+ * Finds the entities that may be inside a rectangle.
+ * The result has every entity in a cell the rectangle touches as well as all static entities, it should still be
+ * checked against the exact bounds of each entity.
+ * @param x The left side of the rectangle.
+ * @param y The top side of the rectangle.
+ * @param width The width of the rectangle.
+ * @param height The height of the rectangle.
+ * @param result Filled with the sorted ids of the entities, without duplicates. Its memory is reused.
+ */
+void ST::spatial_index::query(int32_t x, int32_t y, int32_t width, int32_t height, std::vector<uint32_t>& result) const {
+    result.clear();
+    result.insert(result.end(), static_entities.begin(), static_entities.end());
+    for(int32_t row = y >> cell_shift; row <= (y + height) >> cell_shift; row++){
+        for(int32_t column = x >> cell_shift; column <= (x + width) >> cell_shift; column++){
+            auto found = cells.find(get_cell_key(column, row));
+            if(found != cells.end()){
+                result.insert(result.end(), found->second.begin(), found->second.end());
+            }
+        }
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+}
+
+/**
+ * Removes all entities from the index.
+ */
+void ST::spatial_index::clear() {
+    cells.clear();
+    entity_cells.clear();
+    static_entities.clear();
+}
+
+/**
+ * @param arg An entity.
+ * @return The cells the texture of the entity overlaps.
+ */
+ST::spatial_index::cell_range ST::spatial_index::get_cell_range(const ST::entity& arg) {
+    if(arg.is_static()){
+        return cell_range{0, 0, -1, -1, true};
+    }
+    auto width = static_cast<int32_t>(static_cast<float>(arg.tex_w) * arg.tex_scale_x);
+    auto height = static_cast<int32_t>(static_cast<float>(arg.tex_h) * arg.tex_scale_y);
+    return cell_range{std::min(arg.x, arg.x + width) >> cell_shift, std::min(arg.y - height, arg.y) >> cell_shift,
+                      std::max(arg.x, arg.x + width) >> cell_shift, std::max(arg.y - height, arg.y) >> cell_shift, false};
+}
+
+/**
+ * @param column The column of a cell.
+ * @param row The row of a cell.
+ * @return The key of the cell in the grid.
+ */
+uint64_t ST::spatial_index::get_cell_key(int32_t column, int32_t row) {
+    return static_cast<uint64_t>(static_cast<uint32_t>(column)) << 32U | static_cast<uint32_t>(row);
+}
+
+/**
+ * Adds an entity to the cells in a range.
+ * @param id The id of the entity.
+ * @param range The cells to add it to.
+ */
+void ST::spatial_index::insert(uint32_t id, const cell_range& range) {
+    if(range.is_static){
+        static_entities.emplace_back(id);
+        return;
+    }
+    for(int32_t row = range.first_row; row <= range.last_row; row++){
+        for(int32_t column = range.first_column; column <= range.last_column; column++){
+            cells[get_cell_key(column, row)].emplace_back(id);
+        }
+    }
+}
+
+/**
+ * Removes an entity from the cells in a range.
+ * @param id The id of the entity.
+ * @param range The cells to remove it from.
+ */
+void ST::spatial_index::remove(uint32_t id, const cell_range& range) {
+    auto remove_id = [id](std::vector<uint32_t>& ids){
+        auto found = std::find(ids.begin(), ids.end(), id);
+        if(found != ids.end()){
+            *found = ids.back();
+            ids.pop_back();
+        }
+    };
+    if(range.is_static){
+        remove_id(static_entities);
+        return;
+    }
+    for(int32_t row = range.first_row; row <= range.last_row; row++){
+        for(int32_t column = range.first_column; column <= range.last_column; column++){
+            auto found = cells.find(get_cell_key(column, row));
+            if(found != cells.end()){
+                remove_id(found->second);
+            }
+        }
+    }
+}
@@ -0,0 +1,57 @@
+/* This file is part of the "ST" project.
+ * You may use, distribute or modify this code under the terms
+ * of the GNU General Public License version 2.
+ * See LICENCE.txt in the root directory of the project.
+ *
+ * Author: Maxim Atanasov
+ * E-mail: maxim.atanasov@protonmail.com
+ */
+
+#ifndef ST_SPATIAL_INDEX_HPP
+#define ST_SPATIAL_INDEX_HPP
+
+#include <game_manager/level/entity.hpp>
+#include <ST_util/bytell_hash_map.hpp>
+#include <vector>
+
+namespace ST {
+
+    ///A grid of the entities in a level, used to find the ones inside a rectangle without going through all of them.
+    /**
+     * Every cell of the grid holds the ids (indexes) of the entities whose texture overlaps it.
+     * Static entities don't move with the camera and are kept in a separate list.
+     * The grid persists between frames - update() only moves the entities whose cells changed.
+     */
+    class spatial_index {
+    public:
+        //cells are cell_size x cell_size pixels, cell_size = 1 << cell_shift
+        static constexpr uint8_t cell_shift = 8;
+
+        void update(const std::vector<ST::entity>& entities);
+        void query(int32_t x, int32_t y, int32_t width, int32_t height, std::vector<uint32_t>& result) const;
+        void clear();
+
+    private:
+        ///The cells an entity is in, from the first row and column to the last ones (inclusive).
+        struct cell_range {
+            int32_t first_column = 0;
+            int32_t first_row = 0;
+            int32_t last_column = -1;
+            int32_t last_row = -1;
+            bool is_static = false;
+
+            bool operator==(const cell_range&) const = default;
+        };
+
+        ska::bytell_hash_map<uint64_t, std::vector<uint32_t>> cells{};
+        std::vector<cell_range> entity_cells{};
+        std::vector<uint32_t> static_entities{};
+
+        static cell_range get_cell_range(const ST::entity& arg);
+        static uint64_t get_cell_key(int32_t column, int32_t row);
+        void insert(uint32_t id, const cell_range& range);
+        void remove(uint32_t id, const cell_range& range);
+    };
+}
+
+#endif //ST_SPATIAL_INDEX_HPP
@@ -39,9 +39,56 @@ namespace ST {
         //1 byte
         bool is_visible = true;
 
-        //1 byte padding
-        uint8_t padding{};
+        //1 byte
+        //the drawing_manager measures the text once and caches the size until the text or font change
+        mutable bool is_measured = false;
+
+        //4 bytes
+        mutable uint16_t width = 0;
+        mutable uint16_t height = 0;
+
+        //1 byte
+        //the drawing_manager keeps the text rendered in a texture until the text, font or color change
+        mutable bool is_rendered = false;
+
+        //3 bytes padding
+        uint8_t padding[3]{};
+
+        void set_text_string(const std::string& arg);
+        void set_font(uint16_t arg);
+        void set_color(SDL_Color arg);
     };
+
+    //INLINED METHODS
+
+    /**
+     * Sets the text and drops the cached size and texture.
+     * @param arg The new text.
+     */
+    inline void text::set_text_string(const std::string& arg) {
+        text_string = arg;
+        is_measured = false;
+        is_rendered = false;
+    }
+
+    /**
+     * Sets the font and drops the cached size and texture.
+     * @param arg The hash of the name and size of the font.
+     */
+    inline void text::set_font(uint16_t arg) {
+        font = arg;
+        is_measured = false;
+        is_rendered = false;
+    }
+
+    /**
+     * Sets the color and drops the cached texture.
+     * @param arg The new color (RGBA).
+     */
+    inline void text::set_color(SDL_Color arg) {
+        color = arg;
+        is_rendered = false;
+    }
 }
 
 #endif
\ No newline at end of file
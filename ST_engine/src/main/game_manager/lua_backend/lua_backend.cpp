@@ -17,10 +17,17 @@
 #endif
 
 #include <ST_util/string_util.hpp>
+#include <ST_util/bytell_hash_map.hpp>
 #include <game_manager/level/light.hpp>
 #include "lua_backend.hpp"
 #include <fstream>
 #include <sstream>
+#include <iterator>
+#include <array>
+#include <cctype>
+#include <algorithm>
+#include <string_view>
+#include <chrono>
 #include <SDL_timer.h>
 
 //local to the file, as lua bindings cannot be in a class
@@ -30,6 +37,41 @@ static lua_backend* gLua_backendLua;
 
 static bool singleton_initialized = false;
 
+///A script compiled to Lua bytecode, along with the hash of the source it was compiled from.
+struct compiled_script {
+    uint64_t content_hash = 0;
+    std::string bytecode;
+};
+
+//Compiled scripts by path, kept for the whole run so they outlive the lua_backend
+static ska::bytell_hash_map<std::string, compiled_script> compiled_scripts;
+
+//The directory the compiled scripts are cached in between runs, empty if they are not
+static std::string bytecode_cache_dir;
+
+//The first word of a bytecode cache file
+static const std::string bytecode_cache_magic = "ST_LUAC";
+
+static std::string hash_script(std::string_view source, std::vector<std::string>* names);
+
+///A range of consecutive entities, passed to Lua as userdata so it can be read and written with a single call.
+struct entity_range {
+    uint64_t first = 0;
+    uint64_t count = 0;
+};
+
+//The name of the metatable of the entity_range userdata
+static const char* entity_range_metatable = "ST_entity_range";
+
+//The methods of the entity_range userdata
+static const luaL_Reg entity_range_methods[] = {
+        {"getPosition", entityRangeGetPositionLua},
+        {"setPosition", entityRangeSetPositionLua},
+        {"getVelocity", entityRangeGetVelocityLua},
+        {"setVelocity", entityRangeSetVelocityLua},
+        {nullptr, nullptr}
+};
+
 //TODO: Most of the functions here should be moved to the game_manager class and only act as simple proxies
 
 /**
@@ -52,6 +94,7 @@ int lua_backend::initialize(message_bus* msg_bus, game_manager* game_mngr) {
     gMessage_bus = msg_bus;
 
     //Initialize Lua
+    frame = 0;
     L = luaL_newstate();
     if(L == nullptr){
         fprintf(stderr, "ERROR: Could not initialize a Lua context");
@@ -59,6 +102,10 @@ int lua_backend::initialize(message_bus* msg_bus, game_manager* game_mngr) {
     }
     luaL_openlibs(L);
 
+    //garbage is only collected in collect_garbage(), in the time left in a frame
+    lua_gc(L, LUA_GCSTOP, 0);
+    finish_gc_cycle();
+
     //register lua binding functions
 
     lua_register(L, "logLua", logLua);
@@ -78,6 +125,7 @@ int lua_backend::initialize(message_bus* msg_bus, game_manager* game_mngr) {
     lua_register(L, "setBrightness", setBrightnessLua);
     lua_register(L, "startLevelLua", startLevelLua);
     lua_register(L, "reloadLevelLua", reloadLevelLua);
+    lua_register(L, "getLevelLoadProgress", getLevelLoadProgressLua);
     lua_register(L, "showMouseCursor", showMouseCursorLua);
     lua_register(L, "hideMouseCursor", hideMouseCursorLua);
     lua_register(L, "endGame", endGameLua);
@@ -89,8 +137,20 @@ int lua_backend::initialize(message_bus* msg_bus, game_manager* game_mngr) {
     lua_register(L, "unloadLevel", unload_levelLua);
 	lua_register(L, "loadAsset", loadAssetLua);
 	lua_register(L, "unloadAsset", unloadAssetLua);
+    lua_register(L, "loadAssetFromBinary", loadAssetFromBinaryLua);
+    lua_register(L, "unloadAssetFromBinary", unloadAssetFromBinaryLua);
     lua_register(L, "setInternalResolution", setInternalResolutionLua);
     lua_register(L, "setWindowResolution", setWindowResolutionLua);
+    lua_register(L, "setTextureBudget", setTextureBudgetLua);
+    lua_register(L, "getGarbageCollectorStats", getGarbageCollectorStatsLua);
+
+    //tasks
+    lua_register(L, "startTask", startTaskLua);
+    lua_register(L, "stopTask", stopTaskLua);
+    lua_register(L, "waitFrames", waitFramesLua);
+    lua_register(L, "waitTime", waitTimeLua);
+    lua_register(L, "waitForSignal", waitForSignalLua);
+    lua_register(L, "signal", signalLua);
 
     //Physics functions.
     lua_register(L, "setGravity", setGravityLua);
@@ -177,6 +237,19 @@ int lua_backend::initialize(message_bus* msg_bus, game_manager* game_mngr) {
     lua_register(L, "getEntityVelocityX", getEntityVelocityXLua);
     lua_register(L, "getEntityVelocityY", getEntityVelocityYLua);
 
+    //batch
+    lua_register(L, "getEntitiesPosition", getEntitiesPositionLua);
+    lua_register(L, "setEntitiesPosition", setEntitiesPositionLua);
+    lua_register(L, "getEntitiesVelocity", getEntitiesVelocityLua);
+    lua_register(L, "setEntitiesVelocity", setEntitiesVelocityLua);
+    lua_register(L, "getEntityRange", getEntityRangeLua);
+    luaL_newmetatable(L, entity_range_metatable);
+    luaL_newlib(L, entity_range_methods);
+    lua_setfield(L, -2, "__index");
+    lua_pushcfunction(L, entityRangeLengthLua);
+    lua_setfield(L, -2, "__len");
+    lua_pop(L, 1);
+
     //texture
     lua_register(L, "setEntityTexture", setEntityTextureLua);
     lua_register(L, "getEntityTexW", getEntityTexWLua);
@@ -214,17 +287,265 @@ int lua_backend::initialize(message_bus* msg_bus, game_manager* game_mngr) {
     luaL_dofile(L, "lua/ui/label.lua");
     luaL_dofile(L, "lua/ui/checkbox.lua");
 
+    start_level();
     return 0;
 }
 
+/**
+ * Starts a new level in the Lua State.
+ * The Lua State, the bindings and the shared modules are kept for the whole run, every level gets its own _ENV table
+ * that falls back to the global one, so the globals of the previous level are dropped along with its table.
+ */
+void lua_backend::start_level() {
+    luaL_unref(L, LUA_REGISTRYINDEX, level_env);
+    stop_tasks();
+
+    //reset the state the shared modules keep for a level
+    int32_t top = lua_gettop(L);
+    luaL_dofile(L, "lua/global_properties.lua");
+    lua_settop(L, top);
+    if(lua_getglobal(L, "resetLevelState") == LUA_TFUNCTION){
+        lua_pcall(L, 0, 0, 0);
+    }
+    lua_settop(L, top);
+
+    lua_newtable(L);
+    lua_newtable(L);
+    lua_pushglobaltable(L);
+    lua_setfield(L, -2, "__index");
+    lua_setmetatable(L, -2);
+    level_env = luaL_ref(L, LUA_REGISTRYINDEX);
+
+    //the previous level is garbage now, collect it while the new one is being set up rather than during gameplay
+    lua_gc(L, LUA_GCCOLLECT, 0);
+    finish_gc_cycle();
+}
+
+/**
+ * Collects Lua garbage in small steps until the time budget runs out or the collection cycle is finished.
+ * A cycle starts once the heap is twice the size it was at the end of the last one, like the automatic collector
+ * with its default pause, and at least one step is done each call until it finishes.
+ * If the heap still doubles during a cycle there is not enough time left in the frames and the cycle is finished
+ * at once, so the heap can't grow without a limit.
+ * @param time_budget The time in milliseconds that can be spent collecting garbage.
+ */
+void lua_backend::collect_garbage(double time_budget) {
+    auto start = std::chrono::high_resolution_clock::now();
+    auto heap = get_heap_size();
+    if(!gc_cycle_running && heap >= gc_threshold){
+        gc_cycle_running = true;
+    }
+    if(gc_cycle_running){
+        if(heap >= gc_threshold * 2) [[unlikely]] {
+            lua_gc(L, LUA_GCCOLLECT, 0);
+            finish_gc_cycle();
+        }else{
+            std::chrono::duration<double, std::milli> elapsed{};
+            do{
+                if(lua_gc(L, LUA_GCSTEP, 0)){
+                    finish_gc_cycle();
+                    break;
+                }
+                elapsed = std::chrono::high_resolution_clock::now() - start;
+            }while(elapsed.count() < time_budget);
+        }
+    }
+    gc_time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+/**
+ * Starts a task - a coroutine resumed by run_tasks() until it finishes.
+ * The task is first resumed in the next call to run_tasks().
+ * @param state The Lua thread that starts the task, with the thread of the task on top of its stack.
+ * The thread of the task must contain the function of the task and its arguments.
+ * @param nargs The number of arguments.
+ * @return The id of the task.
+ */
+uint32_t lua_backend::start_task(lua_State* state, int32_t nargs) {
+    uint32_t id = next_task_id++;
+    //the number of arguments is kept on the thread for the first resume
+    lua_pushinteger(lua_tothread(state, -1), nargs);
+    tasks[id] = luaL_ref(state, LUA_REGISTRYINDEX);
+    ready_tasks.emplace_back(id);
+    return id;
+}
+
+/**
+ * Stops a task, it is not resumed anymore.
+ * @param id The id of the task.
+ */
+void lua_backend::stop_task(uint32_t id) {
+    auto task = tasks.find(id);
+    if(task != tasks.end()){
+        luaL_unref(L, LUA_REGISTRYINDEX, task->second);
+        tasks.erase(task);
+    }
+}
+
+/**
+ * Stops all tasks, they belong to the level that started them.
+ */
+void lua_backend::stop_tasks() {
+    for(auto& task : tasks){
+        luaL_unref(L, LUA_REGISTRYINDEX, task.second);
+    }
+    tasks.clear();
+    ready_tasks.clear();
+    frame_waits = task_wait_queue();
+    time_waits = task_wait_queue();
+    signal_waits.clear();
+}
+
+/**
+ * Suspends the running task for a number of frames.
+ * Must be returned from the Lua binding that called it.
+ * @param thread The thread of the Lua binding.
+ * @param frames The number of calls to run_tasks() to wait for.
+ * @return The result of lua_yield, or 0 if not called from a task.
+ */
+int lua_backend::wait_frames(lua_State* thread, uint32_t frames) {
+    if(current_task == 0 || thread == L) [[unlikely]] {
+        gMessage_bus->send_msg(new message(LOG_ERROR, make_data<std::string>("Can only wait inside a task")));
+        return 0;
+    }
+    frame_waits.emplace(frame + frames, current_task);
+    return lua_yield(thread, 0);
+}
+
+/**
+ * Suspends the running task for some time.
+ * Must be returned from the Lua binding that called it.
+ * @param thread The thread of the Lua binding.
+ * @param ms The time to wait for in milliseconds.
+ * @return The result of lua_yield, or 0 if not called from a task.
+ */
+int lua_backend::wait_time(lua_State* thread, uint32_t ms) {
+    if(current_task == 0 || thread == L) [[unlikely]] {
+        gMessage_bus->send_msg(new message(LOG_ERROR, make_data<std::string>("Can only wait inside a task")));
+        return 0;
+    }
+    time_waits.emplace(SDL_GetTicks() + ms, current_task);
+    return lua_yield(thread, 0);
+}
+
+/**
+ * Suspends the running task until a signal is sent.
+ * Must be returned from the Lua binding that called it.
+ * @param thread The thread of the Lua binding.
+ * @param signal The hash of the name of the signal.
+ * @return The result of lua_yield, or 0 if not called from a task.
+ */
+int lua_backend::wait_signal(lua_State* thread, uint16_t signal) {
+    if(current_task == 0 || thread == L) [[unlikely]] {
+        gMessage_bus->send_msg(new message(LOG_ERROR, make_data<std::string>("Can only wait inside a task")));
+        return 0;
+    }
+    signal_waits[signal].emplace_back(current_task);
+    return lua_yield(thread, 0);
+}
+
+/**
+ * Sends a signal, the tasks waiting for it are resumed in the next call to run_tasks().
+ * @param signal The hash of the name of the signal.
+ */
+void lua_backend::signal(uint16_t signal) {
+    auto waiting = signal_waits.find(signal);
+    if(waiting != signal_waits.end()){
+        ready_tasks.insert(ready_tasks.end(), waiting->second.begin(), waiting->second.end());
+        signal_waits.erase(waiting);
+    }
+}
+
+/**
+ * Resumes the tasks that are due - the new ones, the ones whose frame or time has come and the ones whose signal
+ * was sent. Waiting tasks are kept in queues sorted by frame and time, so the ones that are not due cost nothing.
+ */
+void lua_backend::run_tasks() {
+    ++frame;
+    while(!frame_waits.empty() && frame_waits.top().first <= frame){
+        ready_tasks.emplace_back(frame_waits.top().second);
+        frame_waits.pop();
+    }
+    uint32_t ticks = SDL_GetTicks();
+    while(!time_waits.empty() && time_waits.top().first <= ticks){
+        ready_tasks.emplace_back(time_waits.top().second);
+        time_waits.pop();
+    }
+    if(ready_tasks.empty()){
+        return;
+    }
+
+    //tasks made ready while these run (by a signal or a new task) are resumed in the next frame
+    std::vector<uint32_t> due;
+    due.swap(ready_tasks);
+    for(uint32_t id : due){
+        auto task = tasks.find(id);
+        if(task == tasks.end()){
+            //stopped
+            continue;
+        }
+        //the thread is kept on the main stack while it runs, so stopping the task can't free it
+        lua_rawgeti(L, LUA_REGISTRYINDEX, task->second);
+        lua_State* thread = lua_tothread(L, -1);
+        int32_t nargs = 0;
+        if(lua_status(thread) == LUA_OK){
+            //first resume, the number of arguments is on top of the function and its arguments
+            nargs = static_cast<int32_t>(lua_tointeger(thread, -1));
+            lua_pop(thread, 1);
+        }
+        current_task = id;
+        int status = lua_resume(thread, L, nargs);
+        current_task = 0;
+        if(status != LUA_YIELD){
+            if(status != LUA_OK && lua_type(thread, -1) == LUA_TSTRING){
+                gMessage_bus->send_msg(new message(LOG_ERROR, make_data<std::string>(lua_tostring(thread, -1))));
+            }
+            stop_task(id);
+        }
+        lua_pop(L, 1);
+    }
+}
+
+/**
+ * Sets the heap size at which the next garbage collection cycle starts, after one has finished.
+ */
+void lua_backend::finish_gc_cycle() {
+    gc_cycle_running = false;
+    gc_threshold = std::max<uint32_t>(get_heap_size() * 2, 1024);
+}
+
+/**
+ * @return The time in milliseconds spent collecting garbage in the last call to collect_garbage().
+ */
+double lua_backend::get_gc_time() const {
+    return gc_time;
+}
+
+/**
+ * @return The size of the Lua heap in kilobytes.
+ */
+uint32_t lua_backend::get_heap_size() const {
+    return static_cast<uint32_t>(lua_gc(L, LUA_GCCOUNT, 0));
+}
+
+/**
+ * Sets the _ENV of the chunk on top of the stack to the table of the current level.
+ */
+void lua_backend::set_level_env() {
+    lua_rawgeti(L, LUA_REGISTRYINDEX, level_env);
+    lua_setupvalue(L, -2, 1);
+}
+
 /**
  * Run a lua script inside the global Lua state.
  * @param file The path to the file.
  * @return -1 on failure or 0 on success.
  */
 int8_t lua_backend::run_file(const std::string& file){
-    std::string temp = hash_file(file);
-    int status = luaL_loadbuffer(L, temp.c_str(), temp.size(), file.c_str());
+    int status = load_script(file);
+    if(status == LUA_OK) [[likely]] {
+        set_level_env();
+    }
     if (status == LUA_ERRSYNTAX || status == LUA_ERRFILE || lua_pcall(L, 0, 0, 0)){
         fprintf(stderr, "cannot compile script\n");
         lua_error(L);
@@ -240,8 +561,10 @@ int8_t lua_backend::run_file(const std::string& file){
  * @return ABORTS THE APP on failure or returns 0 on success.
  */
 int8_t lua_backend::load_file(const std::string& file){
-    std::string temp = hash_file(file);
-    int status = luaL_loadbuffer(L, temp.c_str(), temp.size(), file.c_str());
+    int status = load_script(file);
+    if(status == LUA_OK) [[likely]] {
+        set_level_env();
+    }
     if (status == LUA_ERRSYNTAX || status == LUA_ERRFILE){
         fprintf(stderr, "cannot compile script\n");
         lua_error(L);
@@ -251,6 +574,180 @@ int8_t lua_backend::load_file(const std::string& file){
     }
 }
 
+/**
+ * FNV-1a hash of the contents of a script.
+ * @param content The contents of the script.
+ * @return The hash.
+ */
+static uint64_t hash_script_content(const std::string& content){
+    uint64_t hash = 14695981039346656037ULL;
+    for(char c : content){
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * Appends a piece of bytecode to a string, used as the lua_Writer for lua_dump.
+ * @return Always 0.
+ */
+static int write_bytecode(lua_State*, const void* data, size_t size, void* bytecode){
+    static_cast<std::string*>(bytecode)->append(static_cast<const char*>(data), size);
+    return 0;
+}
+
+/**
+ * Sets the directory compiled scripts are cached in between runs.
+ * Bytecode is loaded from there without being verified, so it must be a directory only the user can write to,
+ * such as the one from SDL_GetPrefPath(). Scripts are only cached in memory while it is empty.
+ * @param dir The directory, ending with a path separator.
+ */
+void lua_backend::set_bytecode_cache(const std::string& dir){
+    bytecode_cache_dir = dir;
+}
+
+/**
+ * Gets the path to the file a script is cached in, named after the hash of the path to the script.
+ * @param file The path to the script.
+ * @return The path to the cache file.
+ */
+static std::string get_bytecode_cache_path(const std::string& file){
+    std::stringstream path;
+    path << bytecode_cache_dir << std::hex << hash_script_content(file) << ".luac";
+    return path.str();
+}
+
+/**
+ * Reads the bytecode cached on disk for a script.
+ * The cache file starts with a line with the magic, the Lua version, the hash of the source, the hash of the
+ * bytecode and the number of hashed strings, followed by one line for each string hashed in the script and the bytecode.
+ * The bytecode is only valid if every string still gets the same id, which is checked here.
+ * @param file The path to the script.
+ * @param content_hash The hash of the current source of the script.
+ * @param bytecode The bytecode is written to this.
+ * @return True if the cache is valid.
+ */
+static bool read_bytecode_cache(const std::string& file, uint64_t content_hash, std::string& bytecode){
+    if(bytecode_cache_dir.empty()){
+        return false;
+    }
+    std::ifstream cache(get_bytecode_cache_path(file), std::ios::binary);
+    std::string magic;
+    std::string release;
+    uint32_t version = 0;
+    uint64_t hash = 0;
+    uint64_t bytecode_hash = 0;
+    uint32_t names = 0;
+    if(!(cache >> magic >> version >> release >> std::hex >> hash >> bytecode_hash >> std::dec >> names)
+    || magic != bytecode_cache_magic || version != LUA_VERSION_NUM || release != LUA_VERSION_RELEASE
+    || hash != content_hash){
+        return false;
+    }
+    cache.ignore(1);
+    for(uint32_t i = 0; i < names; i++){
+        std::string name;
+        getline(cache, name);
+        if(ST::hash_string(name) != ST::fnv_hash_string(name)){
+            return false;
+        }
+    }
+    bytecode.assign(std::istreambuf_iterator<char>(cache), std::istreambuf_iterator<char>());
+    if(bytecode.empty() || hash_script_content(bytecode) != bytecode_hash){
+        bytecode.clear();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Writes the bytecode of a script to disk, see read_bytecode_cache().
+ * Nothing is written if a hashed string got a different id than its ST::fnv_hash_string(), as it would not get
+ * the same id in the next run. The file is written under another name and renamed, so a run that stops halfway
+ * through never leaves a partial cache file behind.
+ * @param file The path to the script.
+ * @param content_hash The hash of the source of the script.
+ * @param names The strings hashed in the script.
+ * @param bytecode The bytecode.
+ */
+static void write_bytecode_cache(const std::string& file, uint64_t content_hash, const std::vector<std::string>& names,
+                                 const std::string& bytecode){
+    if(bytecode_cache_dir.empty()){
+        return;
+    }
+    for(const auto& name : names){
+        if(ST::hash_string(name) != ST::fnv_hash_string(name)){
+            return;
+        }
+    }
+    std::string path = get_bytecode_cache_path(file);
+    std::string temp_path = path + ".tmp";
+    std::ofstream cache(temp_path, std::ios::binary);
+    cache << bytecode_cache_magic << " " << LUA_VERSION_NUM << " " << LUA_VERSION_RELEASE << " " << std::hex
+          << content_hash << " " << hash_script_content(bytecode) << std::dec << " " << names.size() << "\n";
+    for(const auto& name : names){
+        cache << name << "\n";
+    }
+    cache.write(bytecode.data(), static_cast<std::streamsize>(bytecode.size()));
+    cache.close();
+    if(cache.fail()){
+        remove(temp_path.c_str());
+        return;
+    }
+#ifdef _MSC_VER
+    //rename does not replace files on Windows
+    remove(path.c_str());
+#endif
+    if(rename(temp_path.c_str(), path.c_str()) != 0){
+        remove(temp_path.c_str());
+    }
+}
+
+/**
+ * Loads a script into the global Lua State, compiling it only if it changed.
+ * Compiled scripts are cached as bytecode in memory and in the directory given to set_bytecode_cache(), and only
+ * used while the hash of the source and the Lua version still match.
+ * Scripts are always loaded as text, so a file with bytecode in it is never run.
+ * @param file The path to the script.
+ * @return The status returned by luaL_loadbuffer.
+ */
+int lua_backend::load_script(const std::string& file){
+    std::ifstream source_file(file, std::ios::binary);
+    if(!source_file.is_open()){
+        //a missing script is only reported, it is loaded as an empty one
+        gMessage_bus->send_msg(new message(LOG_ERROR, make_data<std::string>("File " + file + " not found")));
+        return luaL_loadbuffer(L, "", 0, file.c_str());
+    }
+    std::string source((std::istreambuf_iterator<char>(source_file)), std::istreambuf_iterator<char>());
+    source_file.close();
+    uint64_t content_hash = hash_script_content(source);
+
+    compiled_script& compiled = compiled_scripts[file];
+    if(compiled.content_hash != content_hash || compiled.bytecode.empty()){
+        compiled.content_hash = content_hash;
+        compiled.bytecode.clear();
+        read_bytecode_cache(file, content_hash, compiled.bytecode);
+    }
+    if(!compiled.bytecode.empty()){
+        int status = luaL_loadbufferx(L, compiled.bytecode.data(), compiled.bytecode.size(), file.c_str(), "b");
+        if(status == LUA_OK) [[likely]] {
+            return status;
+        }
+        //a cache file Lua could not load, compile the script again
+        lua_pop(L, 1);
+        compiled.bytecode.clear();
+    }
+
+    std::vector<std::string> names;
+    std::string temp = hash_script(source, &names);
+    int status = luaL_loadbufferx(L, temp.c_str(), temp.size(), file.c_str(), "t");
+    if(status == LUA_OK){
+        lua_dump(L, write_bytecode, &compiled.bytecode, 0);
+        write_bytecode_cache(file, content_hash, names, compiled.bytecode);
+    }
+    return status;
+}
+
 /**
  * Run a lua script contained in a string.
  * @param script The Lua Script to run.
@@ -258,7 +755,12 @@ int8_t lua_backend::load_file(const std::string& file){
  */
 int8_t lua_backend::run_script(const std::string& script) {
     std::string temp = hash_string(script);
-    if (luaL_dostring(L, temp.c_str())){
+    int status = luaL_loadstring(L, temp.c_str());
+    if(status == LUA_OK) [[likely]] {
+        set_level_env();
+        status = lua_pcall(L, 0, LUA_MULTRET, 0);
+    }
+    if (status != LUA_OK){
         gMessage_bus->send_msg(new message(LOG_ERROR, make_data<std::string>("Cannot run script")));
         return -1;
     }else [[likely]] {
@@ -267,219 +769,199 @@ int8_t lua_backend::run_script(const std::string& script) {
 }
 
 /**
- * Set a loaded script as a global.
+ * Set a loaded script as a global of the current level.
  * @param arg The name of the script to set as global.
  */
 void lua_backend::set_global(const std::string& arg){
-    lua_setglobal(L, arg.c_str());
+    lua_rawgeti(L, LUA_REGISTRYINDEX, level_env);
+    lua_insert(L, -2);
+    lua_setfield(L, -2, arg.c_str());
+    lua_pop(L, 1);
 }
 
 /**
- * Run a already set global.
+ * Run a already set global of the current level.
  * @param arg The name of the global.
  */
 void lua_backend::run_global(const std::string& arg) {
-    lua_getglobal(L, arg.c_str());
-    lua_pcall(L, 0, 0, 0);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, level_env);
+    lua_getfield(L, -1, arg.c_str());
+    lua_remove(L, -2);
+    if(lua_pcall(L, 0, 0, 0) != LUA_OK){
+        lua_pop(L, 1);
+    }
 }
 
 /**
  * Close the Lua State.
  */
 void lua_backend::close() {
+    stop_tasks();
     lua_close(L);
+    level_env = LUA_NOREF;
     singleton_initialized = false;
 }
 
+//The functions whose first argument is hashed before the script runs
+static const std::array<std::string_view, 6> hashed_functions = {
+        "playSound", "playMusic", "keyHeld", "keyPressed", "keyReleased", "setClickKey"
+};
+
+/**
+ * Checks for the opening bracket of a Lua long string or long comment ("[[", "[=[", "[==[" ...).
+ * @param source The script.
+ * @param i The position to check.
+ * @return The number of '=' in the bracket or -1 if there is no long bracket at this position.
+ */
+static int32_t long_bracket_level(std::string_view source, size_t i){
+    if(i >= source.size() || source[i] != '['){
+        return -1;
+    }
+    size_t j = i + 1;
+    while(j < source.size() && source[j] == '='){
+        ++j;
+    }
+    if(j < source.size() && source[j] == '['){
+        return static_cast<int32_t>(j - i - 1);
+    }
+    return -1;
+}
+
 /**
- * Hashes plaintext filenames in scripts in the functions 'playSound','playMusic','keyHeld', 'keyReleased' and 'keyPressed'
- * and also the annotations --@Audio and --@Key.This way, we have no hashing/comparing/copying strings in our main loop
- * @param path The path to the file.
- * @return The script with the values hashed.
+ * Finds the end of a Lua long string or long comment.
+ * @param source The script.
+ * @param i The position of the opening bracket.
+ * @param level The number of '=' in the bracket.
+ * @return The position right after the closing bracket or the end of the script.
  */
-std::string lua_backend::hash_file(const std::string& path){
-    std::ifstream file;
-    file.open(path.c_str());
-    std::string result;
-    if(file.is_open()){
-        std::string temp;
-        while(!file.eof()){
-            getline(file, temp);
-            if(!temp.empty()){
-                temp.erase(temp.begin(), std::find_if(temp.begin(), temp.end(), std::bind(std::not_equal_to<>(), ' ', std::placeholders::_1)));
-                while(temp.find("playSound(\"") != std::string::npos) {
-                    std::string to_find = "playSound(\"";
-                    std::string temp_buf;
-                    for(uint64_t i = temp.find(to_find) + to_find.size(); temp.at(i) != '\"'; i++){
-                        temp_buf.push_back((temp.at(i)));
-                    }
-                    std::string string_hash = std::to_string(ST::hash_string(temp_buf));
-                    std::string temp_buf_2 = "\"" + temp_buf + "\"";
-                    ST::replace_string(temp, temp_buf_2, string_hash);
-                }
-                while(temp.find("playMusic(\"") != std::string::npos) {
-                    std::string to_find = "playMusic(\"";
-                    std::string temp_buf;
-                    for(uint64_t i = temp.find(to_find) + to_find.size(); temp.at(i) != '\"'; i++){
-                        temp_buf.push_back((temp.at(i)));
-                    }
-                    std::string string_hash = std::to_string(ST::hash_string(temp_buf));
-                    std::string temp_buf_2 = "\"" + temp_buf + "\"";
-                    ST::replace_string(temp, temp_buf_2, string_hash);
-                }
-                while(temp.find("keyHeld(\"") != std::string::npos) {
-                    std::string to_find = "keyHeld(\"";
-                    std::string temp_buf;
-                    for(uint64_t i = temp.find(to_find) + to_find.size(); temp.at(i) != '\"'; i++){
-                        temp_buf.push_back((temp.at(i)));
-                    }
-                    std::string string_hash = std::to_string(ST::hash_string(temp_buf));
-                    std::string temp_buf_2 = "\"" + temp_buf + "\"";
-                    ST::replace_string(temp, temp_buf_2, string_hash);
-                }
-                while(temp.find("keyPressed(\"") != std::string::npos) {
-                    std::string to_find = "keyPressed(\"";
-                    std::string temp_buf;
-                    for(uint64_t i = temp.find(to_find) + to_find.size(); temp.at(i) != '\"'; i++){
-                        temp_buf.push_back((temp.at(i)));
-                    }
-                    std::string string_hash = std::to_string(ST::hash_string(temp_buf));
-                    std::string temp_buf_2 = "\"" + temp_buf + "\"";
-                    ST::replace_string(temp, temp_buf_2, string_hash);
-                }
-                while(temp.find("keyReleased(\"") != std::string::npos) {
-                    std::string to_find = "keyReleased(\"";
-                    std::string temp_buf;
-                    for(uint64_t i = temp.find(to_find) + to_find.size(); temp.at(i) != '\"'; i++){
-                        temp_buf.push_back((temp.at(i)));
-                    }
-                    std::string string_hash = std::to_string(ST::hash_string(temp_buf));
-                    std::string temp_buf_2 = "\"" + temp_buf + "\"";
-                    ST::replace_string(temp, temp_buf_2, string_hash);
-                }
-                while(temp.find("setClickKey(\"") != std::string::npos) {
-                    std::string to_find = "setClickKey(\"";
-                    std::string temp_buf;
-                    for(uint64_t i = temp.find(to_find) + to_find.size(); temp.at(i) != '\"'; i++){
-                        temp_buf.push_back((temp.at(i)));
-                    }
-                    std::string string_hash = std::to_string(ST::hash_string(temp_buf));
-                    std::string temp_buf_2 = "\"" + temp_buf + "\"";
-                    ST::replace_string(temp, temp_buf_2, string_hash);
-                }
-                //Process annotations
-                while(temp.find("----@Key") != std::string::npos) {
-                    std::string to_find = "\"";
-                    std::string temp_buf;
-                    std::string next_line;
-                    getline(file, next_line);
-                    for(uint64_t i = next_line.find(to_find) + to_find.size(); next_line.at(i) != '\"'; i++){
-                        temp_buf.push_back((next_line.at(i)));
-                    }
-                    std::string string_hash = std::to_string(ST::hash_string(temp_buf));
-                    std::string temp_buf_2 = "\"" + temp_buf + "\"";
-                    ST::replace_string(next_line, temp_buf_2, string_hash);
-                    temp = next_line;
-                }
-                while(temp.find("----@Audio") != std::string::npos) {
-                    std::string to_find = "\"";
-                    std::string temp_buf;
-                    std::string next_line;
-                    getline(file, next_line);
-                    for(uint64_t i = next_line.find(to_find) + to_find.size(); next_line.at(i) != '\"'; i++){
-                        temp_buf.push_back((next_line.at(i)));
-                    }
-                    std::string string_hash = std::to_string(ST::hash_string(temp_buf));
-                    std::string temp_buf_2 = "\"" + temp_buf + "\"";
-                    ST::replace_string(next_line, temp_buf_2, string_hash);
-                    temp = next_line;
-                }
-                result += temp + "\n";
-            }
+static size_t skip_long_bracket(std::string_view source, size_t i, int32_t level){
+    std::string closing = "]" + std::string(static_cast<size_t>(level), '=') + "]";
+    size_t end = source.find(closing, i + static_cast<size_t>(level) + 2);
+    return end == std::string_view::npos ? source.size() : end + closing.size();
+}
+
+/**
+ * Finds the end of a quoted Lua string.
+ * @param source The script.
+ * @param i The position of the opening quote.
+ * @return The position right after the closing quote, or of the end of the line for an unfinished string.
+ */
+static size_t skip_quoted_string(std::string_view source, size_t i){
+    char quote = source[i];
+    for(++i; i < source.size(); i++){
+        if(source[i] == '\\'){
+            ++i;
+        }else if(source[i] == quote){
+            return i + 1;
+        }else if(source[i] == '\n'){
+            return i;
         }
-        file.close();
-        return result;
-    }
-    else{
-        gMessage_bus->send_msg(new message(LOG_ERROR, make_data<std::string>("File " + path + " not found")));
-        return "";
     }
+    return source.size();
 }
 
 /**
- * Hashes plaintext filenames in scripts in the functions 'playSound','playMusic','keyHeld', 'keyReleased' and 'keyPressed'
- * and also the annotations --@Audio and --@Key.This way, we have no hashing/comparing/copying strings in our main loop
- * @param path The script.
+ * Hashes plaintext strings in a script, so there is no hashing/comparing/copying strings in our main loop.
+ * The first argument of the functions 'playSound', 'playMusic', 'keyHeld', 'keyPressed', 'keyReleased' and 'setClickKey'
+ * is hashed if it is a string, as well as the first string on the line after the annotations ----@Key and ----@Audio.
+ * The script is scanned once, strings and comments are skipped, so a call site inside them is left as it is.
+ * @param source The script.
+ * @param names The hashed strings are added to this, can be nullptr.
  * @return The script with the values hashed.
  */
-std::string lua_backend::hash_string(const std::string& arg){
+static std::string hash_script(std::string_view source, std::vector<std::string>* names){
     std::string result;
-    std::string temp = arg;
-    if(!temp.empty()){
-        temp.erase(temp.begin(), std::find_if(temp.begin(), temp.end(), std::bind(std::not_equal_to<>(), ' ', std::placeholders::_1)));
-        while(temp.find("playSound(\"") != std::string::npos) {
-            std::string to_find = "playSound(\"";
-            std::string temp_buf;
-            for(uint64_t i = temp.find(to_find) + to_find.size(); temp.at(i) != '\"'; i++){
-                temp_buf.push_back((temp.at(i)));
-            }
-            std::string string_hash = std::to_string(ST::hash_string(temp_buf));
-            std::string temp_buf_2 = "\"" + temp_buf + "\"";
-            ST::replace_string(temp, temp_buf_2, string_hash);
-        }
-        while(temp.find("playMusic(\"") != std::string::npos) {
-            std::string to_find = "playMusic(\"";
-            std::string temp_buf;
-            for(size_t i = temp.find(to_find) + to_find.size(); temp.at(i) != '\"'; i++){
-                temp_buf.push_back((temp.at(i)));
+    result.reserve(source.size());
+    uint32_t line = 1;
+    uint32_t annotated_line = 0; //the line after an annotation, its first string is hashed
+    bool call_argument = false; //the next token is the first argument of one of the hashed functions
+    size_t i = 0;
+    while(i < source.size()){
+        char c = source[i];
+        size_t end = i + 1;
+        bool hash = false;
+        if(c == '-' && i + 1 < source.size() && source[i + 1] == '-'){
+            int32_t level = long_bracket_level(source, i + 2);
+            if(level >= 0){
+                end = skip_long_bracket(source, i + 2, level);
+            }else{
+                end = std::min(source.find('\n', i), source.size());
+                std::string_view comment = source.substr(i, end - i);
+                if(comment.starts_with("----@Key") || comment.starts_with("----@Audio")){
+                    //annotations are not part of the script
+                    annotated_line = line + 1;
+                    i = end;
+                    continue;
+                }
             }
-            std::string string_hash = std::to_string(ST::hash_string(temp_buf));
-            std::string temp_buf_2 = "\"" + temp_buf + "\"";
-            ST::replace_string(temp, temp_buf_2, string_hash);
-        }
-        while(temp.find("keyHeld(\"") != std::string::npos) {
-            std::string to_find = "keyHeld(\"";
-            std::string temp_buf;
-            for(size_t i = temp.find(to_find) + to_find.size(); temp.at(i) != '\"'; i++){
-                temp_buf.push_back((temp.at(i)));
+        }else if(c == '"' || c == '\''){
+            end = skip_quoted_string(source, i);
+            hash = (call_argument || line == annotated_line) && end - i >= 2 && source[end - 1] == c;
+            if(line == annotated_line && hash){
+                annotated_line = 0;
             }
-            std::string string_hash = std::to_string(ST::hash_string(temp_buf));
-            std::string temp_buf_2 = "\"" + temp_buf + "\"";
-            ST::replace_string(temp, temp_buf_2, string_hash);
-        }
-        while(temp.find("keyPressed(\"") != std::string::npos) {
-            std::string to_find = "keyPressed(\"";
-            std::string temp_buf;
-            for(size_t i = temp.find(to_find) + to_find.size(); temp.at(i) != '\"'; i++){
-                temp_buf.push_back((temp.at(i)));
+        }else if(c == '[' && long_bracket_level(source, i) >= 0){
+            end = skip_long_bracket(source, i, long_bracket_level(source, i));
+        }else if(std::isalpha(static_cast<unsigned char>(c)) || c == '_'){
+            while(end < source.size() && (std::isalnum(static_cast<unsigned char>(source[end])) || source[end] == '_')){
+                ++end;
             }
-            std::string string_hash = std::to_string(ST::hash_string(temp_buf));
-            std::string temp_buf_2 = "\"" + temp_buf + "\"";
-            ST::replace_string(temp, temp_buf_2, string_hash);
-        }
-        while(temp.find("keyReleased(\"") != std::string::npos) {
-            std::string to_find = "keyReleased(\"";
-            std::string temp_buf;
-            for(size_t i = temp.find(to_find) + to_find.size(); temp.at(i) != '\"'; i++){
-                temp_buf.push_back((temp.at(i)));
+            std::string_view identifier = source.substr(i, end - i);
+            if(end < source.size() && source[end] == '('
+            && std::find(hashed_functions.begin(), hashed_functions.end(), identifier) != hashed_functions.end()){
+                ++end;
+                result.append(identifier).push_back('(');
+                i = end;
+                call_argument = true;
+                continue;
             }
-            std::string string_hash = std::to_string(ST::hash_string(temp_buf));
-            std::string temp_buf_2 = "\"" + temp_buf + "\"";
-            ST::replace_string(temp, temp_buf_2, string_hash);
         }
-        while(temp.find("setClickKey(\"") != std::string::npos) {
-            std::string to_find = "setClickKey(\"";
-            std::string temp_buf;
-            for (size_t i = temp.find(to_find) + to_find.size(); temp.at(i) != '\"'; i++) {
-                temp_buf.push_back((temp.at(i)));
+        call_argument = false;
+        if(hash){
+            std::string name(source.substr(i + 1, end - i - 2));
+            result += std::to_string(ST::hash_string(name));
+            if(names != nullptr){
+                names->emplace_back(std::move(name));
             }
-            std::string string_hash = std::to_string(ST::hash_string(temp_buf));
-            std::string temp_buf_2 = "\"" + temp_buf + "\"";
-            ST::replace_string(temp, temp_buf_2, string_hash);
+        }else{
+            std::string_view token = source.substr(i, end - i);
+            line += static_cast<uint32_t>(std::count(token.begin(), token.end(), '\n'));
+            result.append(token);
         }
-        return temp;
+        i = end;
     }
-    return "Error\n";
+    return result;
+}
+
+/**
+ * Hashes plaintext strings in a script file, see hash_script().
+ * @param path The path to the file.
+ * @return The script with the values hashed.
+ */
+std::string lua_backend::hash_file(const std::string& path){
+    std::ifstream file(path, std::ios::binary);
+    if(!file.is_open()){
+        gMessage_bus->send_msg(new message(LOG_ERROR, make_data<std::string>("File " + path + " not found")));
+        return "";
+    }
+    std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::string result = hash_script(source, nullptr);
+    if(result.empty() || result.back() != '\n'){
+        result.push_back('\n');
+    }
+    return result;
+}
+
+/**
+ * Hashes plaintext strings in a script, see hash_script().
+ * @param arg The script.
+ * @return The script with the values hashed.
+ */
+std::string lua_backend::hash_string(const std::string& arg){
+    if(arg.empty()){
+        return "Error\n";
+    }
+    return hash_script(arg, nullptr);
 }
 
 
@@ -744,7 +1226,7 @@ extern "C" int setTextObjectColorLua(lua_State* L){
     auto g = static_cast<uint8_t>(lua_tointeger(L, 3));
     auto b = static_cast<uint8_t>(lua_tointeger(L, 4));
     auto a = static_cast<uint8_t>(lua_tointeger(L, 5));
-    gGame_managerLua->get_level()->text_objects[id].color = {r,g,b,a};
+    gGame_managerLua->get_level()->text_objects[id].set_color({r,g,b,a});
     return 0;
 }
 
@@ -757,7 +1239,7 @@ extern "C" int setTextObjectColorLua(lua_State* L){
 extern "C" int setTextObjectTextLua(lua_State* L){
     auto id = static_cast<uint64_t>(lua_tointeger(L, 1));
     auto text = static_cast<std::string>(lua_tostring(L, 2));
-    gGame_managerLua->get_level()->text_objects[id].text_string = text;
+    gGame_managerLua->get_level()->text_objects[id].set_text_string(text);
     return 0;
 }
 
@@ -770,7 +1252,7 @@ extern "C" int setTextObjectTextLua(lua_State* L){
 extern "C" int setTextObjectFontLua(lua_State* L){
     auto id = static_cast<uint64_t>(lua_tointeger(L, 1));
     auto font = static_cast<std::string>(lua_tostring(L, 2));
-    gGame_managerLua->get_level()->text_objects[id].font = ST::hash_string(font);
+    gGame_managerLua->get_level()->text_objects[id].set_font(ST::hash_string(font));
     return 0;
 }
 
@@ -916,6 +1398,248 @@ extern "C" int getEntityVelocityYLua(lua_State *L){
     return 1;
 }
 
+/**
+ * Reads two fields of a number of entities into two Lua tables, with one call instead of one per entity and field.
+ * The tables at out_index and out_index + 1 are reused if given, otherwise new ones are created.
+ * The values of entities that don't exist are set to nil.
+ * @param L The global Lua State.
+ * @param count The number of entities.
+ * @param get_id Returns the id of the i-th entity (starting from 1).
+ * @param out_index The stack index of the first output table.
+ * @param first The first field.
+ * @param second The second field.
+ * @return Always 2 - the two tables.
+ */
+template <typename T, typename F>
+static int get_entities_fields(lua_State* L, uint64_t count, F get_id, int32_t out_index, T ST::entity::* first, T ST::entity::* second){
+    const auto& entities = gGame_managerLua->get_level()->entities;
+    for(int32_t i = out_index; i < out_index + 2; i++){
+        if(lua_istable(L, i)){
+            lua_pushvalue(L, i);
+        }else{
+            lua_createtable(L, static_cast<int>(count), 0);
+        }
+    }
+    int32_t firsts = lua_gettop(L) - 1;
+    bool out_of_range = false;
+    for(uint64_t i = 1; i <= count; i++){
+        uint64_t id = get_id(i);
+        if(id >= entities.size()) [[unlikely]] {
+            out_of_range = true;
+            lua_pushnil(L);
+            lua_rawseti(L, firsts, static_cast<lua_Integer>(i));
+            lua_pushnil(L);
+            lua_rawseti(L, firsts + 1, static_cast<lua_Integer>(i));
+            continue;
+        }
+        lua_pushinteger(L, entities[id].*first);
+        lua_rawseti(L, firsts, static_cast<lua_Integer>(i));
+        lua_pushinteger(L, entities[id].*second);
+        lua_rawseti(L, firsts + 1, static_cast<lua_Integer>(i));
+    }
+    if(out_of_range) [[unlikely]] {
+        gMessage_busLua->send_msg(new message(LOG_ERROR, make_data<std::string>("Entity id out of range")));
+    }
+    return 2;
+}
+
+/**
+ * Writes two fields of a number of entities from two Lua tables, with one call instead of one per entity and field.
+ * A field is left as it is if its table is not given or its value is nil.
+ * @param L The global Lua State.
+ * @param count The number of entities.
+ * @param get_id Returns the id of the i-th entity (starting from 1).
+ * @param in_index The stack index of the first input table.
+ * @param first The first field.
+ * @param second The second field.
+ * @return Always 0.
+ */
+template <typename T, typename F>
+static int set_entities_fields(lua_State* L, uint64_t count, F get_id, int32_t in_index, T ST::entity::* first, T ST::entity::* second){
+    auto& entities = gGame_managerLua->get_level()->entities;
+    const std::array<T ST::entity::*, 2> fields = {first, second};
+    bool out_of_range = false;
+    for(int32_t field = 0; field < 2; field++){
+        if(!lua_istable(L, in_index + field)){
+            continue;
+        }
+        for(uint64_t i = 1; i <= count; i++){
+            uint64_t id = get_id(i);
+            if(id >= entities.size()) [[unlikely]] {
+                out_of_range = true;
+                continue;
+            }
+            lua_rawgeti(L, in_index + field, static_cast<lua_Integer>(i));
+            int is_number = 0;
+            lua_Number value = lua_tonumberx(L, -1, &is_number);
+            if(is_number) [[likely]] {
+                entities[id].*fields[field] = static_cast<T>(value);
+            }
+            lua_pop(L, 1);
+        }
+    }
+    if(out_of_range) [[unlikely]] {
+        gMessage_busLua->send_msg(new message(LOG_ERROR, make_data<std::string>("Entity id out of range")));
+    }
+    return 0;
+}
+
+/**
+ * Returns a function that gets the i-th id from a table of entity ids.
+ * @param L The global Lua State.
+ * @param index The stack index of the table.
+ * @return The function.
+ */
+static auto ids_from_table(lua_State* L, int32_t index){
+    return [L, index](uint64_t i){
+        lua_rawgeti(L, index, static_cast<lua_Integer>(i));
+        auto id = static_cast<uint64_t>(lua_tointeger(L, -1));
+        lua_pop(L, 1);
+        return id;
+    };
+}
+
+/**
+ * Gets the number of ids in a table of entity ids.
+ * @param L The global Lua State.
+ * @param index The stack index of the table.
+ * @return The number of ids, 0 if there is no table.
+ */
+static uint64_t ids_count(lua_State* L, int32_t index){
+    return lua_istable(L, index) ? static_cast<uint64_t>(lua_rawlen(L, index)) : 0;
+}
+
+/**
+ * Gets the positions of a list of entities.
+ * See the Lua docs for more information.
+ * @param L The global Lua State.
+ * @return Always 2.
+ */
+extern "C" int getEntitiesPositionLua(lua_State *L){
+    return get_entities_fields(L, ids_count(L, 1), ids_from_table(L, 1), 2, &ST::entity::x, &ST::entity::y);
+}
+
+/**
+ * Sets the positions of a list of entities.
+ * See the Lua docs for more information.
+ * @param L The global Lua State.
+ * @return Always 0.
+ */
+extern "C" int setEntitiesPositionLua(lua_State *L){
+    return set_entities_fields(L, ids_count(L, 1), ids_from_table(L, 1), 2, &ST::entity::x, &ST::entity::y);
+}
+
+/**
+ * Gets the velocities of a list of entities.
+ * See the Lua docs for more information.
+ * @param L The global Lua State.
+ * @return Always 2.
+ */
+extern "C" int getEntitiesVelocityLua(lua_State *L){
+    return get_entities_fields(L, ids_count(L, 1), ids_from_table(L, 1), 2, &ST::entity::velocity_x, &ST::entity::velocity_y);
+}
+
+/**
+ * Sets the velocities of a list of entities.
+ * See the Lua docs for more information.
+ * @param L The global Lua State.
+ * @return Always 0.
+ */
+extern "C" int setEntitiesVelocityLua(lua_State *L){
+    return set_entities_fields(L, ids_count(L, 1), ids_from_table(L, 1), 2, &ST::entity::velocity_x, &ST::entity::velocity_y);
+}
+
+/**
+ * Creates a view over a range of consecutive entities.
+ * The range is clamped to the entities that exist when it is created.
+ * See the Lua docs for more information.
+ * @param L The global Lua State.
+ * @return Always 1.
+ */
+extern "C" int getEntityRangeLua(lua_State *L){
+    lua_Integer first = lua_tointeger(L, 1);
+    lua_Integer count = lua_tointeger(L, 2);
+    luaL_argcheck(L, first >= 0, 1, "the first entity id can't be negative");
+    luaL_argcheck(L, count >= 0, 2, "the number of entities can't be negative");
+    uint64_t size = gGame_managerLua->get_level()->entities.size();
+    auto range = static_cast<entity_range*>(lua_newuserdata(L, sizeof(entity_range)));
+    range->first = static_cast<uint64_t>(first);
+    range->count = std::min(static_cast<uint64_t>(count), size - std::min(range->first, size));
+    luaL_setmetatable(L, entity_range_metatable);
+    return 1;
+}
+
+/**
+ * Returns a function that gets the id of the i-th entity in an entity range.
+ * @param L The global Lua State.
+ * @return The function.
+ */
+static auto ids_from_range(lua_State* L){
+    auto range = static_cast<entity_range*>(luaL_checkudata(L, 1, entity_range_metatable));
+    return [range](uint64_t i){
+        return range->first + i - 1;
+    };
+}
+
+/**
+ * Gets the number of entities in an entity range.
+ * @param L The global Lua State.
+ * @return The number of entities.
+ */
+static uint64_t range_count(lua_State* L){
+    return static_cast<entity_range*>(luaL_checkudata(L, 1, entity_range_metatable))->count;
+}
+
+/**
+ * Gets the positions of the entities in a range.
+ * See the Lua docs for more information.
+ * @param L The global Lua State.
+ * @return Always 2.
+ */
+extern "C" int entityRangeGetPositionLua(lua_State *L){
+    return get_entities_fields(L, range_count(L), ids_from_range(L), 2, &ST::entity::x, &ST::entity::y);
+}
+
+/**
+ * Sets the positions of the entities in a range.
+ * See the Lua docs for more information.
+ * @param L The global Lua State.
+ * @return Always 0.
+ */
+extern "C" int entityRangeSetPositionLua(lua_State *L){
+    return set_entities_fields(L, range_count(L), ids_from_range(L), 2, &ST::entity::x, &ST::entity::y);
+}
+
+/**
+ * Gets the velocities of the entities in a range.
+ * See the Lua docs for more information.
+ * @param L The global Lua State.
+ * @return Always 2.
+ */
+extern "C" int entityRangeGetVelocityLua(lua_State *L){
+    return get_entities_fields(L, range_count(L), ids_from_range(L), 2, &ST::entity::velocity_x, &ST::entity::velocity_y);
+}
+
+/**
+ * Sets the velocities of the entities in a range.
+ * See the Lua docs for more information.
+ * @param L The global Lua State.
+ * @return Always 0.
+ */
+extern "C" int entityRangeSetVelocityLua(lua_State *L){
+    return set_entities_fields(L, range_count(L), ids_from_range(L), 2, &ST::entity::velocity_x, &ST::entity::velocity_y);
+}
+
+/**
+ * Gets the number of entities in a range, used as the # operator.
+ * @param L The global Lua State.
+ * @return Always 1.
+ */
+extern "C" int entityRangeLengthLua(lua_State *L){
+    lua_pushinteger(L, static_cast<lua_Integer>(range_count(L)));
+    return 1;
+}
+
 /**
  * Sets the entity to static/non-static.
  * See the Lua docs for more information.
@@ -1317,6 +2041,110 @@ int setWindowResolutionLua(lua_State *L) {
     return 0;
 }
 
+/**
+ * Set the memory budget for textures.
+ * See the Lua docs for more information.
+ * @param L The global Lua State.
+ * @return Always 0.
+ */
+extern "C" int setTextureBudgetLua(lua_State* L){
+    auto megabytes = static_cast<uint16_t>(lua_tointeger(L, 1));
+    auto frames = static_cast<uint16_t>(lua_tointeger(L, 2));
+    uint32_t budget_frames = megabytes | static_cast<uint32_t>(frames << 16U);
+    gMessage_busLua->send_msg(new message(SET_TEXTURE_BUDGET, budget_frames));
+    return 0;
+}
+
+/**
+ * Gets the time spent collecting garbage in the last frame and the size of the Lua heap.
+ * See the Lua docs for more information.
+ * @param L The global Lua State.
+ * @return Always 2.
+ */
+extern "C" int getGarbageCollectorStatsLua(lua_State* L){
+    lua_pushnumber(L, gLua_backendLua->get_gc_time());
+    lua_pushinteger(L, gLua_backendLua->get_heap_size());
+    return 2;
+}
+
+/**
+ * Starts a task running a function as a coroutine, it can wait for frames, time or signals without blocking the level.
+ * See the Lua docs for more information.
+ * @param L The global Lua State.
+ * @return Always 1.
+ */
+extern "C" int startTaskLua(lua_State* L){
+    int32_t nargs = lua_gettop(L) - 1;
+    if(!lua_isfunction(L, 1)){
+        gMessage_busLua->send_msg(new message(LOG_ERROR, make_data<std::string>("startTask expects a function")));
+        lua_pushinteger(L, 0);
+        return 1;
+    }
+    lua_State* thread = lua_newthread(L);
+    lua_insert(L, 1);
+    lua_xmove(L, thread, nargs + 1);
+    uint32_t id = gLua_backendLua->start_task(L, nargs);
+    lua_pushinteger(L, id);
+    return 1;
+}
+
+/**
+ * Stops a task.
+ * See the Lua docs for more information.
+ * @param L The global Lua State.
+ * @return Always 0.
+ */
+extern "C" int stopTaskLua(lua_State* L){
+    auto id = static_cast<uint32_t>(lua_tointeger(L, 1));
+    gLua_backendLua->stop_task(id);
+    return 0;
+}
+
+/**
+ * Makes the running task wait for a number of frames.
+ * See the Lua docs for more information.
+ * @param L The global Lua State.
+ * @return See lua_backend::wait_frames().
+ */
+extern "C" int waitFramesLua(lua_State* L){
+    auto frames = static_cast<uint32_t>(std::max<lua_Integer>(lua_tointeger(L, 1), 1));
+    return gLua_backendLua->wait_frames(L, frames);
+}
+
+/**
+ * Makes the running task wait for some time in milliseconds.
+ * See the Lua docs for more information.
+ * @param L The global Lua State.
+ * @return See lua_backend::wait_time().
+ */
+extern "C" int waitTimeLua(lua_State* L){
+    auto ms = static_cast<uint32_t>(std::max<lua_Integer>(lua_tointeger(L, 1), 0));
+    return gLua_backendLua->wait_time(L, ms);
+}
+
+/**
+ * Makes the running task wait until a signal is sent.
+ * See the Lua docs for more information.
+ * @param L The global Lua State.
+ * @return See lua_backend::wait_signal().
+ */
+extern "C" int waitForSignalLua(lua_State* L){
+    std::string name = static_cast<std::string>(lua_tostring(L, 1));
+    return gLua_backendLua->wait_signal(L, ST::hash_string(name));
+}
+
+/**
+ * Sends a signal to the tasks waiting for it.
+ * See the Lua docs for more information.
+ * @param L The global Lua State.
+ * @return Always 0.
+ */
+extern "C" int signalLua(lua_State* L){
+    std::string name = static_cast<std::string>(lua_tostring(L, 1));
+    gLua_backendLua->signal(ST::hash_string(name));
+    return 0;
+}
+
 /**
  * Set the brightness of the screen.
  * See the Lua docs for more information.
@@ -1389,6 +2217,18 @@ extern "C" int reloadLevelLua(lua_State* L){
     return 0;
 }
 
+/**
+ * Get the percentage of the assets of a level that are loaded.
+ * See the Lua docs for more information.
+ * @param L The global Lua State.
+ * @return Always 1.
+ */
+extern "C" int getLevelLoadProgressLua(lua_State* L){
+    std::string level = static_cast<std::string>(lua_tostring(L, 1));
+    lua_pushinteger(L, gGame_managerLua->get_level_load_progress(level));
+    return 1;
+}
+
 /**
  * Load a level given it's name. Sends a <b>LOAD_LEVEL</b> message.
  * See the Lua docs for more information.
@@ -1437,6 +2277,33 @@ extern "C" int unloadAssetLua(lua_State* L) {
 	return 0;
 }
 
+/**
+ * Load a single asset from a binary given the path to the binary and the name of the asset inside it.
+ * Sends a <b>LOAD_BINARY_ASSET</b> message.
+ * See the Lua docs for more information.
+ * @param L The global Lua State.
+ * @return Always 0.
+ */
+extern "C" int loadAssetFromBinaryLua(lua_State* L) {
+    std::string path = luaL_checkstring(L, 1);
+    std::string name = luaL_checkstring(L, 2);
+    gMessage_busLua->send_msg(new message(LOAD_BINARY_ASSET, make_data(std::make_pair(path, name))));
+    return 0;
+}
+
+/**
+ * Unload a single asset loaded with loadAssetFromBinary. Sends a <b>UNLOAD_BINARY_ASSET</b> message.
+ * See the Lua docs for more information.
+ * @param L The global Lua State.
+ * @return Always 0.
+ */
+extern "C" int unloadAssetFromBinaryLua(lua_State* L) {
+    std::string path = luaL_checkstring(L, 1);
+    std::string name = luaL_checkstring(L, 2);
+    gMessage_busLua->send_msg(new message(UNLOAD_BINARY_ASSET, make_data(std::make_pair(path, name))));
+    return 0;
+}
+
 /**
  * Pause the execution of the game simulation thread by a given amount.
  * See the Lua docs for more information.
@@ -11,7 +11,10 @@
 #define LUA_BACKEND_HPP
 
 #include <message_bus.hpp>
+#include <ST_util/bytell_hash_map.hpp>
 #include <functional>
+#include <vector>
+#include <queue>
 
 extern "C" {
     #include <lua.h>
@@ -33,16 +36,49 @@ class lua_backend {
 private:
     lua_State* L;
     message_bus* gMessage_bus;
+    int level_env = LUA_NOREF; //Reference to the _ENV table of the current level
+    bool gc_cycle_running = false; //A garbage collection cycle was started and is not finished yet
+    uint32_t gc_threshold = 0; //The heap size in kilobytes at which the next garbage collection cycle starts
+    double gc_time = 0; //The time in milliseconds spent collecting garbage in the last call to collect_garbage
+    void finish_gc_cycle();
+
+    //A task waiting for a frame or a time, with the id of the task
+    typedef std::pair<uint32_t, uint32_t> task_wait;
+    typedef std::priority_queue<task_wait, std::vector<task_wait>, std::greater<>> task_wait_queue;
+
+    uint32_t frame = 0; //The number of calls to run_tasks
+    uint32_t next_task_id = 1;
+    uint32_t current_task = 0; //The task being resumed, 0 outside of tasks
+    ska::bytell_hash_map<uint32_t, int> tasks; //References to the threads of the tasks, by task id
+    std::vector<uint32_t> ready_tasks; //Tasks to resume in the next call to run_tasks
+    task_wait_queue frame_waits; //Tasks waiting for a frame
+    task_wait_queue time_waits; //Tasks waiting for a time in ms since SDL was initialized
+    ska::bytell_hash_map<uint16_t, std::vector<uint32_t>> signal_waits; //Tasks waiting for a signal, by signal
+    void stop_tasks();
     std::string hash_file(const std::string& path);
     static std::string hash_string(const std::string& string);
+    int load_script(const std::string& file);
+    void set_level_env();
 
 public:
+    static void set_bytecode_cache(const std::string& dir);
     int initialize(message_bus* msg_bus, game_manager* game_mngr);
+    void start_level();
     void set_global(const std::string& arg);
     void run_global(const std::string& arg);
     int8_t run_file(const std::string& file);
     int8_t load_file(const std::string&);
     int8_t run_script(const std::string& script);
+    void collect_garbage(double time_budget);
+    uint32_t start_task(lua_State* state, int32_t nargs);
+    void stop_task(uint32_t id);
+    int wait_frames(lua_State* thread, uint32_t frames);
+    int wait_time(lua_State* thread, uint32_t ms);
+    int wait_signal(lua_State* thread, uint16_t signal);
+    void signal(uint16_t signal);
+    void run_tasks();
+    [[nodiscard]] double get_gc_time() const;
+    [[nodiscard]] uint32_t get_heap_size() const;
     void close();
 };
 
@@ -63,11 +99,14 @@ extern "C" int setOverlayLua(lua_State* L);
 extern "C" int delayLua(lua_State* L);
 extern "C" int startLevelLua(lua_State* L);
 extern "C" int reloadLevelLua(lua_State* L);
+extern "C" int getLevelLoadProgressLua(lua_State* L);
 extern "C" int useLua(lua_State* L);
 extern "C" int load_levelLua(lua_State* L);
 extern "C" int unload_levelLua(lua_State* L);
 extern "C" int loadAssetLua(lua_State* L);
 extern "C" int unloadAssetLua(lua_State* L);
+extern "C" int loadAssetFromBinaryLua(lua_State* L);
+extern "C" int unloadAssetFromBinaryLua(lua_State* L);
 extern "C" int endGameLua(lua_State* L);
 extern "C" int setLevelSizeLua(lua_State* L);
 extern "C" int centerCameraLua(lua_State* L);
@@ -107,6 +146,16 @@ extern "C" int setMusicVolumeLua(lua_State* L);
 extern "C" int setSoundsVolumeLua(lua_State* L);
 extern "C" int setInternalResolutionLua(lua_State* L);
 extern "C" int setWindowResolutionLua(lua_State* L);
+extern "C" int setTextureBudgetLua(lua_State* L);
+extern "C" int getGarbageCollectorStatsLua(lua_State* L);
+
+//Task bindings definitions
+extern "C" int startTaskLua(lua_State* L);
+extern "C" int stopTaskLua(lua_State* L);
+extern "C" int waitFramesLua(lua_State* L);
+extern "C" int waitTimeLua(lua_State* L);
+extern "C" int waitForSignalLua(lua_State* L);
+extern "C" int signalLua(lua_State* L);
 extern "C" int saveGameLua(lua_State*);
 
 //Text Object lua bindings definitions
@@ -150,6 +199,18 @@ extern "C" int setEntityVelocityYLua(lua_State *L);
 extern "C" int getEntityVelocityXLua(lua_State *L);
 extern "C" int getEntityVelocityYLua(lua_State *L);
 
+//batch
+extern "C" int getEntitiesPositionLua(lua_State *L);
+extern "C" int setEntitiesPositionLua(lua_State *L);
+extern "C" int getEntitiesVelocityLua(lua_State *L);
+extern "C" int setEntitiesVelocityLua(lua_State *L);
+extern "C" int getEntityRangeLua(lua_State *L);
+extern "C" int entityRangeGetPositionLua(lua_State *L);
+extern "C" int entityRangeSetPositionLua(lua_State *L);
+extern "C" int entityRangeGetVelocityLua(lua_State *L);
+extern "C" int entityRangeSetVelocityLua(lua_State *L);
+extern "C" int entityRangeLengthLua(lua_State *L);
+
 //texture
 extern "C" int setEntityTextureLua(lua_State *L);
 extern "C" int setEntityVisibleLua(lua_State *L);
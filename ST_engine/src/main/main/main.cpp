@@ -29,6 +29,19 @@ int ST_engine_main(int argc, char *argv[]) {
     (void)argc;
     (void)argv;
 
+    //the default fonts have compile-time ids, reserve them before any other string can take them
+    if(!ST::reserve_string_id(DEFAULT_FONT_NORMAL) || !ST::reserve_string_id(DEFAULT_FONT_SMALL)){
+        fprintf(stderr, "The ids of the default fonts are taken by other strings\n");
+        return -1;
+    }
+
+    //compiled scripts are cached in the user's own directory for the game, not next to the scripts
+    char* pref_path = SDL_GetPrefPath("ST", "ST_engine");
+    if(pref_path != nullptr){
+        lua_backend::set_bytecode_cache(pref_path);
+        SDL_free(pref_path);
+    }
+
     //Order of subsystem initialization is crucial
 #ifndef TESTING
     message_bus gMessage_bus;
@@ -41,7 +54,7 @@ int ST_engine_main(int argc, char *argv[]) {
     audio_manager gAudio_manager(gTask_manager, gMessage_bus);
     input_manager gInput_manager(gTask_manager, gMessage_bus);
     window_manager gDisplay_manager(gMessage_bus, gTask_manager, "ST");
-    drawing_manager gDrawing_manager(gDisplay_manager.get_window(), gMessage_bus);
+    drawing_manager gDrawing_manager(gDisplay_manager.get_window(), gMessage_bus, gTask_manager);
 
     assets_manager gAssets_manager(gMessage_bus, gTask_manager);
     physics_manager gPhysics_manager(gMessage_bus);
@@ -76,6 +89,7 @@ int ST_engine_main(int argc, char *argv[]) {
                 total_time -= UPDATE_RATE;
             }
             while (total_time >= UPDATE_RATE);
+            gGame_manager.get_level()->update_entity_index();
             //All three start their own update tasks which run in the background
             gAssets_manager.update();
             gDisplay_manager.update();
@@ -84,6 +98,9 @@ int ST_engine_main(int argc, char *argv[]) {
         gConsole.update();
         gFps.update(current_time, 1000/frame_time);
         gDrawing_manager.update(*gGame_manager.get_level(), gFps.get_value(), gConsole);
+
+        //the time left until the next game logic update is spent collecting Lua garbage
+        gGame_manager.collect_garbage(UPDATE_RATE - total_time - (gTimer.time_since_start() - current_time));
     }
     return 0;
 }
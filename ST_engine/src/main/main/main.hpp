@@ -22,5 +22,6 @@
 #include <console.hpp>
 #include <main/timer.hpp>
 #include <main/fps.hpp>
+#include <SDL_filesystem.h>
 
 #endif //MAIN_DEF
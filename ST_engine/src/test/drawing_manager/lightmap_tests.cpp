@@ -0,0 +1,326 @@
+/* This file is part of the "ST" project.
+ * You may use, distribute or modify this code under the terms
+ * of the GNU General Public License version 2.
+ * See LICENCE.txt in the root directory of the project.
+ *
+ * Author: Maxim Atanasov
+ * E-mail: maxim.atanasov@protonmail.com
+ */
+
+#include <gtest/gtest.h>
+#include <drawing_manager/lightmap.hpp>
+#include <task_manager.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+/**
+ * The darkness of a single light at a cell, computed without the kernel.
+ */
+static uint8_t reference_light(float x, float y, float radius, float intensity, uint8_t brightness, uint8_t darkness,
+                               uint16_t column, uint16_t row){
+    double distance = std::hypot(column - static_cast<double>(x), row - static_cast<double>(y));
+    double step = darkness / static_cast<double>(radius);
+    double value = brightness + step * std::max(distance - intensity, 0.0);
+    return static_cast<uint8_t>(std::min(value, static_cast<double>(darkness)));
+}
+
+TEST(lightmap_tests, test_reset){
+    //Set up
+    ST::lightmap test_subject;
+
+    //Test
+    test_subject.reset(40, 20, 200);
+
+    ASSERT_EQ(40, test_subject.width);
+    ASSERT_EQ(20, test_subject.height);
+    ASSERT_EQ(800, test_subject.cells.size());
+    ASSERT_TRUE(std::all_of(test_subject.cells.begin(), test_subject.cells.end(), [](uint8_t i){return i == 200;}));
+}
+
+TEST(lightmap_tests, test_light_intensity){
+    //Set up
+    ST::lightmap test_subject;
+    test_subject.reset(100, 100, 255);
+
+    //Test
+    test_subject.add_light(50, 50, 20, 5, 10, 255);
+
+    ASSERT_EQ(10, test_subject.at(50, 50));
+    ASSERT_EQ(10, test_subject.at(55, 50));
+    ASSERT_EQ(10, test_subject.at(50, 45));
+    ASSERT_EQ(10, test_subject.at(53, 54));
+    ASSERT_LT(10, test_subject.at(56, 50));
+}
+
+TEST(lightmap_tests, test_light_falloff){
+    //Set up
+    ST::lightmap test_subject;
+    test_subject.reset(100, 100, 255);
+
+    //Test
+    test_subject.add_light(50, 50, 20, 5, 0, 255);
+
+    for(uint16_t i = 50; i < 99; i++){
+        ASSERT_LE(test_subject.at(i, 50), test_subject.at(i + 1, 50));
+        ASSERT_EQ(test_subject.at(i, 50), test_subject.at(50, i));
+        ASSERT_EQ(test_subject.at(i, 50), test_subject.at(100 - i, 50));
+    }
+    ASSERT_EQ(255, test_subject.at(75, 50));
+    ASSERT_EQ(255, test_subject.at(70, 70));
+    ASSERT_EQ(255, test_subject.at(0, 0));
+}
+
+TEST(lightmap_tests, test_light_matches_reference){
+    //Set up
+    ST::lightmap test_subject;
+    test_subject.reset(97, 61, 230);
+
+    //Test
+    test_subject.add_light(40.5f, 30.25f, 17.3f, 3.7f, 20, 230);
+
+    for(uint16_t row = 0; row < test_subject.height; row++){
+        for(uint16_t column = 0; column < test_subject.width; column++){
+            int32_t expected = reference_light(40.5f, 30.25f, 17.3f, 3.7f, 20, 230, column, row);
+            ASSERT_NEAR(expected, test_subject.at(column, row), 1);
+        }
+    }
+}
+
+TEST(lightmap_tests, test_light_partially_off_map){
+    //Set up
+    ST::lightmap test_subject;
+    test_subject.reset(50, 50, 255);
+
+    //Test
+    test_subject.add_light(-5, 48, 20, 10, 0, 255);
+
+    for(uint16_t row = 0; row < test_subject.height; row++){
+        for(uint16_t column = 0; column < test_subject.width; column++){
+            ASSERT_NEAR(reference_light(-5, 48, 20, 10, 0, 255, column, row), test_subject.at(column, row), 1);
+        }
+    }
+    ASSERT_EQ(0, test_subject.at(0, 49));
+}
+
+TEST(lightmap_tests, test_light_off_map){
+    //Set up
+    ST::lightmap test_subject;
+    test_subject.reset(50, 50, 255);
+
+    //Test
+    test_subject.add_light(-40, 25, 20, 10, 0, 255);
+    test_subject.add_light(25, 200, 20, 10, 0, 255);
+    test_subject.add_light(90, 90, 20, 10, 0, 255);
+
+    ASSERT_TRUE(std::all_of(test_subject.cells.begin(), test_subject.cells.end(), [](uint8_t i){return i == 255;}));
+}
+
+TEST(lightmap_tests, test_overlapping_lights_keep_brightest){
+    //Set up
+    ST::lightmap test_subject1;
+    ST::lightmap test_subject2;
+    test_subject1.reset(80, 40, 255);
+    test_subject2.reset(80, 40, 255);
+
+    //Test
+    test_subject1.add_light(30, 20, 15, 2, 0, 255);
+    test_subject1.add_light(45, 20, 25, 0, 60, 255);
+    test_subject2.add_light(45, 20, 25, 0, 60, 255);
+    test_subject2.add_light(30, 20, 15, 2, 0, 255);
+
+    ASSERT_EQ(test_subject1.cells, test_subject2.cells);
+    for(uint16_t row = 0; row < test_subject1.height; row++){
+        for(uint16_t column = 0; column < test_subject1.width; column++){
+            int32_t expected = std::min(reference_light(30, 20, 15, 2, 0, 255, column, row),
+                                        reference_light(45, 20, 25, 0, 60, 255, column, row));
+            ASSERT_NEAR(expected, test_subject1.at(column, row), 1);
+        }
+    }
+}
+
+TEST(lightmap_tests, test_light_brighter_than_darkness){
+    //Set up
+    ST::lightmap test_subject;
+    test_subject.reset(50, 50, 100);
+
+    //Test
+    test_subject.add_light(25, 25, 20, 10, 150, 100);
+
+    ASSERT_TRUE(std::all_of(test_subject.cells.begin(), test_subject.cells.end(), [](uint8_t i){return i == 100;}));
+}
+
+TEST(lightmap_tests, test_many_lights_at_1080p){
+    //Set up
+    ST::lightmap test_subject;
+    test_subject.reset(1920, 1080, 255);
+    auto start = std::chrono::steady_clock::now();
+
+    //Test
+    for(uint16_t i = 0; i < 100; i++){
+        test_subject.add_light(static_cast<float>(i * 97 % 1920), static_cast<float>(i * 61 % 1080), 100, 20, 0, 255);
+    }
+
+    auto time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    ASSERT_EQ(0, test_subject.at(0, 0));
+    ASSERT_LT(time.count(), 1000);
+}
+
+TEST(lightmap_tests, test_add_lights_matches_add_light){
+    //Set up
+    task_manager test_task_manager(4);
+    ST::lightmap test_subject1;
+    ST::lightmap test_subject2;
+    test_subject1.reset(389, 217, 240);
+    test_subject2.reset(389, 217, 240);
+    std::vector<ST::lightmap::light> lights;
+    for(uint16_t i = 0; i < 150; i++){
+        lights.push_back(ST::lightmap::light{static_cast<float>(i * 37 % 460) - 30.5f, static_cast<float>(i * 23 % 280) - 20.25f,
+                                             static_cast<float>(5 + i % 40), static_cast<float>(i % 7), static_cast<uint8_t>(i % 250)});
+    }
+
+    //Test
+    for(const auto& light : lights){
+        test_subject1.add_light(light.x, light.y, light.radius, light.intensity, light.brightness, 240);
+    }
+    test_subject2.add_lights(lights, 240, test_task_manager);
+
+    ASSERT_EQ(test_subject1.cells, test_subject2.cells);
+}
+
+TEST(lightmap_tests, test_add_lights_small_map){
+    //Set up
+    task_manager test_task_manager(4);
+    ST::lightmap test_subject1;
+    ST::lightmap test_subject2;
+    test_subject1.reset(5, 3, 255);
+    test_subject2.reset(5, 3, 255);
+    std::vector<ST::lightmap::light> lights{{1, 1, 3, 0, 0}, {4, 2, 2, 1, 100}, {-10, -10, 2, 1, 0}};
+
+    //Test
+    for(const auto& light : lights){
+        test_subject1.add_light(light.x, light.y, light.radius, light.intensity, light.brightness, 255);
+    }
+    test_subject2.add_lights(lights, 255, test_task_manager);
+
+    ASSERT_EQ(test_subject1.cells, test_subject2.cells);
+    ASSERT_EQ(0, test_subject2.at(1, 1));
+}
+
+/**
+ * A lightmap with the given lights, drawn from scratch.
+ */
+static ST::lightmap reference_lightmap(const std::vector<ST::lightmap::light>& lights, uint8_t darkness){
+    ST::lightmap result;
+    result.reset(200, 120, darkness);
+    for(const auto& light : lights){
+        result.add_light(light.x, light.y, light.radius, light.intensity, light.brightness, darkness);
+    }
+    return result;
+}
+
+TEST(lightmap_tests, test_update_lights_matches_rebuild){
+    //Set up
+    task_manager test_task_manager(4);
+    ST::lightmap test_subject;
+    test_subject.reset(200, 120, 255);
+    std::vector<ST::lightmap::light> lights{{20, 20, 15, 2, 0}, {100, 60, 30, 5, 40}, {180, 100, 10, 0, 0}};
+    test_subject.update_lights(lights, 255, 0, 0, test_task_manager);
+    ASSERT_EQ(reference_lightmap(lights, 255).cells, test_subject.cells);
+
+    //Test
+    lights[1].x = 130;
+    test_subject.update_lights(lights, 255, 0, 0, test_task_manager);
+    ASSERT_EQ(reference_lightmap(lights, 255).cells, test_subject.cells);
+
+    lights[0].brightness = 120;
+    test_subject.update_lights(lights, 255, 0, 0, test_task_manager);
+    ASSERT_EQ(reference_lightmap(lights, 255).cells, test_subject.cells);
+
+    lights.push_back({60, 90, 25, 3, 10});
+    test_subject.update_lights(lights, 255, 0, 0, test_task_manager);
+    ASSERT_EQ(reference_lightmap(lights, 255).cells, test_subject.cells);
+
+    lights.erase(lights.begin());
+    test_subject.update_lights(lights, 255, 0, 0, test_task_manager);
+    ASSERT_EQ(reference_lightmap(lights, 255).cells, test_subject.cells);
+
+    test_subject.update_lights(lights, 200, 0, 0, test_task_manager);
+    ASSERT_EQ(reference_lightmap(lights, 200).cells, test_subject.cells);
+
+    lights.clear();
+    test_subject.update_lights(lights, 200, 0, 0, test_task_manager);
+    ASSERT_EQ(reference_lightmap(lights, 200).cells, test_subject.cells);
+}
+
+TEST(lightmap_tests, test_update_lights_keeps_unchanged_tiles){
+    //Set up
+    task_manager test_task_manager(4);
+    ST::lightmap test_subject;
+    test_subject.reset(200, 120, 255);
+    std::vector<ST::lightmap::light> lights{{20, 20, 10, 2, 0}, {180, 100, 10, 0, 0}};
+    test_subject.update_lights(lights, 255, 0, 0, test_task_manager);
+
+    //Test
+    test_subject.cells[0] = 7;
+    test_subject.update_lights(lights, 255, 0, 0, test_task_manager);
+    ASSERT_EQ(7, test_subject.at(0, 0));
+
+    lights[1].y = 110;
+    test_subject.update_lights(lights, 255, 0, 0, test_task_manager);
+    ASSERT_EQ(7, test_subject.at(0, 0));
+    ASSERT_EQ(0, test_subject.at(180, 110));
+
+    lights[0].x = 22;
+    test_subject.update_lights(lights, 255, 0, 0, test_task_manager);
+    ASSERT_EQ(reference_lightmap(lights, 255).cells, test_subject.cells);
+}
+
+/**
+ * The lights moved by a number of columns and rows.
+ */
+static std::vector<ST::lightmap::light> move_lights(std::vector<ST::lightmap::light> lights, float columns, float rows){
+    for(auto& light : lights){
+        light.x += columns;
+        light.y += rows;
+    }
+    return lights;
+}
+
+TEST(lightmap_tests, test_update_lights_scroll_matches_rebuild){
+    //Set up
+    task_manager test_task_manager(4);
+    ST::lightmap test_subject;
+    test_subject.reset(200, 120, 255);
+    std::vector<ST::lightmap::light> lights{{20.5f, 20, 15, 2, 0}, {100, 60.25f, 30, 5, 40}, {180, 100, 10, 0, 0}};
+    test_subject.update_lights(lights, 255, 0, 0, test_task_manager);
+
+    //Test
+    test_subject.update_lights(lights, 255, 7, 3, test_task_manager);
+    ASSERT_EQ(reference_lightmap(move_lights(lights, -7, -3), 255).cells, test_subject.cells);
+
+    test_subject.update_lights(lights, 255, -20, 11, test_task_manager);
+    ASSERT_EQ(reference_lightmap(move_lights(lights, 20, -11), 255).cells, test_subject.cells);
+
+    lights[1].x = 60;
+    test_subject.update_lights(lights, 255, -21, -5, test_task_manager);
+    ASSERT_EQ(reference_lightmap(move_lights(lights, 21, 5), 255).cells, test_subject.cells);
+
+    test_subject.update_lights(lights, 255, 500, 0, test_task_manager);
+    ASSERT_EQ(reference_lightmap(move_lights(lights, -500, 0), 255).cells, test_subject.cells);
+}
+
+TEST(lightmap_tests, test_update_lights_scroll_moves_cells){
+    //Set up
+    task_manager test_task_manager(4);
+    ST::lightmap test_subject;
+    test_subject.reset(200, 120, 255);
+    std::vector<ST::lightmap::light> lights{{180, 100, 10, 0, 0}};
+    test_subject.update_lights(lights, 255, 0, 0, test_task_manager);
+
+    //Test
+    test_subject.cells[static_cast<size_t>(40) * 200 + 50] = 7;
+    test_subject.update_lights(lights, 255, 2, 1, test_task_manager);
+    ASSERT_EQ(7, test_subject.at(48, 39));
+    ASSERT_EQ(0, test_subject.at(178, 99));
+}
@@ -0,0 +1,203 @@
+/* This file is part of the "ST" project.
+ * You may use, distribute or modify this code under the terms
+ * of the GNU General Public License version 2.
+ * See LICENCE.txt in the root directory of the project.
+ *
+ * Author: Maxim Atanasov
+ * E-mail: maxim.atanasov@protonmail.com
+ */
+
+#include <gtest/gtest.h>
+#include <drawing_manager/scenery.hpp>
+
+/**
+ * A scenery entity with its bottom left corner at x,y and a 100x100 texture.
+ */
+static ST::entity make_entity(int32_t x, int32_t y){
+    ST::entity result;
+    result.x = x;
+    result.y = y;
+    result.tex_w = 100;
+    result.tex_h = 100;
+    return result;
+}
+
+/**
+ * Marks all chunks clean, as if they were rendered.
+ */
+static void render_chunks(ST::scenery& arg){
+    for(auto& it : arg.chunks){
+        it.second.dirty = false;
+    }
+}
+
+TEST(scenery_tests, test_is_scenery){
+    //Set up
+    ST::entity test_subject = make_entity(0, 0);
+
+    //Test
+    ASSERT_TRUE(ST::scenery::is_scenery(test_subject));
+    test_subject.sprite_num = 4;
+    ASSERT_FALSE(ST::scenery::is_scenery(test_subject));
+    test_subject.sprite_num = 1;
+    test_subject.velocity_x = 1;
+    ASSERT_FALSE(ST::scenery::is_scenery(test_subject));
+    test_subject.velocity_x = 0;
+    test_subject.set_affected_by_physics(true);
+    ASSERT_FALSE(ST::scenery::is_scenery(test_subject));
+    test_subject.set_affected_by_physics(false);
+    test_subject.set_static(true);
+    ASSERT_FALSE(ST::scenery::is_scenery(test_subject));
+    test_subject.set_static(false);
+    test_subject.set_visible(false);
+    ASSERT_FALSE(ST::scenery::is_scenery(test_subject));
+}
+
+TEST(scenery_tests, test_update_chunks){
+    //Set up
+    ST::scenery test_subject;
+    std::vector<ST::entity> entities{make_entity(100, 200), make_entity(1000, 200), make_entity(480, 200),
+                                     make_entity(100, 300)};
+    entities[3].sprite_num = 2;
+
+    //Test
+    test_subject.update(entities);
+
+    ASSERT_EQ(3, test_subject.chunks.size());
+    ASSERT_TRUE(test_subject.chunks[ST::scenery::get_chunk_key(0, 0)].dirty);
+    ASSERT_EQ((std::vector<uint32_t>{0, 2}), test_subject.chunks[ST::scenery::get_chunk_key(0, 0)].entities);
+    ASSERT_EQ((std::vector<uint32_t>{1, 2}), test_subject.chunks[ST::scenery::get_chunk_key(1, 0)].entities);
+    ASSERT_EQ((std::vector<uint32_t>{1}), test_subject.chunks[ST::scenery::get_chunk_key(2, 0)].entities);
+    ASSERT_TRUE(test_subject.is_baked(0));
+    ASSERT_TRUE(test_subject.is_baked(2));
+    ASSERT_FALSE(test_subject.is_baked(3));
+    ASSERT_FALSE(test_subject.is_baked(4));
+}
+
+TEST(scenery_tests, test_unchanged_entities_keep_chunks_clean){
+    //Set up
+    ST::scenery test_subject;
+    std::vector<ST::entity> entities{make_entity(100, 200), make_entity(1000, 200)};
+    test_subject.update(entities);
+    render_chunks(test_subject);
+
+    //Test
+    test_subject.update(entities);
+
+    for(const auto& it : test_subject.chunks){
+        ASSERT_FALSE(it.second.dirty);
+    }
+}
+
+TEST(scenery_tests, test_moved_entity_dirties_old_and_new_chunks){
+    //Set up
+    ST::scenery test_subject;
+    std::vector<ST::entity> entities{make_entity(100, 200), make_entity(1000, 200), make_entity(2000, 200)};
+    test_subject.update(entities);
+    render_chunks(test_subject);
+
+    //Test
+    entities[0].x = 1100;
+    test_subject.update(entities);
+
+    ASSERT_TRUE(test_subject.chunks[ST::scenery::get_chunk_key(0, 0)].dirty);
+    ASSERT_TRUE(test_subject.chunks[ST::scenery::get_chunk_key(0, 0)].entities.empty());
+    ASSERT_TRUE(test_subject.chunks[ST::scenery::get_chunk_key(2, 0)].dirty);
+    ASSERT_EQ((std::vector<uint32_t>{0, 1}), test_subject.chunks[ST::scenery::get_chunk_key(2, 0)].entities);
+    ASSERT_FALSE(test_subject.chunks[ST::scenery::get_chunk_key(3, 0)].dirty);
+}
+
+TEST(scenery_tests, test_entity_stops_being_scenery){
+    //Set up
+    ST::scenery test_subject;
+    std::vector<ST::entity> entities{make_entity(100, 200), make_entity(150, 200)};
+    test_subject.update(entities);
+    render_chunks(test_subject);
+
+    //Test
+    entities[1].velocity_x = 5;
+    test_subject.update(entities);
+
+    ASSERT_FALSE(test_subject.is_baked(1));
+    ASSERT_TRUE(test_subject.chunks[ST::scenery::get_chunk_key(0, 0)].dirty);
+    ASSERT_EQ((std::vector<uint32_t>{0}), test_subject.chunks[ST::scenery::get_chunk_key(0, 0)].entities);
+}
+
+TEST(scenery_tests, test_negative_coordinates){
+    //Set up
+    ST::scenery test_subject;
+    std::vector<ST::entity> entities{make_entity(-100, -50)};
+
+    //Test
+    test_subject.update(entities);
+
+    ASSERT_EQ((std::vector<uint32_t>{0}), test_subject.chunks[ST::scenery::get_chunk_key(-1, -1)].entities);
+    ASSERT_EQ(1, test_subject.chunks.size());
+}
+
+TEST(scenery_tests, test_invalidate_texture){
+    //Set up
+    ST::scenery test_subject;
+    std::vector<ST::entity> entities{make_entity(100, 200), make_entity(1000, 200)};
+    entities[0].texture = 5;
+    entities[1].texture = 6;
+    test_subject.update(entities);
+    render_chunks(test_subject);
+
+    //Test
+    test_subject.invalidate_texture(6);
+
+    ASSERT_FALSE(test_subject.chunks[ST::scenery::get_chunk_key(0, 0)].dirty);
+    ASSERT_TRUE(test_subject.chunks[ST::scenery::get_chunk_key(1, 0)].dirty);
+}
+
+TEST(scenery_tests, test_fewer_entities_rebuilds){
+    //Set up
+    ST::scenery test_subject;
+    std::vector<ST::entity> entities{make_entity(100, 200), make_entity(1000, 200)};
+    test_subject.update(entities);
+    render_chunks(test_subject);
+
+    //Test
+    entities.pop_back();
+    test_subject.update(entities);
+
+    ASSERT_EQ((std::vector<uint32_t>{0}), test_subject.chunks[ST::scenery::get_chunk_key(0, 0)].entities);
+    ASSERT_TRUE(test_subject.chunks[ST::scenery::get_chunk_key(0, 0)].dirty);
+    ASSERT_TRUE(test_subject.chunks[ST::scenery::get_chunk_key(1, 0)].entities.empty());
+    ASSERT_TRUE(test_subject.chunks[ST::scenery::get_chunk_key(1, 0)].dirty);
+    ASSERT_FALSE(test_subject.is_baked(1));
+}
+
+TEST(scenery_tests, test_scenery_after_moving_entity_not_baked){
+    //Set up
+    ST::scenery test_subject;
+    std::vector<ST::entity> entities{make_entity(100, 200), make_entity(150, 200), make_entity(200, 200)};
+    entities[1].velocity_x = 5;
+
+    //Test
+    test_subject.update(entities);
+
+    ASSERT_TRUE(test_subject.is_baked(0));
+    ASSERT_FALSE(test_subject.is_baked(1));
+    ASSERT_FALSE(test_subject.is_baked(2));
+    ASSERT_EQ((std::vector<uint32_t>{0}), test_subject.chunks[ST::scenery::get_chunk_key(0, 0)].entities);
+
+    render_chunks(test_subject);
+    entities[1].velocity_x = 0;
+    test_subject.update(entities);
+
+    ASSERT_TRUE(test_subject.is_baked(1));
+    ASSERT_TRUE(test_subject.is_baked(2));
+    ASSERT_TRUE(test_subject.chunks[ST::scenery::get_chunk_key(0, 0)].dirty);
+    ASSERT_EQ((std::vector<uint32_t>{0, 1, 2}), test_subject.chunks[ST::scenery::get_chunk_key(0, 0)].entities);
+
+    render_chunks(test_subject);
+    entities[0].velocity_x = 5;
+    test_subject.update(entities);
+
+    ASSERT_FALSE(test_subject.is_baked(0));
+    ASSERT_FALSE(test_subject.is_baked(1));
+    ASSERT_FALSE(test_subject.is_baked(2));
+    ASSERT_TRUE(test_subject.chunks[ST::scenery::get_chunk_key(0, 0)].entities.empty());
+}
@@ -0,0 +1,149 @@
+/* This file is part of the "ST" project.
+ * You may use, distribute or modify this code under the terms
+ * of the GNU General Public License version 2.
+ * See LICENCE.txt in the root directory of the project.
+ *
+ * Author: Maxim Atanasov
+ * E-mail: maxim.atanasov@protonmail.com
+ */
+
+#include <gtest/gtest.h>
+#include <game_manager/game_manager.hpp>
+
+/// Tests fixture for the game_manager
+class game_manager_test : public ::testing::Test {
+
+protected:
+    message_bus* msg_bus{};
+    game_manager* test_subject{};
+
+    int8_t load_level(const std::string& level_name){
+        return test_subject->load_level(level_name);
+    }
+
+    void start_level(const std::string& level_name){
+        test_subject->start_level(level_name);
+    }
+
+    void update_level_load_progress(const std::string& level_name, uint16_t loaded, uint16_t total){
+        test_subject->update_level_load_progress("levels/" + level_name + "/assets.list",
+                                                 loaded | static_cast<uint32_t>(total) << 16U);
+    }
+
+    std::string get_pending_level(){
+        return test_subject->pending_level;
+    }
+
+    void run_script(const std::string& script){
+        test_subject->gScript_backend.run_script(script);
+    }
+
+    void run_tasks(){
+        test_subject->gScript_backend.run_tasks();
+    }
+
+    void SetUp() override{
+        msg_bus = new message_bus();
+        //the first level is not among the test resources, so nothing is running after this
+        test_subject = new game_manager(*msg_bus);
+    }
+
+    void TearDown() override{
+        delete test_subject;
+        delete msg_bus;
+    }
+};
+
+TEST_F(game_manager_test, test_start_level_with_nothing_running){
+    //Set up
+    ASSERT_EQ(nullptr, test_subject->get_level());
+
+    //Test - there is nothing to keep running, so the level starts before its assets are loaded
+    ::testing::internal::CaptureStdout();
+    start_level("game_manager_level_1");
+    std::string output = testing::internal::GetCapturedStdout();
+
+    //Check result
+    ASSERT_EQ("game_manager_level_1", test_subject->get_active_level());
+    ASSERT_EQ("game_manager_level_1", test_subject->get_level()->get_name());
+    ASSERT_EQ("", get_pending_level());
+    ASSERT_EQ("game_manager_level_1 started\n", output);
+}
+
+TEST_F(game_manager_test, test_start_resident_level){
+    //Set up
+    start_level("game_manager_level_1");
+    ASSERT_EQ(0, load_level("game_manager_level_2"));
+    update_level_load_progress("game_manager_level_2", 3, 3);
+
+    //Test - the assets are already loaded, so the level starts right away
+    start_level("game_manager_level_2");
+
+    //Check result
+    ASSERT_EQ("game_manager_level_2", test_subject->get_active_level());
+    ASSERT_EQ("game_manager_level_2", test_subject->get_level()->get_name());
+    ASSERT_EQ("", get_pending_level());
+}
+
+TEST_F(game_manager_test, test_start_level_deferred_until_loaded){
+    //Set up
+    start_level("game_manager_level_1");
+
+    //Test - the old level keeps running while the assets of the new one are loading
+    start_level("game_manager_level_2");
+    ASSERT_EQ("game_manager_level_1", test_subject->get_active_level());
+    ASSERT_EQ("game_manager_level_1", test_subject->get_level()->get_name());
+    ASSERT_EQ("game_manager_level_2", get_pending_level());
+
+    update_level_load_progress("game_manager_level_2", 1, 3);
+    ASSERT_EQ("game_manager_level_1", test_subject->get_active_level());
+    ASSERT_EQ(33, test_subject->get_level_load_progress("game_manager_level_2"));
+
+    //Test - the switch happens once the last asset is loaded
+    update_level_load_progress("game_manager_level_2", 3, 3);
+
+    //Check result
+    ASSERT_EQ("game_manager_level_2", test_subject->get_active_level());
+    ASSERT_EQ("game_manager_level_2", test_subject->get_level()->get_name());
+    ASSERT_EQ("", get_pending_level());
+    ASSERT_EQ(100, test_subject->get_level_load_progress("game_manager_level_2"));
+}
+
+TEST_F(game_manager_test, test_level_loaded_signal){
+    //Set up
+    start_level("game_manager_level_1");
+    ASSERT_EQ(0, load_level("game_manager_level_2"));
+    run_script("startTask(function() waitForSignal(\"levelLoaded game_manager_level_2\") print(\"loaded\") end)");
+
+    //Test - the task is only woken up by the last asset
+    ::testing::internal::CaptureStdout();
+    run_tasks();
+    update_level_load_progress("game_manager_level_2", 2, 3);
+    run_tasks();
+    update_level_load_progress("game_manager_level_2", 3, 3);
+    run_tasks();
+    std::string output = testing::internal::GetCapturedStdout();
+
+    //Check result - the level was only loaded in advance, not started
+    ASSERT_EQ("loaded\n", output);
+    ASSERT_EQ("game_manager_level_1", test_subject->get_active_level());
+}
+
+TEST_F(game_manager_test, test_missing_assets_list){
+    //Set up
+    start_level("game_manager_level_1");
+    start_level("game_manager_level_2");
+    ASSERT_EQ("game_manager_level_2", get_pending_level());
+
+    //Test - a level without an asset list is reported as 0 out of 0 assets loaded
+    update_level_load_progress("game_manager_level_2", 0, 0);
+
+    //Check result
+    ASSERT_EQ("game_manager_level_2", test_subject->get_active_level());
+    ASSERT_EQ(100, test_subject->get_level_load_progress("game_manager_level_2"));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,135 @@
+/* This file is part of the "ST" project.
+ * You may use, distribute or modify this code under the terms
+ * of the GNU General Public License version 2.
+ * See LICENCE.txt in the root directory of the project.
+ *
+ * Author: Maxim Atanasov
+ * E-mail: maxim.atanasov@protonmail.com
+ */
+
+#include <gtest/gtest.h>
+#include <game_manager/level/spatial_index.hpp>
+
+/**
+ * An entity with its bottom left corner at x,y and a 100x100 texture.
+ */
+static ST::entity make_entity(int32_t x, int32_t y){
+    ST::entity result;
+    result.x = x;
+    result.y = y;
+    result.tex_w = 100;
+    result.tex_h = 100;
+    return result;
+}
+
+TEST(spatial_index_tests, test_query_rectangle){
+    //Set up
+    ST::spatial_index test_subject;
+    std::vector<ST::entity> entities{make_entity(100, 200), make_entity(5000, 5000), make_entity(1800, 1000)};
+    std::vector<uint32_t> result;
+
+    //Test
+    test_subject.update(entities);
+    test_subject.query(0, 0, 1920, 1080, result);
+
+    ASSERT_EQ((std::vector<uint32_t>{0, 2}), result);
+}
+
+TEST(spatial_index_tests, test_query_negative_coordinates){
+    //Set up
+    ST::spatial_index test_subject;
+    std::vector<ST::entity> entities{make_entity(-1000, -500), make_entity(100, 200)};
+    std::vector<uint32_t> result;
+
+    //Test
+    test_subject.update(entities);
+    test_subject.query(-1200, -800, 640, 480, result);
+
+    ASSERT_EQ((std::vector<uint32_t>{0}), result);
+}
+
+TEST(spatial_index_tests, test_query_static_entities){
+    //Set up
+    ST::spatial_index test_subject;
+    std::vector<ST::entity> entities{make_entity(5000, 5000), make_entity(100, 200)};
+    entities[0].set_static(true);
+    std::vector<uint32_t> result;
+
+    //Test
+    test_subject.update(entities);
+    test_subject.query(10000, 10000, 1920, 1080, result);
+
+    ASSERT_EQ((std::vector<uint32_t>{0}), result);
+}
+
+TEST(spatial_index_tests, test_query_large_entity_once){
+    //Set up
+    ST::spatial_index test_subject;
+    std::vector<ST::entity> entities{make_entity(1000, 1000), make_entity(0, 1080)};
+    entities[1].tex_w = 1920;
+    entities[1].tex_h = 1080;
+    std::vector<uint32_t> result{7, 7, 7};
+
+    //Test
+    test_subject.update(entities);
+    test_subject.query(0, 0, 1920, 1080, result);
+
+    ASSERT_EQ((std::vector<uint32_t>{0, 1}), result);
+}
+
+TEST(spatial_index_tests, test_update_moved_entity){
+    //Set up
+    ST::spatial_index test_subject;
+    std::vector<ST::entity> entities{make_entity(100, 200), make_entity(300, 200)};
+    std::vector<uint32_t> result;
+    test_subject.update(entities);
+
+    //Test
+    entities[0].x = 4000;
+    test_subject.update(entities);
+    test_subject.query(0, 0, 1920, 1080, result);
+    ASSERT_EQ((std::vector<uint32_t>{1}), result);
+
+    test_subject.query(3900, 0, 1920, 1080, result);
+    ASSERT_EQ((std::vector<uint32_t>{0}), result);
+
+    entities[1].set_static(true);
+    test_subject.update(entities);
+    test_subject.query(3900, 0, 1920, 1080, result);
+    ASSERT_EQ((std::vector<uint32_t>{0, 1}), result);
+}
+
+TEST(spatial_index_tests, test_update_added_and_removed_entities){
+    //Set up
+    ST::spatial_index test_subject;
+    std::vector<ST::entity> entities{make_entity(100, 200), make_entity(300, 200)};
+    std::vector<uint32_t> result;
+    test_subject.update(entities);
+
+    //Test
+    entities.push_back(make_entity(500, 500));
+    test_subject.update(entities);
+    test_subject.query(0, 0, 1920, 1080, result);
+    ASSERT_EQ((std::vector<uint32_t>{0, 1, 2}), result);
+
+    entities.clear();
+    entities.push_back(make_entity(5000, 5000));
+    test_subject.update(entities);
+    test_subject.query(0, 0, 1920, 1080, result);
+    ASSERT_TRUE(result.empty());
+}
+
+TEST(spatial_index_tests, test_clear){
+    //Set up
+    ST::spatial_index test_subject;
+    std::vector<ST::entity> entities{make_entity(100, 200), make_entity(300, 200)};
+    entities[1].set_static(true);
+    std::vector<uint32_t> result;
+    test_subject.update(entities);
+
+    //Test
+    test_subject.clear();
+    test_subject.query(0, 0, 1920, 1080, result);
+
+    ASSERT_TRUE(result.empty());
+}
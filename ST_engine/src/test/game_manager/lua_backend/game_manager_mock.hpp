@@ -53,6 +53,7 @@ public:
     game_manager(message_bus* msg_bus, task_manager* tsk_mngr){}
     ~game_manager() = default;
     std::string get_active_level() const {return "test_level";}
+    uint8_t get_level_load_progress(const std::string&) const {return 50;}
 
     ST::level* get_level() {
         get_level_calls++;
@@ -31,6 +31,10 @@ protected:
         return test_subject.L;
     }
 
+    size_t get_task_count(){
+        return test_subject.tasks.size();
+    }
+
     message_bus* msg_bus{};
     game_manager* game_mngr{};
 
@@ -255,12 +259,112 @@ TEST_F(lua_backend_test, test_hash_string_setClickKey){
     }
 }
 
+TEST_F(lua_backend_test, test_hash_string_skips_strings_and_comments){
+    std::string script = "log(\"playSound(\\\"a.wav\\\")\") -- keyHeld(\"JUMP\")\n"
+                         "--[[ playMusic(\"b.ogg\") ]] x = [==[keyPressed(\"JUMP\")]==]\n"
+                         "keyReleased(\"JUMP\")";
+    std::string expected = "log(\"playSound(\\\"a.wav\\\")\") -- keyHeld(\"JUMP\")\n"
+                           "--[[ playMusic(\"b.ogg\") ]] x = [==[keyPressed(\"JUMP\")]==]\n"
+                           "keyReleased(" + std::to_string(ST::hash_string("JUMP")) + ")";
+    ASSERT_EQ(expected, hash_string_lua(script));
+}
+
+TEST_F(lua_backend_test, test_hash_file_benchmark){
+    //Set up - a large script with hashed call sites, strings and comments on every line
+    std::string script = "lua_scripts/test_script_benchmark.lua";
+    std::ofstream file(script);
+    for(uint32_t i = 0; i < 20000; i++){
+        file << "if keyHeld(\"KEY" << i % 64 << "\") then playSound(\"sound" << i % 128 << ".wav\", 100, 1) end"
+             << " -- playMusic(\"not_hashed.ogg\")\n"
+             << "local text" << i << " = \"keyPressed(\\\"NOT_HASHED\\\")\"\n";
+    }
+    file.close();
+
+    //Test
+    timer test_timer;
+    double start_time = test_timer.time_since_start();
+    std::string result = hash_file(script);
+    double end_time = test_timer.time_since_start();
+    fprintf(stdout, "Hashed a %zu byte script in %f ms\n", result.size(), end_time - start_time);
+
+    //Tear Down
+    remove(script.c_str());
+
+    ASSERT_EQ(std::string::npos, result.find("keyHeld(\""));
+    ASSERT_EQ(std::string::npos, result.find("playSound(\""));
+    ASSERT_NE(std::string::npos, result.find("playMusic(\"not_hashed.ogg\")"));
+    ASSERT_NE(std::string::npos, result.find("NOT_HASHED"));
+    ASSERT_LT(end_time - start_time, 2000);
+}
+
 TEST_F(lua_backend_test, test_run_simple_script){
     ::testing::internal::CaptureStdout();
     ASSERT_EQ(0, test_subject.run_file("lua_scripts/test_script_simple.lua"));
     ASSERT_EQ("4\n", testing::internal::GetCapturedStdout());
 }
 
+TEST_F(lua_backend_test, test_run_cached_script){
+    //Set up
+    std::string script = "lua_scripts/test_script_cached.lua";
+    std::ofstream(script) << "print(1)";
+
+    //Test - the compiled script is cached, but only used while the script doesn't change
+    ::testing::internal::CaptureStdout();
+    ASSERT_EQ(0, test_subject.run_file(script));
+    ASSERT_EQ(0, test_subject.run_file(script));
+    std::ofstream(script) << "print(2)";
+    ASSERT_EQ(0, test_subject.run_file(script));
+    std::string output = testing::internal::GetCapturedStdout();
+
+    //Tear Down
+    remove(script.c_str());
+
+    ASSERT_EQ("1\n1\n2\n", output);
+}
+
+TEST_F(lua_backend_test, test_run_script_cached_on_disk){
+    //Set up
+    std::string script = "lua_scripts/test_script_cached_on_disk.lua";
+    std::ofstream(script) << "print(1)";
+    lua_backend::set_bytecode_cache("lua_scripts/");
+    std::string cache_path = get_bytecode_cache_path(script);
+    //bytecode of another script, cached as if it was compiled from this one
+    std::string bytecode;
+    luaL_loadstring(get_lua_state(), "print(3)");
+    lua_dump(get_lua_state(), write_bytecode, &bytecode, 0);
+    lua_pop(get_lua_state(), 1);
+
+    //Test - the first run compiles and caches the script
+    ::testing::internal::CaptureStdout();
+    ASSERT_EQ(0, test_subject.run_file(script));
+    std::ifstream cache(cache_path);
+    bool cached = cache.good();
+    cache.close();
+
+    //Test - a later run, with nothing cached in memory, only reads the cache file
+    write_bytecode_cache(script, hash_script_content("print(1)"), {}, bytecode);
+    compiled_scripts.clear();
+    ASSERT_EQ(0, test_subject.run_file(script));
+
+    //Test - a cache file that was cut short is not used
+    std::ifstream full_cache(cache_path, std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(full_cache)), std::istreambuf_iterator<char>());
+    full_cache.close();
+    std::ofstream(cache_path, std::ios::binary) << contents.substr(0, contents.size() - 1);
+    compiled_scripts.clear();
+    ASSERT_EQ(0, test_subject.run_file(script));
+    std::string output = testing::internal::GetCapturedStdout();
+
+    //Tear Down
+    lua_backend::set_bytecode_cache("");
+    compiled_scripts.clear();
+    remove(script.c_str());
+    remove(cache_path.c_str());
+
+    ASSERT_TRUE(cached);
+    ASSERT_EQ("1\n3\n1\n", output);
+}
+
 TEST_F(lua_backend_test, test_fail_on_broken_script){
     ::testing::FLAGS_gtest_death_test_style = "threadsafe";
 #ifdef _MSC_VER
@@ -272,6 +376,25 @@ TEST_F(lua_backend_test, test_fail_on_broken_script){
 #endif
 }
 
+TEST_F(lua_backend_test, test_fail_on_bytecode_script){
+    //Set up
+    std::string script = "lua_scripts/test_script_bytecode.lua";
+    std::ofstream(script, std::ios::binary) << LUA_SIGNATURE << "bytecode";
+
+    //Test - scripts are only loaded as text
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+#ifdef _MSC_VER
+    //Exit code 3 on WINDOWS
+    ASSERT_EXIT(test_subject.run_file(script), ::testing::ExitedWithCode(3), ".*");
+#else
+    //SIGABRT on UNIX
+    ASSERT_EXIT(test_subject.run_file(script), ::testing::KilledBySignal(SIGABRT), ".*");
+#endif
+
+    //Tear Down
+    remove(script.c_str());
+}
+
 TEST_F(lua_backend_test, test_call_function_setFullscreenLua){
     //Set up
     subscriber subscriber1;
@@ -328,6 +451,23 @@ TEST_F(lua_backend_test, test_call_function_setVsyncLua){
     ASSERT_TRUE(static_cast<bool>(result->base_data0));
 }
 
+TEST_F(lua_backend_test, test_call_function_setTextureBudget){
+    //Set up
+    subscriber subscriber1;
+    msg_bus->subscribe(SET_TEXTURE_BUDGET, &subscriber1);
+
+    //Test
+    test_subject.run_script("setTextureBudget(256, 600)");
+
+    //Check result - expect to see a message with appropriate content
+    message* result = subscriber1.get_next_message();
+
+    ASSERT_TRUE(result);
+    ASSERT_EQ(SET_TEXTURE_BUDGET, result->msg_name);
+    ASSERT_EQ(256U, result->base_data0 & 0x0000ffffU);
+    ASSERT_EQ(600U, (result->base_data0 >> 16U) & 0x0000ffffU);
+}
+
 
 TEST_F(lua_backend_test, test_call_function_startLevelLua){
     //Set up
@@ -346,6 +486,13 @@ TEST_F(lua_backend_test, test_call_function_startLevelLua){
     ASSERT_EQ(level_name, *static_cast<std::string*>(result->get_data()));
 }
 
+TEST_F(lua_backend_test, test_call_function_getLevelLoadProgress){
+    test_subject.run_script("return getLevelLoadProgress(\"some_level\")");
+
+    //Check result
+    ASSERT_EQ(50, lua_tointeger(get_lua_state(), -1));
+}
+
 TEST_F(lua_backend_test, test_call_function_loadLevel){
     //Set up
     subscriber subscriber1;
@@ -663,6 +810,42 @@ TEST_F(lua_backend_test, test_call_function_unloadAsset) {
 	ASSERT_EQ("path/to/asset.webp", *static_cast<std::string*>(result->get_data()));
 }
 
+TEST_F(lua_backend_test, test_call_function_loadAssetFromBinary) {
+    //Set up
+    subscriber subscriber1;
+    msg_bus->subscribe(LOAD_BINARY_ASSET, &subscriber1);
+
+    //Test
+    test_subject.run_script("loadAssetFromBinary(\"path/to/my assets.bin\", \"my asset.webp\")");
+
+    //Check result - expect to see a message with appropriate content
+    message* result = subscriber1.get_next_message();
+
+    ASSERT_TRUE(result);
+    ASSERT_EQ(LOAD_BINARY_ASSET, result->msg_name);
+    auto asset = static_cast<std::pair<std::string, std::string>*>(result->get_data());
+    ASSERT_EQ("path/to/my assets.bin", asset->first);
+    ASSERT_EQ("my asset.webp", asset->second);
+}
+
+TEST_F(lua_backend_test, test_call_function_unloadAssetFromBinary) {
+    //Set up
+    subscriber subscriber1;
+    msg_bus->subscribe(UNLOAD_BINARY_ASSET, &subscriber1);
+
+    //Test
+    test_subject.run_script("unloadAssetFromBinary(\"path/to/my assets.bin\", \"my asset.webp\")");
+
+    //Check result - expect to see a message with appropriate content
+    message* result = subscriber1.get_next_message();
+
+    ASSERT_TRUE(result);
+    ASSERT_EQ(UNLOAD_BINARY_ASSET, result->msg_name);
+    auto asset = static_cast<std::pair<std::string, std::string>*>(result->get_data());
+    ASSERT_EQ("path/to/my assets.bin", asset->first);
+    ASSERT_EQ("my asset.webp", asset->second);
+}
+
 TEST_F(lua_backend_test, test_call_function_setDarkness){
     //Set up
     subscriber subscriber1;
@@ -1252,7 +1435,7 @@ TEST_F(lua_backend_test, test_call_function_createTextObject){
 TEST_F(lua_backend_test, test_call_function_setTextObjectColor){
     //Set up
     game_mngr->get_level()->text_objects.emplace_back(ST::text(500, 600, {255,255,255,255},
-            "SOME_TEXT", ST::hash_string("SOME_FONT.ttf 40")));
+            "SOME_TEXT", ST::hash_string("SOME_FONT.ttf 40"))).is_rendered = true;
 
     //Test
     test_subject.run_script("setTextObjectColor(0, 100, 110, 120, 130)");
@@ -1270,12 +1453,15 @@ TEST_F(lua_backend_test, test_call_function_setTextObjectColor){
     ASSERT_EQ(110, game_mngr->get_level()->text_objects.at(0).color.g);
     ASSERT_EQ(120, game_mngr->get_level()->text_objects.at(0).color.b);
     ASSERT_EQ(130, game_mngr->get_level()->text_objects.at(0).color.a);
+    ASSERT_FALSE(game_mngr->get_level()->text_objects.at(0).is_rendered);
 }
 
 TEST_F(lua_backend_test, test_call_function_setTextObjectText){
     //Set up
-    game_mngr->get_level()->text_objects.emplace_back(ST::text(500, 600, {255,255,255,255},
+    ST::text& added = game_mngr->get_level()->text_objects.emplace_back(ST::text(500, 600, {255,255,255,255},
                                                                     "SOME_TEXT", ST::hash_string("SOME_FONT.ttf 40")));
+    added.is_measured = true;
+    added.is_rendered = true;
     //Test
     test_subject.run_script("setTextObjectText(0, \"NEW_TEXT\")");
 
@@ -1285,6 +1471,8 @@ TEST_F(lua_backend_test, test_call_function_setTextObjectText){
     ASSERT_EQ(500, game_mngr->get_level()->text_objects.at(0).x);
     ASSERT_EQ(600, game_mngr->get_level()->text_objects.at(0).y);
     ASSERT_EQ("NEW_TEXT", game_mngr->get_level()->text_objects.at(0).text_string);
+    ASSERT_FALSE(game_mngr->get_level()->text_objects.at(0).is_measured);
+    ASSERT_FALSE(game_mngr->get_level()->text_objects.at(0).is_rendered);
     ASSERT_EQ(ST::hash_string("SOME_FONT.ttf 40"), game_mngr->get_level()->text_objects.at(0).font);
     ASSERT_TRUE(game_mngr->get_level()->text_objects.at(0).is_visible);
 
@@ -1296,8 +1484,10 @@ TEST_F(lua_backend_test, test_call_function_setTextObjectText){
 
 TEST_F(lua_backend_test, test_call_function_setTextObjectFont){
     //Set up
-    game_mngr->get_level()->text_objects.emplace_back(ST::text(500, 600, {255,255,255,255},
+    ST::text& added = game_mngr->get_level()->text_objects.emplace_back(ST::text(500, 600, {255,255,255,255},
                                                                     "SOME_TEXT", ST::hash_string("SOME_FONT.ttf 40")));
+    added.is_measured = true;
+    added.is_rendered = true;
     //Test
     test_subject.run_script("setTextObjectFont(0, \"NEW_FONT.ttf 40\")");
 
@@ -1308,6 +1498,8 @@ TEST_F(lua_backend_test, test_call_function_setTextObjectFont){
     ASSERT_EQ(600, game_mngr->get_level()->text_objects.at(0).y);
     ASSERT_EQ("SOME_TEXT", game_mngr->get_level()->text_objects.at(0).text_string);
     ASSERT_EQ(ST::hash_string("NEW_FONT.ttf 40"), game_mngr->get_level()->text_objects.at(0).font);
+    ASSERT_FALSE(game_mngr->get_level()->text_objects.at(0).is_measured);
+    ASSERT_FALSE(game_mngr->get_level()->text_objects.at(0).is_rendered);
     ASSERT_TRUE(game_mngr->get_level()->text_objects.at(0).is_visible);
 
     ASSERT_EQ(255, game_mngr->get_level()->text_objects.at(0).color.r);
@@ -2346,6 +2538,282 @@ TEST_F(lua_backend_test, test_call_function_setEntitySpriteNum){
     ASSERT_TRUE(game_mngr->get_level()->entities.at(0).is_active());
 }
 
+TEST_F(lua_backend_test, test_call_function_getEntitiesPosition){
+    //Set up
+    for(int32_t i = 0; i < 3; i++){
+        game_mngr->get_level()->entities.emplace_back();
+        game_mngr->get_level()->entities.at(i).x = 100 * i;
+        game_mngr->get_level()->entities.at(i).y = 100 * i + 1;
+    }
+
+    uint8_t get_level_calls = game_mngr->get_level_calls;
+
+    //Test
+    test_subject.run_script("xs, ys = getEntitiesPosition({2, 0}) return xs[1] + xs[2] * 10 + ys[1] * 100 + ys[2] * 1000");
+
+    //Check result
+    ASSERT_EQ(200 + 0 * 10 + 201 * 100 + 1 * 1000, lua_tointeger(get_lua_state(), -1));
+    ASSERT_EQ(get_level_calls + 1, game_mngr->get_level_calls);
+}
+
+TEST_F(lua_backend_test, test_call_function_getEntitiesPosition_reuses_tables){
+    //Set up
+    game_mngr->get_level()->entities.emplace_back();
+    game_mngr->get_level()->entities.at(0).x = 500;
+
+    //Test
+    test_subject.run_script("xs, ys = {}, {} a, b = getEntitiesPosition({0, 7}, xs, ys) return a == xs and b == ys and ys[2] == nil and xs[1]");
+
+    //Check result
+    ASSERT_EQ(500, lua_tointeger(get_lua_state(), -1));
+}
+
+TEST_F(lua_backend_test, test_call_function_setEntitiesPosition){
+    //Set up
+    game_mngr->get_level()->entities.emplace_back();
+    game_mngr->get_level()->entities.emplace_back();
+    game_mngr->get_level()->entities.at(1).y = 50;
+
+    //Test
+    test_subject.run_script("setEntitiesPosition({1, 0, 5}, {10, 20, 30}, {nil, 40.5})");
+
+    //Check results
+    ASSERT_EQ(20, game_mngr->get_level()->entities.at(0).x);
+    ASSERT_EQ(40, game_mngr->get_level()->entities.at(0).y);
+    ASSERT_EQ(10, game_mngr->get_level()->entities.at(1).x);
+    ASSERT_EQ(50, game_mngr->get_level()->entities.at(1).y);
+}
+
+TEST_F(lua_backend_test, test_call_function_setEntitiesVelocity){
+    //Set up
+    game_mngr->get_level()->entities.emplace_back();
+    game_mngr->get_level()->entities.emplace_back();
+
+    //Test
+    test_subject.run_script("setEntitiesVelocity({0, 1}, {-5, 5}, {12, -12})");
+    test_subject.run_script("vxs, vys = getEntitiesVelocity({1, 0}) return vxs[1] * vys[2]");
+
+    //Check results
+    ASSERT_EQ(-5, game_mngr->get_level()->entities.at(0).velocity_x);
+    ASSERT_EQ(12, game_mngr->get_level()->entities.at(0).velocity_y);
+    ASSERT_EQ(5, game_mngr->get_level()->entities.at(1).velocity_x);
+    ASSERT_EQ(-12, game_mngr->get_level()->entities.at(1).velocity_y);
+    ASSERT_EQ(60, lua_tointeger(get_lua_state(), -1));
+}
+
+TEST_F(lua_backend_test, test_call_function_getEntityRange){
+    //Set up
+    for(int32_t i = 0; i < 4; i++){
+        game_mngr->get_level()->entities.emplace_back();
+    }
+
+    //Test
+    test_subject.run_script("range = getEntityRange(1, 2) range:setPosition({7, 8}, {9, 10}) range:setVelocity({1, 2}, {3, 4})");
+    test_subject.run_script("xs, ys = range:getPosition() vxs, vys = range:getVelocity() return #range * 1000 + xs[2] * 100 + ys[1] + vxs[1] + vys[2]");
+
+    //Check results
+    ASSERT_EQ(0, game_mngr->get_level()->entities.at(0).x);
+    ASSERT_EQ(7, game_mngr->get_level()->entities.at(1).x);
+    ASSERT_EQ(9, game_mngr->get_level()->entities.at(1).y);
+    ASSERT_EQ(8, game_mngr->get_level()->entities.at(2).x);
+    ASSERT_EQ(10, game_mngr->get_level()->entities.at(2).y);
+    ASSERT_EQ(0, game_mngr->get_level()->entities.at(3).x);
+    ASSERT_EQ(2, game_mngr->get_level()->entities.at(2).velocity_x);
+    ASSERT_EQ(3, game_mngr->get_level()->entities.at(1).velocity_y);
+    ASSERT_EQ(2000 + 800 + 9 + 1 + 4, lua_tointeger(get_lua_state(), -1));
+}
+
+TEST_F(lua_backend_test, test_call_function_getEntityRange_clamped){
+    //Set up
+    for(int32_t i = 0; i < 4; i++){
+        game_mngr->get_level()->entities.emplace_back();
+    }
+
+    //Test
+    test_subject.run_script("return #getEntityRange(2, 1000000000000)");
+    ASSERT_EQ(2, lua_tointeger(get_lua_state(), -1));
+    test_subject.run_script("return #getEntityRange(10, 5)");
+    ASSERT_EQ(0, lua_tointeger(get_lua_state(), -1));
+    test_subject.run_script("ok = pcall(getEntityRange, 0, -1) return ok");
+    ASSERT_FALSE(lua_toboolean(get_lua_state(), -1));
+    test_subject.run_script("ok = pcall(getEntityRange, -1, 2) return ok");
+    ASSERT_FALSE(lua_toboolean(get_lua_state(), -1));
+}
+
+TEST_F(lua_backend_test, test_collect_garbage){
+    //Set up
+    ASSERT_EQ(0, lua_gc(get_lua_state(), LUA_GCISRUNNING, 0));
+    test_subject.run_script("for i = 1, 100000 do local garbage = {i} end");
+    uint32_t heap_size = test_subject.get_heap_size();
+    ASSERT_GT(heap_size, 1024U);
+
+    //Test
+    test_subject.collect_garbage(1000);
+
+    //Check results
+    ASSERT_LT(test_subject.get_heap_size(), heap_size / 2);
+    ASSERT_GT(test_subject.get_gc_time(), 0);
+    ASSERT_EQ(0, lua_gc(get_lua_state(), LUA_GCISRUNNING, 0));
+}
+
+TEST_F(lua_backend_test, test_collect_garbage_without_time_budget){
+    //Set up
+    test_subject.run_script("for i = 1, 100000 do local garbage = {i} end");
+    uint32_t heap_size = test_subject.get_heap_size();
+
+    //Test
+    for(uint32_t i = 0; i < 100000 && test_subject.get_heap_size() >= heap_size / 2; i++){
+        test_subject.collect_garbage(0);
+    }
+
+    //Check result
+    ASSERT_LT(test_subject.get_heap_size(), heap_size / 2);
+}
+
+TEST_F(lua_backend_test, test_call_function_getGarbageCollectorStats){
+    //Test
+    test_subject.collect_garbage(1);
+    test_subject.run_script("gcTime, heapSize = getGarbageCollectorStats() return heapSize");
+
+    //Check result
+    ASSERT_EQ(test_subject.get_heap_size(), lua_tointeger(get_lua_state(), -1));
+}
+
+TEST_F(lua_backend_test, test_task_wait_frames){
+    //Set up
+    test_subject.run_script("steps = 0 startTask(function(n) steps = n waitFrames(2) steps = steps + 1 end, 10)");
+    test_subject.run_script("return steps");
+    ASSERT_EQ(0, lua_tointeger(get_lua_state(), -1));
+
+    //Test and check results
+    test_subject.run_tasks();
+    test_subject.run_script("return steps");
+    ASSERT_EQ(10, lua_tointeger(get_lua_state(), -1));
+    test_subject.run_tasks();
+    test_subject.run_script("return steps");
+    ASSERT_EQ(10, lua_tointeger(get_lua_state(), -1));
+    test_subject.run_tasks();
+    test_subject.run_script("return steps");
+    ASSERT_EQ(11, lua_tointeger(get_lua_state(), -1));
+    ASSERT_EQ(0, get_task_count());
+}
+
+TEST_F(lua_backend_test, test_task_wait_time){
+    //Set up
+    test_subject.run_script("done = false startTask(function() waitTime(20) done = true end)");
+    test_subject.run_tasks();
+
+    //Test
+    test_subject.run_tasks();
+    test_subject.run_script("return done");
+    ASSERT_FALSE(lua_toboolean(get_lua_state(), -1));
+    SDL_Delay(30);
+    test_subject.run_tasks();
+
+    //Check result
+    test_subject.run_script("return done");
+    ASSERT_TRUE(lua_toboolean(get_lua_state(), -1));
+}
+
+TEST_F(lua_backend_test, test_task_wait_for_signal){
+    //Set up
+    test_subject.run_script("woken = 0 for i = 1, 100 do startTask(function() waitForSignal(\"go\") woken = woken + 1 end) end");
+    test_subject.run_tasks();
+    test_subject.run_tasks();
+    test_subject.run_script("return woken");
+    ASSERT_EQ(0, lua_tointeger(get_lua_state(), -1));
+
+    //Test
+    test_subject.run_script("signal(\"go\")");
+    test_subject.run_tasks();
+
+    //Check results
+    test_subject.run_script("return woken");
+    ASSERT_EQ(100, lua_tointeger(get_lua_state(), -1));
+    ASSERT_EQ(0, get_task_count());
+}
+
+TEST_F(lua_backend_test, test_stop_task){
+    //Set up
+    test_subject.run_script("count = 0 task = startTask(function() while true do count = count + 1 waitFrames(1) end end)");
+    test_subject.run_tasks();
+    test_subject.run_tasks();
+
+    //Test
+    test_subject.run_script("stopTask(task)");
+    test_subject.run_tasks();
+
+    //Check result
+    test_subject.run_script("return count");
+    ASSERT_EQ(2, lua_tointeger(get_lua_state(), -1));
+    ASSERT_EQ(0, get_task_count());
+}
+
+TEST_F(lua_backend_test, test_start_level_stops_tasks){
+    //Set up
+    test_subject.run_script("startTask(function() waitFrames(1) end) startTask(function() waitForSignal(\"go\") end)");
+    test_subject.run_tasks();
+    ASSERT_EQ(2, get_task_count());
+
+    //Test
+    test_subject.start_level();
+    test_subject.run_tasks();
+
+    //Check result
+    ASSERT_EQ(0, get_task_count());
+}
+
+TEST_F(lua_backend_test, test_wait_outside_of_task){
+    //Set up
+    subscriber subscriber;
+    msg_bus->subscribe(LOG_ERROR, &subscriber);
+
+    //Test
+    test_subject.run_script("waitFrames(1) return 5");
+
+    //Check results
+    ASSERT_EQ(5, lua_tointeger(get_lua_state(), -1));
+    message* result = subscriber.get_next_message();
+    ASSERT_TRUE(result);
+    ASSERT_EQ(LOG_ERROR, result->msg_name);
+    delete result;
+}
+
+TEST_F(lua_backend_test, test_start_level_keeps_lua_state){
+    //Set up
+    lua_State* state = get_lua_state();
+    test_subject.run_script("levelValue = 500 function loop() loopValue = 600 end");
+    test_subject.run_global("loop");
+    test_subject.run_script("return loopValue");
+    ASSERT_EQ(600, lua_tointeger(get_lua_state(), -1));
+
+    //Test
+    test_subject.start_level();
+
+    //Check results
+    ASSERT_EQ(state, get_lua_state());
+    test_subject.run_script("return levelValue");
+    ASSERT_TRUE(lua_isnil(get_lua_state(), -1));
+    test_subject.run_script("return loopValue");
+    ASSERT_TRUE(lua_isnil(get_lua_state(), -1));
+    test_subject.run_script("return hashString(\"TEST_STRING\")");
+    ASSERT_EQ(ST::hash_string("TEST_STRING"), lua_tointeger(get_lua_state(), -1));
+}
+
+TEST_F(lua_backend_test, test_level_globals_do_not_replace_shared_ones){
+    //Set up
+    test_subject.run_script("hashString = 500");
+    test_subject.run_script("return hashString");
+    ASSERT_EQ(500, lua_tointeger(get_lua_state(), -1));
+
+    //Test
+    test_subject.start_level();
+
+    //Check results
+    test_subject.run_script("return hashString(\"TEST_STRING\")");
+    ASSERT_EQ(ST::hash_string("TEST_STRING"), lua_tointeger(get_lua_state(), -1));
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
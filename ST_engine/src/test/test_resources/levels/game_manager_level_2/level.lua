@@ -0,0 +1 @@
+print("game_manager_level_2 started")
@@ -18,6 +18,7 @@
 #include <SDL_image.h>
 #include <iostream>
 #include <sstream>
+#include <string_view>
 #include <ST_util/string_util.hpp>
 #include <ST_util/bytell_hash_map.hpp>
 
@@ -30,20 +31,126 @@ namespace ST {
         MP3,
         BIN,
         WEBP,
-        UNKNOWN
+        UNKNOWN,
+        TEXTURE //A pre-decoded image, only found inside packs
     };
 
-        ///This struct contains assets just like the regular ST::assets, except it uses asset names as keys instead of hashes.
+    enum class pack_compression : uint8_t {
+        NONE,
+        LZ4,
+        ZSTD,
+        RLE
+    };
+
+    ///How images are stored when packing them.
+    enum class texture_packing : uint8_t {
+        NONE, //Keep the encoded png/webp file
+        RAW, //Pre-decoded pixels
+        RLE, //Pre-decoded pixels, run length encoded
+        LZ4 //Pre-decoded pixels, LZ4 compressed
+    };
+
+    ///The pixel format pre-decoded textures are stored in - the native texture format of the SDL renderers.
+    constexpr uint32_t texture_pixel_format = SDL_PIXELFORMAT_ARGB8888;
+
+    ///Placed before the pixels of a pre-decoded texture in a pack.
+    struct texture_header{
+        uint32_t width;
+        uint32_t height;
+        uint32_t pixel_format;
+        uint32_t pitch;
+    };
+    static_assert(sizeof(texture_header) == 16, "The texture header must be exactly 16 bytes");
+
+    ///The current version of the binary pack format.
+    constexpr uint16_t pack_version = 2;
+
+    ///The compression level used when none is given - LZ4 for assets that are not already compressed.
+    constexpr uint8_t default_compression_level = 1;
+
+    ///Every entry in a pack starts at an offset that is a multiple of this.
+    constexpr uint16_t pack_alignment = 16;
+
+    /**
+     * Get how many table of contents slots to reserve when writing a pack.
+     * The free slots let assets be added to the pack later without rewriting it.
+     * @param entry_count The number of assets in the pack.
+     * @return The number of slots.
+     */
+    constexpr uint32_t pack_toc_capacity(uint32_t entry_count){
+        return entry_count + (entry_count / 4 > 16 ? entry_count / 4 : 16);
+    }
+
+    ///Fixed size header at the very start of a v2 pack.
+    struct pack_header{
+        char magic[4]; //Always "STPK"
+        uint16_t version;
+        uint16_t alignment;
+        uint32_t entry_count;
+        uint32_t toc_capacity; //Number of table of contents slots reserved in the file, never less than entry_count
+        uint64_t toc_offset;
+        uint64_t names_offset;
+    };
+    static_assert(sizeof(pack_header) == 32, "The pack header must be exactly 32 bytes");
+
+    ///An entry in the table of contents of a v2 pack. The table of contents is sorted by name_hash.
+    struct pack_entry{
+        uint64_t name_hash;
+        uint64_t offset;
+        uint32_t size; //The size of the data stored in the pack
+        uint32_t original_size; //The size of the data once decompressed
+        uint32_t name_offset; //Offset of the name in the names table
+        uint16_t name_length;
+        asset_file_type type;
+        pack_compression compression;
+    };
+    static_assert(sizeof(pack_entry) == 32, "A pack entry must be exactly 32 bytes");
+
+    ///A read only, memory mapped v2 pack.
+    struct pack{
+        const char* data = nullptr;
+        uint64_t size = 0;
+        const pack_header* header = nullptr;
+        const pack_entry* entries = nullptr;
+        const char* names = nullptr;
+    };
+
+    ///This struct contains assets just like the regular ST::assets, except it uses asset names as keys instead of hashes.
     struct assets_named{
         ska::bytell_hash_map<std::string, SDL_Surface*> surfaces;
         ska::bytell_hash_map<std::string, Mix_Chunk*> chunks;
         ska::bytell_hash_map<std::string, Mix_Music*> music;
     };
 
+    /**
+     * Hashes the name of an asset for the table of contents of a pack using 64 bit FNV-1a.
+     * @param name The name of the asset (without the path).
+     * @return The hash of the name.
+     */
+    constexpr uint64_t pack_name_hash(std::string_view name){
+        uint64_t hash = 14695981039346656037ULL;
+        for(char c : name){
+            hash ^= static_cast<uint8_t>(c);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    ST::pack* open_pack(const std::string &path);
+    void close_pack(ST::pack* pack);
+    const ST::pack_entry* find_pack_entry(const ST::pack* pack, uint64_t name_hash);
+    std::string get_pack_entry_name(const ST::pack* pack, const ST::pack_entry* entry);
+    int8_t unpack_pack_entry(const ST::pack* pack, const ST::pack_entry* entry, ST::assets_named* assets);
     ST::assets_named* unpack_binary(const std::string &path);
-    int8_t pack_to_binary(const std::string &path, const std::vector<std::string>& args);
+    int8_t pack_to_binary(const std::string &path, const std::vector<std::string>& args, uint8_t compression_level = default_compression_level,
+                          texture_packing textures = texture_packing::NONE);
+    int8_t rebuild_binary(const std::string &binary, const std::vector<std::string>& args, uint8_t compression_level = default_compression_level,
+                          texture_packing textures = texture_packing::NONE);
     int8_t unpack_binary_to_disk(const std::string &path);
     asset_file_type get_file_extension(const std::string &filename);
-    int8_t add_to_binary(const std::string &binary_name, const std::vector<std::string>& args_);
+    int8_t add_to_binary(const std::string &binary_name, const std::vector<std::string>& args_, uint8_t compression_level = default_compression_level,
+                         texture_packing textures = texture_packing::NONE);
+    ST::pack_compression get_pack_compression(ST::asset_file_type type, uint8_t level);
+    bool is_pack_compression_supported(ST::pack_compression compression);
 }
 #endif
\ No newline at end of file
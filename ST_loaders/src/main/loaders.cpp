@@ -8,8 +8,76 @@
  */
 
 #include <string>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <ST_loaders/loaders.hpp>
 
+//the codecs are optional, ST_LOADERS_LZ4 and ST_LOADERS_ZSTD are defined when the libraries are found
+#ifdef ST_LOADERS_LZ4
+#include <lz4.h>
+#endif
+#ifdef ST_LOADERS_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef _MSC_VER
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+///An asset inside a pack (or one waiting to be written to a pack).
+struct pack_item{
+    std::string name;
+    ST::asset_file_type type = ST::asset_file_type::UNKNOWN;
+    const char* data = nullptr;
+    uint32_t size = 0;
+    uint32_t original_size = 0;
+    ST::pack_compression compression = ST::pack_compression::NONE;
+    bool owns_data = false;
+};
+
+///A file waiting to be written to a pack. Files are read and compressed by the worker threads of write_pack_jobs.
+struct pack_job{
+    std::string path; //Empty if the item is already in memory, i.e. copied from an existing pack
+    pack_item item;
+    const pack_item* previous = nullptr; //The same asset in the pack being rebuilt, used if the file hasn't changed
+    uint64_t previous_hash = 0;
+    uint64_t content_hash = 0;
+    bool failed = false;
+    bool done = false;
+};
+
+///What an asset in a pack was built from. Saved to "<pack>.manifest" so unchanged files are not compressed again.
+struct manifest_entry{
+    uint64_t content_hash = 0;
+    uint32_t size = 0; //The size of the asset in the pack
+    uint8_t level = 0;
+    ST::texture_packing textures = ST::texture_packing::NONE;
+};
+
+typedef ska::bytell_hash_map<std::string, manifest_entry> pack_manifest;
+
+///Written over the magic of a pack while assets are appended to it, so a pack left half written is never read.
+static const char incomplete_pack_magic[4] = {'S', 'T', 'P', 'U'};
+
+///Assets are decompressed into this buffer before decoding, it only ever grows so it is allocated once per thread.
+static thread_local std::vector<char> decompression_buffer;
+
+///The contents of an opened pack - either a memory mapped v2 pack or a v0.9 pack read into memory.
+struct pack_contents{
+    ST::pack* pack = nullptr;
+    char* legacy_buffer = nullptr;
+    std::vector<pack_item> items;
+};
+
 /**
  * Gets the file extension from the filename.
  * @param filename The filename.
@@ -39,509 +107,1218 @@ ST::asset_file_type ST::get_file_extension(const std::string& filename){
 }
 
 /**
- * Packs assets to a binary.
- * Assets must be present on disk.
- * @param binary The name of the binary that is going to be created.
- * @param args The filenames of the assets to read from.
+ * Unmaps a memory mapped file.
+ * @param data The start of the mapping.
+ * @param size The size of the mapping.
  */
-int8_t ST::pack_to_binary(const std::string& binary, const std::vector<std::string>& args_){
-    FILE* file = fopen(binary.c_str(), "r+");
-    if(file != nullptr){
-        fclose(file);
-        return ST::add_to_binary(binary, args_);
-    }
-    SDL_RWops *output = SDL_RWFromFile(binary.c_str(), "a+");
+static void unmap_file(const char* data, uint64_t size){
+#ifdef _MSC_VER
+    UnmapViewOfFile(data);
+#else
+    munmap(const_cast<char*>(data), size);
+#endif
+}
 
-    std::vector<std::string> args;
+/**
+ * Opens a v2 pack by memory mapping it and validates its header and table of contents.
+ * @param path The path to the pack.
+ * @return A pointer to the opened pack, <b>nullptr</b> if the file can't be opened or is not a v2 pack.
+ */
+ST::pack* ST::open_pack(const std::string& path){
+    const char* data;
+    uint64_t size;
+#ifdef _MSC_VER
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(file == INVALID_HANDLE_VALUE){
+        return nullptr;
+    }
+    LARGE_INTEGER file_size;
+    if(!GetFileSizeEx(file, &file_size) || static_cast<uint64_t>(file_size.QuadPart) < sizeof(ST::pack_header)){
+        CloseHandle(file);
+        return nullptr;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if(mapping == nullptr){
+        return nullptr;
+    }
+    //The view keeps the mapping alive, the handle is not needed after this
+    data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    CloseHandle(mapping);
+    if(data == nullptr){
+        return nullptr;
+    }
+    size = static_cast<uint64_t>(file_size.QuadPart);
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    if(file == -1){
+        return nullptr;
+    }
+    struct stat file_stat{};
+    if(fstat(file, &file_stat) != 0 || static_cast<uint64_t>(file_stat.st_size) < sizeof(ST::pack_header)){
+        close(file);
+        return nullptr;
+    }
+    void* mapping = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if(mapping == MAP_FAILED){
+        return nullptr;
+    }
+    data = static_cast<const char*>(mapping);
+    size = static_cast<uint64_t>(file_stat.st_size);
+#endif
 
-    //ignore duplicate file names
-    for (const auto& arg : args_) {
-        if(std::find(args.begin(), args.end(), arg) == args.end()){
-            args.emplace_back(arg);
+    //Validate the header and make sure everything the table of contents points to is inside the file
+    auto header = reinterpret_cast<const ST::pack_header*>(data);
+    bool valid = memcmp(header->magic, "STPK", 4) == 0 && header->version == ST::pack_version
+            && header->entry_count <= header->toc_capacity
+            && header->toc_offset + static_cast<uint64_t>(header->toc_capacity) * sizeof(ST::pack_entry) <= size
+            && header->names_offset <= size;
+    if(valid){
+        auto entries = reinterpret_cast<const ST::pack_entry*>(data + header->toc_offset);
+        for(uint32_t i = 0; i < header->entry_count; i++){
+            if(entries[i].offset + entries[i].size > size
+            || entries[i].compression > ST::pack_compression::RLE
+            || header->names_offset + entries[i].name_offset + entries[i].name_length > size){
+                valid = false;
+                break;
+            }
         }
     }
+    if(!valid){
+        unmap_file(data, size);
+        return nullptr;
+    }
+
+    auto pack = new ST::pack();
+    pack->data = data;
+    pack->size = size;
+    pack->header = header;
+    pack->entries = reinterpret_cast<const ST::pack_entry*>(data + header->toc_offset);
+    pack->names = data + header->names_offset;
+    return pack;
+}
+
+/**
+ * Unmaps and deletes a pack opened with open_pack.
+ * @param pack The pack to close.
+ */
+void ST::close_pack(ST::pack* pack){
+    if(pack != nullptr){
+        unmap_file(pack->data, pack->size);
+        delete pack;
+    }
+}
 
-    std::vector<std::string> surfaces_names;
-    std::vector<char*> surfaces;
-    std::vector<size_t> surfaces_sizes;
+/**
+ * Finds an entry in the table of contents of a pack using a binary search.
+ * @param pack The pack to search.
+ * @param name_hash The hash of the name of the asset, see ST::pack_name_hash.
+ * @return A pointer to the entry, <b>nullptr</b> if the pack contains no such asset.
+ */
+const ST::pack_entry* ST::find_pack_entry(const ST::pack* pack, uint64_t name_hash){
+    const ST::pack_entry* begin = pack->entries;
+    const ST::pack_entry* end = pack->entries + pack->header->entry_count;
+    auto entry = std::lower_bound(begin, end, name_hash, [](const ST::pack_entry& a, uint64_t hash){
+        return a.name_hash < hash;
+    });
+    if(entry != end && entry->name_hash == name_hash){
+        return entry;
+    }
+    return nullptr;
+}
 
-    std::vector<std::string> chunks_names;
-    std::vector<char*> chunks;
-    std::vector<size_t> chunk_sizes;
+/**
+ * Get the name of an entry in a pack.
+ * @param pack The pack containing the entry.
+ * @param entry The entry.
+ * @return The name of the asset.
+ */
+std::string ST::get_pack_entry_name(const ST::pack* pack, const ST::pack_entry* entry){
+    return std::string(pack->names + entry->name_offset, entry->name_length);
+}
 
-    std::vector<std::string> music_names;
-    std::vector<char*> music;
-    std::vector<size_t> music_sizes;
+/**
+ * Get the asset an entry of a v2 pack describes.
+ * @param pack The pack containing the entry.
+ * @param entry The entry.
+ * @return The asset, pointing inside the memory mapped pack.
+ */
+static pack_item get_pack_item(const ST::pack* pack, const ST::pack_entry* entry){
+    pack_item item;
+    item.name = ST::get_pack_entry_name(pack, entry);
+    item.type = entry->type;
+    item.data = pack->data + entry->offset;
+    item.size = entry->size;
+    item.original_size = entry->original_size;
+    item.compression = entry->compression;
+    return item;
+}
 
-    //Read files
-    for (const std::string& filename : args) {
-        SDL_RWops *input = SDL_RWFromFile(filename.c_str(), "r+b");
-        if (input != nullptr) {
-            std::string h_filename = "filename:" + trim_path(filename) + "\n";
-            ST::asset_file_type ext = get_file_extension(filename);
-            if(ext == ST::asset_file_type::PNG || ext == ST::asset_file_type::WEBP) {
-                surfaces_names.emplace_back(h_filename);
-                auto temp = static_cast<char*>(malloc(static_cast<size_t>(input->size(input))));
-                input->read(input, temp, 1, static_cast<size_t>(input->size(input)));
-                surfaces.emplace_back(temp);
-                surfaces_sizes.emplace_back(static_cast<size_t>(input->size(input)));
-            }else if(ext == ST::asset_file_type::WAV) {
-                chunks_names.emplace_back(h_filename);
-                auto temp = static_cast<char*>(malloc(static_cast<size_t>(input->size(input))));
-                input->read(input, temp, 1, static_cast<size_t>(input->size(input)));
-                chunks.emplace_back(temp);
-                chunk_sizes.emplace_back(static_cast<size_t>(input->size(input)));
-            }else if(ext == ST::asset_file_type::OGG) {
-                music_names.emplace_back(h_filename);
-                auto temp = static_cast<char*>(malloc(static_cast<size_t>(input->size(input))));
-                input->read(input, temp, 1, static_cast<size_t>(input->size(input)));
-                music.emplace_back(temp);
-                music_sizes.emplace_back(static_cast<size_t>(input->size(input)));
+/**
+ * Parses the text header of a v0.9 pack.
+ * @param buffer The contents of the pack.
+ * @param size The size of the buffer.
+ * @param items Will be filled with the assets in the pack, pointing inside the buffer.
+ * @return 0 on success, -1 if the header describes more data than there is in the buffer.
+ */
+static int8_t read_legacy_header(const char* buffer, uint64_t size, std::vector<pack_item>& items){
+    std::vector<std::string> file_names;
+    std::vector<size_t> sizes;
+    std::string temp;
+    uint64_t total_num = 0;
+    uint64_t counter = 0;
+    uint64_t pointer = 0;
+    while(pointer < size){
+        char i = buffer[pointer++];
+        temp += i;
+        if (i == '\n'){
+            if (temp.find("filename:") != std::string::npos){
+                temp.pop_back();
+                ST::replace_string(temp, "filename:", "");
+                file_names.emplace_back(temp);
+                temp.clear();
+            } else if (temp.find("total:") != std::string::npos){
+                temp.pop_back();
+                ST::replace_string(temp, "total:", "");
+                std::stringstream s_stream(temp);
+                s_stream >> total_num;
+                temp.clear();
+            } else if (temp.find("size:") != std::string::npos){
+                temp.pop_back();
+                ST::replace_string(temp, "size:", "");
+                std::stringstream s_stream(temp);
+                size_t entry_size;
+                s_stream >> entry_size;
+                sizes.emplace_back(entry_size);
+                temp.clear();
+                counter++;
             }
-            input->close(input);
+            if (counter == total_num){
+                break;
+            }
+        }
+    }
+    if(sizes.size() != file_names.size()){
+        return -1;
+    }
+    for(uint64_t i = 0; i < file_names.size(); i++){
+        if(pointer + sizes[i] > size){
+            return -1;
         }
+        pack_item item;
+        item.name = file_names[i];
+        item.type = ST::get_file_extension(file_names[i]);
+        item.data = buffer + pointer;
+        item.size = static_cast<uint32_t>(sizes[i]);
+        item.original_size = item.size;
+        items.emplace_back(item);
+        pointer += sizes[i];
     }
+    return 0;
+}
 
-    //Package into a single file
+/**
+ * Opens a pack of any supported version and lists its contents.
+ * v2 packs are memory mapped, v0.9 packs are read into memory.
+ * @param path The path to the pack.
+ * @param contents Will be filled with the contents of the pack, must be freed with close_pack_contents.
+ * @return 0 on success, -1 on failure.
+ */
+static int8_t open_pack_contents(const std::string& path, pack_contents& contents){
+    contents.pack = ST::open_pack(path);
+    if(contents.pack != nullptr){
+        for(uint32_t i = 0; i < contents.pack->header->entry_count; i++){
+            contents.items.emplace_back(get_pack_item(contents.pack, &contents.pack->entries[i]));
+        }
+        return 0;
+    }
 
-    //write our header===
+    //Not a v2 pack, try reading it as v0.9
+    SDL_RWops *input = SDL_RWFromFile(path.c_str(), "rb");
+    if(input == nullptr){
+        return -1;
+    }
+    auto size = static_cast<uint64_t>(input->size(input));
+    contents.legacy_buffer = static_cast<char*>(malloc(size));
+    size_t read = input->read(input, contents.legacy_buffer, 1, size);
+    input->close(input);
+    if(read >= sizeof(incomplete_pack_magic) && memcmp(contents.legacy_buffer, incomplete_pack_magic, sizeof(incomplete_pack_magic)) == 0){
+        //it would parse as an empty v0.9 pack
+        fprintf(stderr, "%s was left half written, rebuild it from its files\n", path.c_str());
+        read = 0;
+    }
+    if(read == 0 || read_legacy_header(contents.legacy_buffer, read, contents.items) != 0){
+        free(contents.legacy_buffer);
+        contents.legacy_buffer = nullptr;
+        contents.items.clear();
+        return -1;
+    }
+    return 0;
+}
 
-    //total number of assets
-    uint64_t total_size = surfaces_names.size() + music_names.size() + chunks_names.size();
-    std::string total_num = "total:" + std::to_string(total_size) + "\n";
-    output->write(output, total_num.c_str(), 1, total_num.size());
+/**
+ * Closes a pack opened with open_pack_contents.
+ * @param contents The contents of the pack.
+ */
+static void close_pack_contents(pack_contents& contents){
+    ST::close_pack(contents.pack);
+    free(contents.legacy_buffer);
+    contents.pack = nullptr;
+    contents.legacy_buffer = nullptr;
+    contents.items.clear();
+}
 
-    //Names and sizes for surfaces, chunks and music
-    for(uint64_t i = 0; i < surfaces_sizes.size(); i++) {
-        output->write(output, surfaces_names[i].c_str(), 1, surfaces_names[i].size());
-        std::string size = "size:" + std::to_string(surfaces_sizes[i]) + "\n";
-        output->write(output, size.c_str(), 1, size.size());
+/**
+ * Decodes an image and stores it as a pre-decoded texture - a ST::texture_header followed by the pixels.
+ * @param data The encoded image.
+ * @param size The size of the encoded image.
+ * @param item The pack item to store the texture in.
+ * @return 0 on success, -1 if the image can't be decoded.
+ */
+static int8_t read_texture_item(const char* data, uint32_t size, pack_item& item){
+    SDL_Surface* image = IMG_Load_RW(SDL_RWFromConstMem(data, static_cast<int>(size)), 1);
+    if(image == nullptr){
+        return -1;
+    }
+    SDL_Surface* converted = SDL_ConvertSurfaceFormat(image, ST::texture_pixel_format, 0);
+    SDL_FreeSurface(image);
+    if(converted == nullptr){
+        return -1;
+    }
+    ST::texture_header header{};
+    header.width = static_cast<uint32_t>(converted->w);
+    header.height = static_cast<uint32_t>(converted->h);
+    header.pixel_format = ST::texture_pixel_format;
+    header.pitch = header.width * 4;
+    uint64_t texture_size = sizeof(ST::texture_header) + static_cast<uint64_t>(header.pitch) * header.height;
+    if(texture_size > UINT32_MAX){
+        SDL_FreeSurface(converted);
+        return -1;
     }
+    auto texture = static_cast<char*>(malloc(texture_size));
+    memcpy(texture, &header, sizeof(ST::texture_header));
+    SDL_LockSurface(converted);
+    for(uint32_t row = 0; row < header.height; row++){
+        memcpy(texture + sizeof(ST::texture_header) + row * header.pitch,
+               static_cast<char*>(converted->pixels) + row * converted->pitch, header.pitch);
+    }
+    SDL_UnlockSurface(converted);
+    SDL_FreeSurface(converted);
+
+    item.type = ST::asset_file_type::TEXTURE;
+    item.data = texture;
+    item.size = static_cast<uint32_t>(texture_size);
+    item.original_size = item.size;
+    item.owns_data = true;
+    return 0;
+}
 
-    for(uint64_t i = 0; i < chunk_sizes.size(); i++) {
-        output->write(output, chunks_names[i].c_str(), 1, chunks_names[i].size());
-        std::string size = "size:" + std::to_string(chunk_sizes[i]) + "\n";
-        output->write(output, size.c_str(), 1, size.size());
+/**
+ * Lists the files to add to a pack, without reading them.
+ * Files that have an unsupported extension or share a name with another file are ignored.
+ * @param args The filenames of the assets.
+ * @param jobs The files to pack are added to this.
+ */
+static void get_pack_jobs(const std::vector<std::string>& args, std::vector<pack_job>& jobs){
+    ska::bytell_hash_set<std::string> names;
+    for (const std::string& filename : args) {
+        std::string name = ST::trim_path(filename);
+        ST::asset_file_type ext = ST::get_file_extension(filename);
+        if(ext != ST::asset_file_type::PNG && ext != ST::asset_file_type::WEBP
+        && ext != ST::asset_file_type::WAV && ext != ST::asset_file_type::OGG){
+            continue;
+        }
+        if(!names.insert(name).second){
+            continue;
+        }
+        pack_job job;
+        job.path = filename;
+        job.item.name = name;
+        job.item.type = ext;
+        jobs.emplace_back(job);
     }
+}
 
-    for(uint64_t i = 0; i < music_sizes.size(); i++) {
-        output->write(output, music_names[i].c_str(), 1, music_names[i].size());
-        std::string size = "size:" + std::to_string(music_sizes[i]) + "\n";
-        output->write(output, size.c_str(), 1, size.size());
+/**
+ * Hashes the contents of a file, 8 bytes at a time, to tell if it changed since it was packed.
+ * @param data The contents of the file.
+ * @param size The size of the file.
+ * @return The hash.
+ */
+static uint64_t hash_content(const char* data, uint64_t size){
+    uint64_t hash = 14695981039346656037ULL ^ size;
+    uint64_t i = 0;
+    for(; i + 8 <= size; i += 8){
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * 1099511628211ULL;
+        hash ^= hash >> 29;
+    }
+    for(; i < size; i++){
+        hash = (hash ^ static_cast<uint8_t>(data[i])) * 1099511628211ULL;
     }
+    return hash;
+}
 
-    //Write the data===
+/**
+ * Frees the data of a pack item, if it owns it.
+ * @param item The pack item.
+ */
+static void free_pack_item(pack_item& item){
+    if(item.owns_data){
+        free(const_cast<char*>(item.data));
+        item.data = nullptr;
+        item.owns_data = false;
+    }
+}
 
-    //Write image data
-    for(uint64_t i = 0; i < surfaces.size(); i++) {
-        output->write(output, surfaces[i], 1, surfaces_sizes[i]);
+/**
+ * @param compression A compression method.
+ * @return True if ST_loaders was built with the codec for it.
+ */
+bool ST::is_pack_compression_supported(ST::pack_compression compression){
+    switch(compression){
+        case ST::pack_compression::LZ4:
+#ifdef ST_LOADERS_LZ4
+            return true;
+#else
+            return false;
+#endif
+        case ST::pack_compression::ZSTD:
+#ifdef ST_LOADERS_ZSTD
+            return true;
+#else
+            return false;
+#endif
+        default:
+            return true;
     }
+}
 
-    //Write chunks data
-    for(uint64_t i = 0; i < chunks.size(); i++) {
-        output->write(output, chunks[i], 1, chunk_sizes[i]);
+/**
+ * Chooses how an asset is compressed in a pack based on its type.
+ * Formats that are already compressed (png, webp, ogg) are stored as they are. Uncompressed ones use
+ * LZ4 at level 1 for the fastest decompression and zstd at any higher level for the smallest packs.
+ * When only one of the codecs is built in it is used for every level, with neither the assets are stored as they are.
+ * @param type The type of the asset.
+ * @param level The compression level - 0 disables compression, up to ZSTD_maxCLevel().
+ * @return The compression to use.
+ */
+ST::pack_compression ST::get_pack_compression(ST::asset_file_type type, uint8_t level){
+    if(level == 0 || type != ST::asset_file_type::WAV){
+        return ST::pack_compression::NONE;
+    }
+    bool lz4 = is_pack_compression_supported(ST::pack_compression::LZ4);
+    bool zstd = is_pack_compression_supported(ST::pack_compression::ZSTD);
+    if(lz4 && (level == 1 || !zstd)){
+        return ST::pack_compression::LZ4;
     }
+    return zstd ? ST::pack_compression::ZSTD : ST::pack_compression::NONE;
+}
 
-    //Write music data
-    for(uint64_t i = 0; i < music.size(); i++) {
-        output->write(output, music[i], 1, music_sizes[i]);
+/**
+ * Run length encodes data as 32 bit words - pairs of a count and the repeated word.
+ * Pre-decoded textures compress well like this, since sprites are mostly transparent or flat colored.
+ * @param data The data, its size must be a multiple of 4.
+ * @param size The size of the data.
+ * @param encoded_size Will be set to the size of the encoded data.
+ * @return The encoded data, allocated with malloc.
+ */
+static char* rle_encode(const char* data, uint32_t size, size_t& encoded_size){
+    uint32_t words = size / 4;
+    auto encoded = static_cast<char*>(malloc(static_cast<size_t>(words) * 8 + 8));
+    encoded_size = 0;
+    uint32_t i = 0;
+    while(i < words){
+        uint32_t word;
+        memcpy(&word, data + i * 4, 4);
+        uint32_t run = 1;
+        while(i + run < words && memcmp(data + (i + run) * 4, &word, 4) == 0){
+            ++run;
+        }
+        memcpy(encoded + encoded_size, &run, 4);
+        memcpy(encoded + encoded_size + 4, &word, 4);
+        encoded_size += 8;
+        i += run;
     }
-    output->close(output);
-    return 0;
+    return encoded;
 }
 
 /**
- * Unpacks all the assets a binary contains.
- * @param path The path to the binary.
- * @return An ST:assets_named struct containing all assets in native engine format and their names, <b>nullptr</b> on error.
+ * Decodes data encoded with rle_encode.
+ * @param data The encoded data.
+ * @param size The size of the encoded data.
+ * @param output Where to decode to.
+ * @param output_size The size of the decoded data.
+ * @return 0 on success, -1 if the data is corrupted.
  */
-ST::assets_named* ST::unpack_binary(const std::string& path){
-    auto assets = new ST::assets_named();
-    SDL_RWops *input = SDL_RWFromFile(path.c_str(), "r");
-    if (input != nullptr) {
-        auto buffer = static_cast<char*>(malloc((size_t) input->size(input)));
-        size_t read = input->read(input, buffer, 1, (size_t) input->size(input));
-        if (read > 0) {
-            auto file = new std::string(buffer);
-            std::vector<std::string> file_names;
-            std::vector<size_t> sizes;
-
-            //read filename
-            std::string temp;
-            uint64_t total_num = 0;
-            uint64_t counter = 0;
-            uint64_t pointer = 0;
-            for(char i : *file){
-                pointer++;
-                temp += i;
-                if (i == '\n'){
-                    if (temp.find("filename:") != std::string::npos){
-                        temp.pop_back();
-                        replace_string(temp, "filename:", "");
-                        file_names.emplace_back(temp);
-                        temp.clear();
-                    } else if (temp.find("total:") != std::string::npos){
-                        temp.pop_back();
-                        replace_string(temp, "total:", "");
-                        std::stringstream s_stream(temp);
-                        s_stream >> total_num;
-                        temp.clear();
-                    } else if (temp.find("size:") != std::string::npos){
-                        temp.pop_back();
-                        replace_string(temp, "size:", "");
-                        std::stringstream s_stream(temp);
-                        int size;
-                        s_stream >> size;
-                        sizes.emplace_back(size);
-                        temp.clear();
-                        counter++;
-                    }
-                    if (counter == total_num){
-                        break;
-                    }
-                }
-            }
-            free(buffer);
-            input->seek(input, pointer, RW_SEEK_SET);
-            uint64_t seek = pointer;
-            uint64_t i = 0;
-            for (const std::string &filename : file_names) {
-                ST::asset_file_type ext = get_file_extension(filename);
-                if(ext == ST::asset_file_type::PNG) {
-                    seek += sizes[i];
-                    auto to_write = static_cast<char*>(malloc(sizes[i]));
-                    input->read(input, to_write, 1, sizes[i]);
-                    SDL_RWops* output = SDL_RWFromMem(to_write, static_cast<int>(sizes[i]));
-                    SDL_Surface* temp_surface = IMG_LoadPNG_RW(output);
-                    if(temp_surface != nullptr) {
-                        assets->surfaces[filename] = temp_surface;
-                    }
-                    SDL_RWclose(output);
-                    free(to_write);
-                    input->seek(input, seek, RW_SEEK_SET);
-                }else if(ext == ST::asset_file_type::WEBP) {
-                    seek += sizes[i];
-                    auto to_write = static_cast<char*>(malloc(sizes[i]));
-                    input->read(input, to_write, 1, sizes[i]);
-                    SDL_RWops* output = SDL_RWFromMem(to_write, static_cast<int>(sizes[i]));
-                    SDL_Surface* temp_surface = IMG_LoadWEBP_RW(output);
-                    if(temp_surface != nullptr) {
-                        assets->surfaces[filename] = temp_surface;
-                    }
-                    SDL_RWclose(output);
-                    free(to_write);
-                    input->seek(input, seek, RW_SEEK_SET);
-                }else if(ext == ST::asset_file_type::WAV){
-                    seek += sizes[i];
-                    auto to_write = static_cast<char*>(malloc(sizes[i]));
-                    input->read(input, to_write, 1, sizes[i]);
-                    SDL_RWops* output = SDL_RWFromMem(to_write, static_cast<int>(sizes[i]));
-                    Mix_Chunk* temp_chunk = Mix_LoadWAV_RW(output, 1);
-                    if(temp_chunk != nullptr) {
-                        assets->chunks[filename] = temp_chunk;
-                    }
-                    free(to_write);
-                    input->seek(input, seek, RW_SEEK_SET);
-                }else if(ext == ST::asset_file_type::OGG){
-                    seek += sizes[i];
-                    auto to_write = static_cast<char*>(malloc(sizes[i]));
-                    input->read(input, to_write, 1, sizes[i]);
-                    SDL_RWops* output = SDL_RWFromMem(to_write, static_cast<int>(sizes[i]));
-                    Mix_Music* temp_music = Mix_LoadMUSType_RW(output, MUS_OGG, 1);
-                    if(temp_music != nullptr) {
-                        assets->music[filename] = temp_music;
-                    }else{
-                        free(to_write);
-                    }
-                    input->seek(input, seek, RW_SEEK_SET);
-                }
-                i++;
-            }
-            delete file;
+static int8_t rle_decode(const char* data, uint32_t size, char* output, uint32_t output_size){
+    uint64_t written = 0;
+    for(uint32_t i = 0; i + 8 <= size; i += 8){
+        uint32_t run;
+        memcpy(&run, data + i, 4);
+        if(written + static_cast<uint64_t>(run) * 4 > output_size){
+            return -1;
+        }
+        for(uint32_t k = 0; k < run; k++){
+            memcpy(output + written, data + i + 4, 4);
+            written += 4;
         }
-        input->close(input);
-    } else {
-        return nullptr;
     }
-    return assets;
+    return written == output_size ? 0 : -1;
 }
 
 /**
- * Unpacks the contents of a binary to disk.
- * @param path The path to the binary.
- * @return 0 on Success, -1 on Failure.
+ * Compresses an asset read from disk.
+ * The asset is kept uncompressed if compressing it doesn't make it any smaller.
+ * @param item The pack item.
+ * @param level The compression level, see ST::get_pack_compression.
+ * @param textures How to store pre-decoded textures, used instead of the level for them.
  */
-int8_t ST::unpack_binary_to_disk(const std::string& path){
-    SDL_RWops *input = SDL_RWFromFile(path.c_str(), "r");
-    if (input != nullptr) {
-        auto buffer = static_cast<char*>(malloc(static_cast<size_t>(input->size(input))));
-        size_t read = input->read(input, buffer, 1, (size_t) input->size(input));
-        if (read > 0) {
-            auto file = new std::string(buffer);
-            std::vector<std::string> file_names;
-            std::vector<size_t> sizes;
-            //read filename
-            std::string temp;
-            uint64_t total_num = 0;
-            uint64_t counter = 0;
-            uint64_t pointer = 0;
-            for(char i : *file) {
-                pointer++;
-                temp += i;
-                if (i == '\n') {
-                    if (temp.find("filename:") != std::string::npos){
-                        temp.pop_back();
-                        replace_string(temp, "filename:", "");
-                        file_names.emplace_back(temp);
-                        temp.clear();
-                    } else if (temp.find("total:") != std::string::npos){
-                        temp.pop_back();
-                        replace_string(temp, "total:", "");
-                        std::stringstream s_stream(temp);
-                        s_stream >> total_num;
-                        temp.clear();
-                    } else if (temp.find("size:") != std::string::npos) {
-                        temp.pop_back();
-                        replace_string(temp, "size:", "");
-                        std::stringstream s_stream(temp);
-                        int size;
-                        s_stream >> size;
-                        sizes.emplace_back(size);
-                        temp.clear();
-                        counter++;
-                    }
-                    if (counter == total_num) {
-                        break;
-                    }
-                }
-            }
-            free(buffer);
-
-            input->seek(input, pointer, RW_SEEK_SET);
-            uint64_t seek = pointer;
-            uint64_t i = 0;
-            for (const std::string &filename : file_names) {
-                ST::asset_file_type ext = get_file_extension(filename);
-                if(ext == ST::asset_file_type::PNG || ext == ST::asset_file_type::WEBP
-                || ext == ST::asset_file_type::WAV || ext == ST::asset_file_type::OGG) {
-                    SDL_RWops *output = SDL_RWFromFile(filename.c_str(), "w");
-                    seek += sizes[i];
-                    auto to_write = static_cast<char*>(malloc(sizes[i]));
-                    input->read(input, to_write, 1, sizes[i]);
-                    output->write(output, to_write, 1, sizes[i]);
-                    output->close(output);
-                    free(to_write);
-                    input->seek(input, seek, RW_SEEK_SET);
-                }else{
-                    return -1;
-                }
-                i++;
-            }
-            delete file;
+static void compress_pack_item(pack_item& item, uint8_t level, ST::texture_packing textures){
+    ST::pack_compression compression = ST::get_pack_compression(item.type, level);
+    if(item.type == ST::asset_file_type::TEXTURE){
+        if(textures == ST::texture_packing::RLE){
+            compression = ST::pack_compression::RLE;
+        }else if(textures == ST::texture_packing::LZ4){
+            //run length encoding is the fallback when LZ4 isn't built in
+            compression = is_pack_compression_supported(ST::pack_compression::LZ4) ? ST::pack_compression::LZ4
+                                                                                  : ST::pack_compression::RLE;
         }
-        input->close(input);
-    } else{
-        return -1;
     }
-    return 0;
+    if(!item.owns_data || item.compression != ST::pack_compression::NONE || compression == ST::pack_compression::NONE){
+        return;
+    }
+    size_t compressed_size = 0;
+    char* compressed = nullptr;
+    if(compression == ST::pack_compression::LZ4){
+#ifdef ST_LOADERS_LZ4
+        int bound = LZ4_compressBound(static_cast<int>(item.size));
+        compressed = static_cast<char*>(malloc(static_cast<size_t>(bound)));
+        int result = LZ4_compress_default(item.data, compressed, static_cast<int>(item.size), bound);
+        compressed_size = result > 0 ? static_cast<size_t>(result) : 0;
+#endif
+    }else if(compression == ST::pack_compression::ZSTD){
+#ifdef ST_LOADERS_ZSTD
+        size_t bound = ZSTD_compressBound(item.size);
+        compressed = static_cast<char*>(malloc(bound));
+        size_t result = ZSTD_compress(compressed, bound, item.data, item.size, std::min<int>(level, ZSTD_maxCLevel()));
+        compressed_size = ZSTD_isError(result) ? 0 : result;
+#endif
+    }else if(compression == ST::pack_compression::RLE){
+        compressed = rle_encode(item.data, item.size, compressed_size);
+    }
+    if(compressed_size > 0 && compressed_size < item.size){
+        free(const_cast<char*>(item.data));
+        item.data = compressed;
+        item.size = static_cast<uint32_t>(compressed_size);
+        item.compression = compression;
+    }else{
+        free(compressed);
+    }
 }
 
+/**
+ * Reads a file to pack from disk and compresses it.
+ * If the file hasn't changed since it was last packed, the previously packed asset is used instead.
+ * Called from the worker threads of write_pack_jobs.
+ * @param job The file to read.
+ * @param level The compression level, see ST::get_pack_compression.
+ * @param textures Whether to store images pre-decoded and how to compress them.
+ */
+static void load_pack_job(pack_job& job, uint8_t level, ST::texture_packing textures){
+    if(job.path.empty()){
+        return;
+    }
+    SDL_RWops *input = SDL_RWFromFile(job.path.c_str(), "rb");
+    if(input == nullptr){
+        job.failed = true;
+        return;
+    }
+    auto size = static_cast<uint64_t>(input->size(input));
+    char* data = nullptr;
+    if(size <= UINT32_MAX){
+        data = static_cast<char*>(malloc(size));
+        if(input->read(input, data, 1, size) != size){
+            free(data);
+            data = nullptr;
+        }
+    }
+    input->close(input);
+    if(data == nullptr){
+        job.failed = true;
+        return;
+    }
+
+    job.content_hash = hash_content(data, size);
+    if(job.previous != nullptr && job.previous_hash == job.content_hash){
+        free(data);
+        job.item = *job.previous;
+        return;
+    }
+    job.previous = nullptr;
+
+    if(textures != ST::texture_packing::NONE && (job.item.type == ST::asset_file_type::PNG || job.item.type == ST::asset_file_type::WEBP)){
+        int8_t result = read_texture_item(data, static_cast<uint32_t>(size), job.item);
+        free(data);
+        if(result != 0){
+            job.failed = true;
+            return;
+        }
+    }else{
+        job.item.data = data;
+        job.item.size = static_cast<uint32_t>(size);
+        job.item.original_size = job.item.size;
+        job.item.owns_data = true;
+    }
+    compress_pack_item(job.item, level, textures);
+}
 
 /**
- * 
- * @param binary_name The name of the already existing binary.
- * @param args_ The new files to add to it.
- * @return -1 if the existing binary is not found. -2 if file names are clashing with the ones in the existing library. 0 on success.
- */
-int8_t ST::add_to_binary(const std::string &binary_name, const std::vector<std::string>& args_){
-
-    SDL_RWops *output = SDL_RWFromFile(binary_name.c_str(), "r+");
-
-    std::vector<std::string> args;
-
-    //ignore duplicate file names
-    for (const auto& arg : args_) {
-        if(std::find(args.begin(), args.end(), arg) == args.end()){
-            args.emplace_back(arg);
-        }
-    }
-
-    //Read in the old header first
-    std::vector<std::string> old_header_file_names;
-    std::vector<size_t> old_header_sizes;
-    uint64_t old_header_total_num = 0;
-    uint64_t seek = 0;
-
-    if (output != nullptr) {
-        auto buffer = static_cast<char*>(malloc(static_cast<size_t>(output->size(output))));
-        size_t read = output->read(output, buffer, 1, (size_t) output->size(output));
-        if (read > 0) {
-            auto file = new std::string(buffer);
-            //read filename
-            std::string temp;
-            uint64_t counter = 0;
-            uint64_t pointer = 0;
-            for (char i : *file) {
-                pointer++;
-                temp += i;
-                if (i == '\n') {
-                    if (temp.find("filename:") != std::string::npos) {
-                        temp.pop_back();
-                        replace_string(temp, "filename:", "");
-                        old_header_file_names.emplace_back(temp);
-                        temp.clear();
-                    } else if (temp.find("total:") != std::string::npos) {
-                        temp.pop_back();
-                        replace_string(temp, "total:", "");
-                        std::stringstream s_stream(temp);
-                        s_stream >> old_header_total_num;
-                        temp.clear();
-                    } else if (temp.find("size:") != std::string::npos) {
-                        temp.pop_back();
-                        replace_string(temp, "size:", "");
-                        std::stringstream s_stream(temp);
-                        int size;
-                        s_stream >> size;
-                        old_header_sizes.emplace_back(size);
-                        temp.clear();
-                        counter++;
-                    }
-                    if (counter == old_header_total_num) {
-                        break;
+ * Get the uncompressed data of an asset.
+ * Compressed assets are decompressed into a buffer that is reused between calls on the same thread, so the
+ * returned data is only valid until the next call.
+ * @param item The asset.
+ * @return The uncompressed data (item.original_size bytes), <b>nullptr</b> if the data is corrupted or its codec
+ * isn't built in.
+ */
+static const char* get_uncompressed_data(const pack_item& item){
+    if(item.compression == ST::pack_compression::NONE){
+        return item.data;
+    }
+    if(decompression_buffer.size() < item.original_size){
+        decompression_buffer.resize(item.original_size);
+    }
+    if(!ST::is_pack_compression_supported(item.compression)){
+        fprintf(stderr, "%s is compressed with a codec ST_loaders was built without\n", item.name.c_str());
+        return nullptr;
+    }
+    if(item.compression == ST::pack_compression::LZ4){
+#ifdef ST_LOADERS_LZ4
+        int result = LZ4_decompress_safe(item.data, decompression_buffer.data(), static_cast<int>(item.size), static_cast<int>(item.original_size));
+        if(result != static_cast<int>(item.original_size)){
+            return nullptr;
+        }
+#endif
+    }else if(item.compression == ST::pack_compression::ZSTD){
+#ifdef ST_LOADERS_ZSTD
+        static thread_local ZSTD_DCtx* context = ZSTD_createDCtx();
+        size_t result = ZSTD_decompressDCtx(context, decompression_buffer.data(), item.original_size, item.data, item.size);
+        if(ZSTD_isError(result) || result != item.original_size){
+            return nullptr;
+        }
+#endif
+    }else if(item.compression == ST::pack_compression::RLE){
+        if(rle_decode(item.data, item.size, decompression_buffer.data(), item.original_size) != 0){
+            return nullptr;
+        }
+    }
+    return decompression_buffer.data();
+}
+
+/**
+ * Rounds an offset up to the pack alignment.
+ * @param offset The offset.
+ * @return The aligned offset.
+ */
+static uint64_t align_offset(uint64_t offset){
+    return (offset + ST::pack_alignment - 1) / ST::pack_alignment * ST::pack_alignment;
+}
+
+/**
+ * Checks if any two assets in a pack would have the same name hash, the table of contents can't tell them apart.
+ * The names that collide are written to stderr.
+ * Assets may have the same id in the engine (see ST::hash_string()), it gives them different ids at runtime.
+ * @param names The names of the assets.
+ * @return True if two hashes are the same.
+ */
+static bool has_hash_collision(const std::vector<std::string>& names){
+    std::vector<std::pair<uint64_t, size_t>> hashes;
+    hashes.reserve(names.size());
+    for(size_t i = 0; i < names.size(); i++){
+        hashes.emplace_back(ST::pack_name_hash(names[i]), i);
+    }
+    std::sort(hashes.begin(), hashes.end());
+    bool collision = false;
+    for(size_t i = 1; i < hashes.size(); i++){
+        if(hashes[i].first == hashes[i - 1].first){
+            fprintf(stderr, "%s and %s have the same hash\n", names[hashes[i - 1].second].c_str(), names[hashes[i].second].c_str());
+            collision = true;
+        }
+    }
+    return collision;
+}
+
+/**
+ * Reads, compresses and writes the assets of a pack.
+ * Files are read and compressed in parallel by worker threads while the calling thread writes them in order.
+ * Only a few files are kept in memory at once, so the size of a pack is not limited by the available memory.
+ * @param output The pack to write to, positioned at the end of its data.
+ * @param position The current offset in the pack.
+ * @param jobs The assets to write. Assets that fail to load are skipped and marked as failed.
+ * @param level The compression level, see ST::get_pack_compression.
+ * @param textures Whether to store images pre-decoded and how to compress them.
+ * @param entries The table of contents entries of the written assets are added to this.
+ * @param names The names of the written assets are added to this.
+ * @return The offset right after the last written asset.
+ */
+static uint64_t write_pack_jobs(SDL_RWops* output, uint64_t position, std::vector<pack_job>& jobs, uint8_t level,
+                                ST::texture_packing textures, std::vector<ST::pack_entry>& entries, std::string& names){
+    std::mutex mutex;
+    std::condition_variable condition;
+    uint64_t next = 0;
+    uint64_t written = 0;
+
+    //Workers may only run a few files ahead of the writer
+    uint64_t thread_count = std::max<uint64_t>(1, std::min<uint64_t>(std::thread::hardware_concurrency(), jobs.size()));
+    uint64_t max_ahead = thread_count * 2;
+    std::vector<std::thread> workers;
+    for(uint64_t i = 0; i < thread_count; i++){
+        workers.emplace_back([&](){
+            while(true){
+                uint64_t index;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    condition.wait(lock, [&](){return next >= jobs.size() || next < written + max_ahead;});
+                    if(next >= jobs.size()){
+                        return;
                     }
+                    index = next++;
+                }
+                load_pack_job(jobs[index], level, textures);
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    jobs[index].done = true;
                 }
+                condition.notify_all();
             }
-            free(buffer);
+        });
+    }
 
-            output->seek(output, pointer, RW_SEEK_SET);
-            seek = pointer;
+    static const char padding[ST::pack_alignment] = {};
+    for(uint64_t i = 0; i < jobs.size(); i++){
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [&](){return jobs[i].done;});
         }
-    }else{
-        //If the file could not be read
-        return -1;
+        pack_item& item = jobs[i].item;
+        if(!jobs[i].failed){
+            uint64_t offset = align_offset(position);
+            output->write(output, padding, 1, offset - position);
+            output->write(output, item.data, 1, item.size);
+            ST::pack_entry entry{};
+            entry.name_hash = ST::pack_name_hash(item.name);
+            entry.offset = offset;
+            entry.size = item.size;
+            entry.original_size = item.original_size;
+            entry.name_offset = static_cast<uint32_t>(names.size());
+            entry.name_length = static_cast<uint16_t>(item.name.size());
+            entry.type = item.type;
+            entry.compression = item.compression;
+            entries.emplace_back(entry);
+            names += item.name;
+            position = offset + item.size;
+        }
+        free_pack_item(item);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            written = i + 1;
+        }
+        condition.notify_all();
+    }
+    for(auto& worker : workers){
+        worker.join();
     }
+    return position;
+}
 
-    //Check for duplicate file names inside the existing library, stop execution if any are found
-    for(const std::string& name : args){
-        for(const std::string& existing_name : old_header_file_names){
-            if(trim_path(name) == existing_name){
-                output->close(output);
-                return -2;
-            }
-        }
+/**
+ * Finishes writing a pack - writes the names table after the data, then the table of contents (sorted by name hash)
+ * and the header at the start of the file. The header is written last, as it is what makes a pack valid.
+ * @param output The pack to write to, positioned at the end of its data.
+ * @param position The current offset in the pack.
+ * @param entries The table of contents, must not be more than the capacity.
+ * @param names The names table.
+ * @param toc_capacity The number of table of contents slots reserved at the start of the pack.
+ */
+static void write_pack_index(SDL_RWops* output, uint64_t position, std::vector<ST::pack_entry>& entries,
+                             const std::string& names, uint32_t toc_capacity){
+    output->write(output, names.data(), 1, names.size());
+    std::sort(entries.begin(), entries.end(), [](const ST::pack_entry& a, const ST::pack_entry& b){
+        return a.name_hash < b.name_hash;
+    });
+
+    ST::pack_header header{};
+    memcpy(header.magic, "STPK", 4);
+    header.version = ST::pack_version;
+    header.alignment = ST::pack_alignment;
+    header.entry_count = static_cast<uint32_t>(entries.size());
+    header.toc_capacity = toc_capacity;
+    header.toc_offset = sizeof(ST::pack_header);
+    header.names_offset = position;
+    if(!entries.empty()) {
+        output->seek(output, static_cast<Sint64>(header.toc_offset), RW_SEEK_SET);
+        output->write(output, entries.data(), sizeof(ST::pack_entry), entries.size());
     }
+    output->seek(output, 0, RW_SEEK_SET);
+    output->write(output, &header, sizeof(ST::pack_header), 1);
+}
 
+/**
+ * Writes a v2 pack to disk.
+ * The file starts with a ST::pack_header, followed by the table of contents (sorted by name hash) with some
+ * free slots, the data of each asset, aligned to ST::pack_alignment, and finally the names table.
+ * @param path The path of the pack to write.
+ * @param jobs The assets to write.
+ * @param level The compression level for assets read from disk, see ST::get_pack_compression.
+ * @param textures Whether to store images read from disk pre-decoded and how to compress them.
+ * @return 0 on success, -1 if the file can't be created, -3 if two asset names have the same hash.
+ */
+static int8_t write_pack(const std::string& path, std::vector<pack_job>& jobs, uint8_t level, ST::texture_packing textures){
+    std::vector<std::string> asset_names;
+    for(const auto& job : jobs){
+        asset_names.emplace_back(job.item.name);
+    }
+    if(has_hash_collision(asset_names)){
+        return -3;
+    }
 
-    //Save the old binary data
-    size_t old_binary_data_size = output->size(output) - seek;
-    auto buffer = static_cast<char*>(malloc(static_cast<size_t>(old_binary_data_size)));
-    output->read(output, buffer, 1, old_binary_data_size);
+    SDL_RWops *output = SDL_RWFromFile(path.c_str(), "wb");
+    if(output == nullptr){
+        return -1;
+    }
 
-    //Read in new files
+    //Reserve space for the header and table of contents, they are written once the data is
+    uint32_t toc_capacity = ST::pack_toc_capacity(static_cast<uint32_t>(jobs.size()));
+    uint64_t position = sizeof(ST::pack_header) + static_cast<uint64_t>(toc_capacity) * sizeof(ST::pack_entry);
+    std::vector<char> reserved(position, 0);
+    output->write(output, reserved.data(), 1, reserved.size());
 
-    std::vector<std::string> surfaces_names;
-    std::vector<char*> surfaces;
-    std::vector<size_t> surfaces_sizes;
+    std::vector<ST::pack_entry> entries;
+    std::string names;
+    position = write_pack_jobs(output, position, jobs, level, textures, entries, names);
+    write_pack_index(output, position, entries, names, toc_capacity);
+    output->close(output);
+    return 0;
+}
 
-    std::vector<std::string> chunks_names;
-    std::vector<char*> chunks;
-    std::vector<size_t> chunk_sizes;
+/**
+ * Adds assets to the end of a v2 pack without rewriting it, using the free slots in its table of contents.
+ * The names table is always last in the file, so the new data is written over it and it is written again after.
+ * The pack is updated in place, so its magic is replaced until the new index is written. If the process stops
+ * halfway through, the pack can't be opened or added to, but rebuild_binary() can write it again from its files.
+ * @param path The path of the pack.
+ * @param contents The opened pack, it is closed before writing to it.
+ * @param jobs The assets to add.
+ * @param level The compression level, see ST::get_pack_compression.
+ * @param textures Whether to store images pre-decoded and how to compress them.
+ * @return 0 on success, -1 if the pack can't be written to, -3 if two asset names have the same hash.
+ */
+static int8_t append_to_pack(const std::string& path, pack_contents& contents, std::vector<pack_job>& jobs,
+                             uint8_t level, ST::texture_packing textures){
+    const ST::pack* pack = contents.pack;
+    std::vector<ST::pack_entry> entries(pack->entries, pack->entries + pack->header->entry_count);
+    std::vector<std::string> asset_names;
+    uint64_t names_size = 0;
+    for(const auto& entry : entries){
+        asset_names.emplace_back(ST::get_pack_entry_name(pack, &entry));
+        names_size = std::max<uint64_t>(names_size, entry.name_offset + entry.name_length);
+    }
+    for(const auto& job : jobs){
+        asset_names.emplace_back(job.item.name);
+    }
+    if(has_hash_collision(asset_names)){
+        return -3;
+    }
+    std::string names(pack->names, names_size);
+    uint64_t position = pack->header->names_offset;
+    uint32_t toc_capacity = pack->header->toc_capacity;
+    close_pack_contents(contents);
 
-    std::vector<std::string> music_names;
-    std::vector<char*> music;
-    std::vector<size_t> music_sizes;
+    SDL_RWops *output = SDL_RWFromFile(path.c_str(), "r+b");
+    if(output == nullptr){
+        return -1;
+    }
+    output->write(output, incomplete_pack_magic, 1, sizeof(incomplete_pack_magic));
+    output->seek(output, static_cast<Sint64>(position), RW_SEEK_SET);
+    position = write_pack_jobs(output, position, jobs, level, textures, entries, names);
+    write_pack_index(output, position, entries, names, toc_capacity);
+    output->close(output);
+    return 0;
+}
 
-    for (const std::string& filename : args) {
-        SDL_RWops *input = SDL_RWFromFile(filename.c_str(), "r+b");
-        if (input != nullptr) {
-            std::string h_filename = "filename:" + trim_path(filename) + "\n";
-            ST::asset_file_type ext = get_file_extension(filename);
-            if(ext == ST::asset_file_type::PNG || ext == ST::asset_file_type::WEBP) {
-                surfaces_names.emplace_back(h_filename);
-                auto temp = static_cast<char*>(malloc(static_cast<size_t>(input->size(input))));
-                input->read(input, temp, 1, static_cast<size_t>(input->size(input)));
-                surfaces.emplace_back(temp);
-                surfaces_sizes.emplace_back(static_cast<size_t>(input->size(input)));
-            }else if(ext == ST::asset_file_type::WAV) {
-                chunks_names.emplace_back(h_filename);
-                auto temp = static_cast<char*>(malloc(static_cast<size_t>(input->size(input))));
-                input->read(input, temp, 1, static_cast<size_t>(input->size(input)));
-                chunks.emplace_back(temp);
-                chunk_sizes.emplace_back(static_cast<size_t>(input->size(input)));
-            }else if(ext == ST::asset_file_type::OGG) {
-                music_names.emplace_back(h_filename);
-                auto temp = static_cast<char*>(malloc(static_cast<size_t>(input->size(input))));
-                input->read(input, temp, 1, static_cast<size_t>(input->size(input)));
-                music.emplace_back(temp);
-                music_sizes.emplace_back(static_cast<size_t>(input->size(input)));
-            }
-            input->close(input);
+/**
+ * Reads the manifest of a pack.
+ * Each line is the content hash (hex), the size in the pack, the compression level, the texture packing and the name.
+ * @param binary The path of the pack.
+ * @param manifest Filled with the manifest, left empty if there is none.
+ */
+static void read_manifest(const std::string& binary, pack_manifest& manifest){
+    std::ifstream input(binary + ".manifest");
+    std::string line;
+    while(std::getline(input, line)){
+        std::stringstream s_stream(line);
+        manifest_entry entry;
+        uint32_t level = 0;
+        uint32_t textures = 0;
+        std::string name;
+        s_stream >> std::hex >> entry.content_hash >> std::dec >> entry.size >> level >> textures;
+        if(s_stream.fail() || level > UINT8_MAX || textures > static_cast<uint32_t>(ST::texture_packing::LZ4)){
+            continue;
+        }
+        s_stream.get();
+        std::getline(s_stream, name);
+        if(!name.empty()){
+            entry.level = static_cast<uint8_t>(level);
+            entry.textures = static_cast<ST::texture_packing>(textures);
+            manifest[name] = entry;
         }
     }
+}
 
-    //Package into a single file
+/**
+ * Writes the manifest of a pack, see read_manifest.
+ * @param binary The path of the pack.
+ * @param manifest The manifest.
+ */
+static void write_manifest(const std::string& binary, const pack_manifest& manifest){
+    std::ofstream output(binary + ".manifest", std::ios::trunc);
+    for(const auto& it : manifest){
+        output << std::hex << it.second.content_hash << std::dec << ' ' << it.second.size << ' '
+               << static_cast<uint32_t>(it.second.level) << ' ' << static_cast<uint32_t>(it.second.textures)
+               << ' ' << it.first << '\n';
+    }
+}
 
-    //write our header==================================================
+/**
+ * Adds the files written to a pack to its manifest.
+ * @param manifest The manifest.
+ * @param jobs The written assets, ones that were not read from disk are ignored.
+ * @param level The compression level they were written with.
+ * @param textures The texture packing they were written with.
+ */
+static void add_to_manifest(pack_manifest& manifest, const std::vector<pack_job>& jobs, uint8_t level, ST::texture_packing textures){
+    for(const auto& job : jobs){
+        if(!job.failed && !job.path.empty()){
+            manifest_entry entry;
+            entry.content_hash = job.content_hash;
+            entry.size = job.item.size;
+            entry.level = level;
+            entry.textures = textures;
+            manifest[job.item.name] = entry;
+        }
+    }
+}
 
-    //Delete old binary and create a new one
-    output->close(output);
-    output = SDL_RWFromFile(binary_name.c_str(), "w+");
+/**
+ * Replaces a binary with a newly written one.
+ * @param binary_name The binary.
+ * @param temp_name The new binary.
+ * @return 0 on success, -1 on failure.
+ */
+static int8_t replace_binary(const std::string& binary_name, const std::string& temp_name){
+    remove(binary_name.c_str());
+    if(rename(temp_name.c_str(), binary_name.c_str()) != 0){
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Packs assets to a binary.
+ * Assets must be present on disk. A manifest of the packed files is written next to the binary.
+ * @param binary The name of the binary that is going to be created.
+ * @param args The filenames of the assets to read from.
+ * @param compression_level The compression level, see ST::get_pack_compression.
+ * @param textures Whether to store images pre-decoded and how to compress them.
+ * @return 0 on success, -1 on failure, -2 and -3 as described in add_to_binary and write_pack.
+ */
+int8_t ST::pack_to_binary(const std::string& binary, const std::vector<std::string>& args, uint8_t compression_level, ST::texture_packing textures){
+    FILE* file = fopen(binary.c_str(), "r+");
+    if(file != nullptr){
+        fclose(file);
+        return ST::add_to_binary(binary, args, compression_level, textures);
+    }
 
-    //Write the new total
-    uint64_t total_size = surfaces_names.size() + music_names.size() + chunks_names.size();
-    std::string total_num = "total:" + std::to_string(total_size+old_header_total_num) + "\n";
-    output->write(output, total_num.c_str(), 1, total_num.size());
+    std::vector<pack_job> jobs;
+    get_pack_jobs(args, jobs);
+    int8_t result = write_pack(binary, jobs, compression_level, textures);
+    if(result == 0){
+        pack_manifest manifest;
+        add_to_manifest(manifest, jobs, compression_level, textures);
+        write_manifest(binary, manifest);
+    }
+    return result;
+}
 
-    //The old data gets written first
-    for(uint64_t i = 0; i < old_header_file_names.size(); i++) {
-        std::string h_filename = "filename:" + old_header_file_names[i] + "\n";
-        output->write(output, h_filename.c_str(), 1, h_filename.size());
-        std::string size = "size:" + std::to_string(old_header_sizes[i]) + "\n";
-        output->write(output, size.c_str(), 1, size.size());
+/**
+ * Rebuilds a binary so it contains exactly the given assets.
+ * Files that haven't changed since they were packed with the same settings (according to the manifest next to the
+ * binary) are copied from the existing binary instead of being compressed again.
+ * Creates the binary if it doesn't exist.
+ * @param binary The name of the binary.
+ * @param args The filenames of the assets to read from.
+ * @param compression_level The compression level, see ST::get_pack_compression.
+ * @param textures Whether to store images pre-decoded and how to compress them.
+ * @return 0 on success, -1 on failure, -3 if two file names have the same hash.
+ */
+int8_t ST::rebuild_binary(const std::string& binary, const std::vector<std::string>& args, uint8_t compression_level, ST::texture_packing textures){
+    pack_contents contents;
+    pack_manifest manifest;
+    if(open_pack_contents(binary, contents) == 0){
+        read_manifest(binary, manifest);
     }
 
-    //And now the new files =============================================
+    std::vector<pack_job> jobs;
+    get_pack_jobs(args, jobs);
+    ska::bytell_hash_map<std::string, const pack_item*> previous_items;
+    for(const auto& item : contents.items){
+        previous_items[item.name] = &item;
+    }
+    for(auto& job : jobs){
+        auto entry = manifest.find(job.item.name);
+        auto previous = previous_items.find(job.item.name);
+        if(entry != manifest.end() && previous != previous_items.end() && entry->second.level == compression_level
+        && entry->second.textures == textures && entry->second.size == previous->second->size){
+            job.previous = previous->second;
+            job.previous_hash = entry->second.content_hash;
+        }
+    }
 
-    //Names and sizes for surfaces, chunks and music
-    for(uint64_t i = 0; i < surfaces_sizes.size(); i++) {
-        output->write(output, surfaces_names[i].c_str(), 1, surfaces_names[i].size());
-        std::string size = "size:" + std::to_string(surfaces_sizes[i]) + "\n";
-        output->write(output, size.c_str(), 1, size.size());
+    //The existing binary may be mapped, so write the new one next to it and swap them after
+    std::string temp_name = binary + ".tmp";
+    int8_t result = write_pack(temp_name, jobs, compression_level, textures);
+    close_pack_contents(contents);
+    if(result == 0){
+        result = replace_binary(binary, temp_name);
+    }else{
+        remove(temp_name.c_str());
+    }
+    if(result == 0){
+        pack_manifest new_manifest;
+        add_to_manifest(new_manifest, jobs, compression_level, textures);
+        write_manifest(binary, new_manifest);
     }
+    return result;
+}
 
-    for(uint64_t i = 0; i < chunk_sizes.size(); i++) {
-        output->write(output, chunks_names[i].c_str(), 1, chunks_names[i].size());
-        std::string size = "size:" + std::to_string(chunk_sizes[i]) + "\n";
-        output->write(output, size.c_str(), 1, size.size());
+/**
+ * Creates a surface from a pre-decoded texture, no image decoding or pixel format conversion is needed.
+ * @param data The texture - a ST::texture_header followed by the pixels.
+ * @param size The size of the data.
+ * @return The surface, <b>nullptr</b> if the texture is corrupted.
+ */
+static SDL_Surface* create_texture_surface(const char* data, uint32_t size){
+    ST::texture_header header{};
+    if(size < sizeof(ST::texture_header)){
+        return nullptr;
+    }
+    memcpy(&header, data, sizeof(ST::texture_header));
+    if(header.pitch < header.width * 4 || sizeof(ST::texture_header) + static_cast<uint64_t>(header.pitch) * header.height > size){
+        return nullptr;
+    }
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, static_cast<int>(header.width), static_cast<int>(header.height), 32, header.pixel_format);
+    if(surface == nullptr){
+        return nullptr;
     }
+    SDL_LockSurface(surface);
+    for(uint32_t row = 0; row < header.height; row++){
+        memcpy(static_cast<char*>(surface->pixels) + row * surface->pitch,
+               data + sizeof(ST::texture_header) + row * header.pitch, header.width * 4);
+    }
+    SDL_UnlockSurface(surface);
+    return surface;
+}
 
-    for(uint64_t i = 0; i < music_sizes.size(); i++) {
-        output->write(output, music_names[i].c_str(), 1, music_names[i].size());
-        std::string size = "size:" + std::to_string(music_sizes[i]) + "\n";
-        output->write(output, size.c_str(), 1, size.size());
+/**
+ * Decodes an asset from memory.
+ * Music is streamed from its source while playing, so it gets a copy of the data that lives as long as the music.
+ * @param item The asset to decode.
+ * @param assets The assets to add the decoded asset to.
+ * @return 0 on success, -1 if the asset could not be decoded.
+ */
+static int8_t decode_pack_item(const pack_item& item, ST::assets_named* assets){
+    const char* data = get_uncompressed_data(item);
+    if(data == nullptr){
+        return -1;
     }
+    int size = static_cast<int>(item.original_size);
+    if(item.type == ST::asset_file_type::TEXTURE) {
+        SDL_Surface* temp_surface = create_texture_surface(data, item.original_size);
+        if(temp_surface != nullptr) {
+            assets->surfaces[item.name] = temp_surface;
+            return 0;
+        }
+    }else if(item.type == ST::asset_file_type::PNG) {
+        SDL_RWops* input = SDL_RWFromConstMem(data, size);
+        SDL_Surface* temp_surface = IMG_LoadPNG_RW(input);
+        SDL_RWclose(input);
+        if(temp_surface != nullptr) {
+            assets->surfaces[item.name] = temp_surface;
+            return 0;
+        }
+    }else if(item.type == ST::asset_file_type::WEBP) {
+        SDL_RWops* input = SDL_RWFromConstMem(data, size);
+        SDL_Surface* temp_surface = IMG_LoadWEBP_RW(input);
+        SDL_RWclose(input);
+        if(temp_surface != nullptr) {
+            assets->surfaces[item.name] = temp_surface;
+            return 0;
+        }
+    }else if(item.type == ST::asset_file_type::WAV){
+        SDL_RWops* input = SDL_RWFromConstMem(data, size);
+        Mix_Chunk* temp_chunk = Mix_LoadWAV_RW(input, 1);
+        if(temp_chunk != nullptr) {
+            assets->chunks[item.name] = temp_chunk;
+            return 0;
+        }
+    }else if(item.type == ST::asset_file_type::OGG){
+        auto music_data = static_cast<char*>(malloc(item.original_size));
+        memcpy(music_data, data, item.original_size);
+        SDL_RWops* input = SDL_RWFromMem(music_data, size);
+        Mix_Music* temp_music = Mix_LoadMUSType_RW(input, MUS_OGG, 1);
+        if(temp_music != nullptr) {
+            assets->music[item.name] = temp_music;
+            return 0;
+        }
+        free(music_data);
+    }
+    return -1;
+}
 
-    //Write the data===
+/**
+ * Decodes a single asset from a v2 pack.
+ * @param pack The pack containing the asset.
+ * @param entry The entry of the asset, see ST::find_pack_entry.
+ * @param assets The assets to add the decoded asset to.
+ * @return 0 on success, -1 if the asset could not be decoded.
+ */
+int8_t ST::unpack_pack_entry(const ST::pack* pack, const ST::pack_entry* entry, ST::assets_named* assets){
+    return decode_pack_item(get_pack_item(pack, entry), assets);
+}
 
-    //Write the old binary data
-    output->write(output, buffer, 1, old_binary_data_size);
+/**
+ * Unpacks all the assets a binary contains.
+ * Reads both v2 and v0.9 binaries.
+ * @param path The path to the binary.
+ * @return An ST:assets_named struct containing all assets in native engine format and their names, <b>nullptr</b> on error.
+ */
+ST::assets_named* ST::unpack_binary(const std::string& path){
+    pack_contents contents;
+    if(open_pack_contents(path, contents) != 0){
+        return nullptr;
+    }
+    auto assets = new ST::assets_named();
+    for(const auto& item : contents.items){
+        decode_pack_item(item, assets);
+    }
+    close_pack_contents(contents);
+    return assets;
+}
 
-    // Write the new binary data
+/**
+ * Unpacks the contents of a binary to disk.
+ * Reads both v2 and v0.9 binaries.
+ * @param path The path to the binary.
+ * @return 0 on Success, -1 on Failure.
+ */
+int8_t ST::unpack_binary_to_disk(const std::string& path){
+    pack_contents contents;
+    if(open_pack_contents(path, contents) != 0){
+        return -1;
+    }
+    for(const auto& item : contents.items){
+        if(item.type == ST::asset_file_type::PNG || item.type == ST::asset_file_type::WEBP
+        || item.type == ST::asset_file_type::WAV || item.type == ST::asset_file_type::OGG) {
+            const char* data = get_uncompressed_data(item);
+            SDL_RWops *output = data == nullptr ? nullptr : SDL_RWFromFile(item.name.c_str(), "wb");
+            if(output == nullptr){
+                close_pack_contents(contents);
+                return -1;
+            }
+            output->write(output, data, 1, item.original_size);
+            output->close(output);
+        }else if(item.type == ST::asset_file_type::TEXTURE){
+            //Pre-decoded textures are written back as png
+            const char* data = get_uncompressed_data(item);
+            SDL_Surface* surface = data == nullptr ? nullptr : create_texture_surface(data, item.original_size);
+            if(surface == nullptr || IMG_SavePNG(surface, item.name.c_str()) != 0){
+                SDL_FreeSurface(surface);
+                close_pack_contents(contents);
+                return -1;
+            }
+            SDL_FreeSurface(surface);
+        }else{
+            close_pack_contents(contents);
+            return -1;
+        }
+    }
+    close_pack_contents(contents);
+    return 0;
+}
 
-    //Write image data
-    for(uint64_t i = 0; i < surfaces.size(); i++) {
-        output->write(output, surfaces[i], 1, surfaces_sizes[i]);
+/**
+ * Adds files to an existing binary.
+ * If the binary is v2 and has enough free slots in its table of contents, the files are appended to it in place.
+ * Otherwise it is rewritten in the v2 format, which also upgrades v0.9 binaries.
+ * @param binary_name The name of the already existing binary.
+ * @param args_ The new files to add to it.
+ * @param compression_level The compression level for the new files, see ST::get_pack_compression.
+ * @param textures Whether to store new images pre-decoded and how to compress them.
+ * @return -1 if the existing binary is not found. -2 if file names are clashing with the ones in the existing library.
+ * -3 if two file names have the same hash. 0 on success.
+ */
+int8_t ST::add_to_binary(const std::string &binary_name, const std::vector<std::string>& args_, uint8_t compression_level, ST::texture_packing textures){
+    pack_contents contents;
+    if(open_pack_contents(binary_name, contents) != 0){
+        //If the file could not be read
+        return -1;
     }
 
-    //Write chunks data
-    for(uint64_t i = 0; i < chunks.size(); i++) {
-        output->write(output, chunks[i], 1, chunk_sizes[i]);
+    //Check for duplicate file names inside the existing library, stop execution if any are found
+    for(const std::string& name : args_){
+        for(const auto& existing : contents.items){
+            if(trim_path(name) == existing.name){
+                close_pack_contents(contents);
+                return -2;
+            }
+        }
     }
 
-    //Write music data
-    for(uint64_t i = 0; i < music.size(); i++) {
-        output->write(output, music[i], 1, music_sizes[i]);
+    std::vector<pack_job> new_jobs;
+    get_pack_jobs(args_, new_jobs);
+    pack_manifest manifest;
+    read_manifest(binary_name, manifest);
+
+    int8_t result;
+    if(contents.pack != nullptr && contents.pack->header->entry_count + new_jobs.size() <= contents.pack->header->toc_capacity){
+        result = append_to_pack(binary_name, contents, new_jobs, compression_level, textures);
+        close_pack_contents(contents);
+    }else{
+        //The old data gets written first, straight from the existing binary and without recompressing it
+        std::vector<pack_job> jobs;
+        for(const auto& item : contents.items){
+            pack_job job;
+            job.item = item;
+            jobs.emplace_back(job);
+        }
+        jobs.insert(jobs.end(), new_jobs.begin(), new_jobs.end());
+
+        //The existing binary may be mapped, so write the new one next to it and swap them after
+        std::string temp_name = binary_name + ".tmp";
+        result = write_pack(temp_name, jobs, compression_level, textures);
+        close_pack_contents(contents);
+        if(result == 0){
+            result = replace_binary(binary_name, temp_name);
+        }else{
+            remove(temp_name.c_str());
+        }
+        new_jobs.assign(jobs.end() - static_cast<long>(new_jobs.size()), jobs.end());
     }
-    output->close(output);
-    return 0;
-}
\ No newline at end of file
+    if(result == 0){
+        add_to_manifest(manifest, new_jobs, compression_level, textures);
+        write_manifest(binary_name, manifest);
+    }
+    return result;
+}
@@ -11,6 +11,7 @@
 #include <ST_loaders/loaders.hpp>
 #include <ST_util/test_util.hpp>
 #include <fstream>
+#include <map>
 
 
 #ifdef _MSC_VER
@@ -58,19 +59,136 @@ TEST(loaders_tests, test_pack_to_binary){
     initialize_SDL();
     std::vector<std::string> filenames = {"test_image_1.png", "test_image_3.webp", "test_sound_1.wav", "test_music_1.ogg"};
     std::string binary_name = "result_binary";
-    ST::pack_to_binary(binary_name, filenames);
+    ST::pack_to_binary(binary_name, filenames, 0);
 
     long expected_size = get_file_size(filenames.at(0)) + get_file_size(filenames.at(1))
-            + get_file_size(filenames.at(2)) + get_file_size(filenames.at(3));
+            + get_file_size(filenames.at(2)) + get_file_size(filenames.at(3))
+            + sizeof(ST::pack_header) + ST::pack_toc_capacity(4) * sizeof(ST::pack_entry);
     long binary_size = get_file_size(binary_name);
 
     //Tear Down
     close_SDL();
     remove(binary_name.c_str());
+    remove((binary_name + ".manifest").c_str());
 
     ASSERT_NEAR(expected_size, binary_size, 200);
 }
 
+TEST(loaders_tests, test_pack_to_binary_table_of_contents){
+
+    //Set up
+    initialize_SDL();
+    std::vector<std::string> filenames = {"test_image_1.png", "test_image_3.webp", "test_sound_1.wav", "test_music_1.ogg"};
+    std::string binary_name = "result_binary";
+    ST::pack_to_binary(binary_name, filenames, 0);
+
+    //Test
+    ST::pack* result = ST::open_pack(binary_name);
+    ASSERT_TRUE(result);
+    ASSERT_EQ(ST::pack_version, result->header->version);
+    ASSERT_EQ(4, result->header->entry_count);
+    for(const std::string& filename : filenames){
+        const ST::pack_entry* entry = ST::find_pack_entry(result, ST::pack_name_hash(filename));
+        ASSERT_TRUE(entry);
+        EXPECT_EQ(filename, ST::get_pack_entry_name(result, entry));
+        EXPECT_EQ(get_file_size(filename), entry->size);
+        EXPECT_EQ(0, entry->offset % ST::pack_alignment);
+    }
+    EXPECT_FALSE(ST::find_pack_entry(result, ST::pack_name_hash("not_in_the_pack.png")));
+
+    //Tear Down
+    ST::close_pack(result);
+    close_SDL();
+    remove(binary_name.c_str());
+    remove((binary_name + ".manifest").c_str());
+}
+
+TEST(loaders_tests, test_get_pack_compression){
+    EXPECT_EQ(ST::pack_compression::NONE, ST::get_pack_compression(ST::asset_file_type::WAV, 0));
+#if defined(ST_LOADERS_LZ4) && defined(ST_LOADERS_ZSTD)
+    EXPECT_EQ(ST::pack_compression::LZ4, ST::get_pack_compression(ST::asset_file_type::WAV, 1));
+    EXPECT_EQ(ST::pack_compression::ZSTD, ST::get_pack_compression(ST::asset_file_type::WAV, 19));
+#elif defined(ST_LOADERS_LZ4)
+    EXPECT_EQ(ST::pack_compression::LZ4, ST::get_pack_compression(ST::asset_file_type::WAV, 19));
+#elif defined(ST_LOADERS_ZSTD)
+    EXPECT_EQ(ST::pack_compression::ZSTD, ST::get_pack_compression(ST::asset_file_type::WAV, 1));
+#else
+    EXPECT_EQ(ST::pack_compression::NONE, ST::get_pack_compression(ST::asset_file_type::WAV, 1));
+    EXPECT_EQ(ST::pack_compression::NONE, ST::get_pack_compression(ST::asset_file_type::WAV, 19));
+#endif
+    EXPECT_EQ(ST::pack_compression::NONE, ST::get_pack_compression(ST::asset_file_type::PNG, 19));
+    EXPECT_EQ(ST::pack_compression::NONE, ST::get_pack_compression(ST::asset_file_type::OGG, 1));
+}
+
+TEST(loaders_tests, test_unpack_compressed_binary){
+
+    //Set up
+    initialize_SDL();
+    std::vector<std::string> filenames = {"test_image_1.png", "test_sound_1.wav"};
+    Mix_Chunk* expected_chunk = Mix_LoadWAV("test_sound_1.wav");
+    ASSERT_TRUE(expected_chunk);
+
+    for(uint8_t level : {1, 19}) {
+        std::string binary_name = "result_binary";
+        ASSERT_EQ(0, ST::pack_to_binary(binary_name, filenames, level));
+
+        //Test
+        ST::assets_named* result = ST::unpack_binary(binary_name);
+        ASSERT_TRUE(result);
+        ASSERT_TRUE(result->surfaces.at("test_image_1.png"));
+        Mix_Chunk* result_chunk = result->chunks.at("test_sound_1.wav");
+        ASSERT_TRUE(result_chunk);
+        ASSERT_EQ(expected_chunk->alen, result_chunk->alen);
+        for(Uint32 i = 0; i < expected_chunk->alen; i++){
+            ASSERT_EQ(expected_chunk->abuf[i], result_chunk->abuf[i]);
+        }
+
+        SDL_FreeSurface(result->surfaces.at("test_image_1.png"));
+        Mix_FreeChunk(result_chunk);
+        delete result;
+        remove(binary_name.c_str());
+        remove((binary_name + ".manifest").c_str());
+    }
+
+    //Tear Down
+    Mix_FreeChunk(expected_chunk);
+    close_SDL();
+}
+
+TEST(loaders_tests, test_unpack_pre_decoded_textures){
+
+    //Set up
+    initialize_SDL();
+    std::vector<std::string> filenames = {"test_image_1.png"};
+    SDL_Surface* image = IMG_Load("test_image_1.png");
+    ASSERT_TRUE(image);
+    SDL_Surface* expected = SDL_ConvertSurfaceFormat(image, ST::texture_pixel_format, 0);
+    ASSERT_TRUE(expected);
+
+    for(ST::texture_packing packing : {ST::texture_packing::RAW, ST::texture_packing::RLE, ST::texture_packing::LZ4}) {
+        std::string binary_name = "result_binary";
+        ASSERT_EQ(0, ST::pack_to_binary(binary_name, filenames, ST::default_compression_level, packing));
+
+        //Test
+        ST::assets_named* result = ST::unpack_binary(binary_name);
+        ASSERT_TRUE(result);
+        SDL_Surface* result_surface = result->surfaces.at("test_image_1.png");
+        ASSERT_TRUE(result_surface);
+        ASSERT_EQ(ST::texture_pixel_format, result_surface->format->format);
+        ASSERT_TRUE(compare_surfaces(expected, result_surface));
+
+        SDL_FreeSurface(result_surface);
+        delete result;
+        remove(binary_name.c_str());
+        remove((binary_name + ".manifest").c_str());
+    }
+
+    //Tear Down
+    SDL_FreeSurface(expected);
+    SDL_FreeSurface(image);
+    close_SDL();
+}
+
 TEST(loaders_tests, test_unpack_binary_to_disk){
     //Set up
     initialize_SDL();
@@ -143,13 +261,15 @@ TEST(loaders_tests, test_ignore_identical_file_when_packing_to_binary){
     initialize_SDL();
     std::vector<std::string> filenames = {"test_image_1.png", "test_image_1.png", "test_sound_1.wav", "test_music_1.ogg"};
     std::string binary_name = "result_binary";
-    ST::pack_to_binary(binary_name, filenames);
+    ST::pack_to_binary(binary_name, filenames, 0);
 
-    long expected_size = get_file_size(filenames.at(0)) + get_file_size(filenames.at(2)) + get_file_size(filenames.at(3));
+    long expected_size = get_file_size(filenames.at(0)) + get_file_size(filenames.at(2)) + get_file_size(filenames.at(3))
+            + sizeof(ST::pack_header) + ST::pack_toc_capacity(3) * sizeof(ST::pack_entry);
     long binary_size = get_file_size(binary_name);
 
     //Tear Down
     remove(binary_name.c_str());
+    remove((binary_name + ".manifest").c_str());
     close_SDL();
 
     ASSERT_NEAR(expected_size, binary_size, 200);
@@ -173,9 +293,10 @@ TEST(loaders_tests, test_can_add_to_existing_binary){
 
     ASSERT_EQ(0, ST::add_to_binary(result_binary_name, filenames));
 
-    //Check that the filesize is about right
+    //Check that the filesize is about right - the binary is rewritten as v2, so it gains a table of contents
     long expected_size = get_file_size(filenames.at(0)) + get_file_size(filenames.at(1))
-                         + get_file_size(input_binary_name);
+                         + get_file_size(input_binary_name)
+                         + sizeof(ST::pack_header) + ST::pack_toc_capacity(9) * sizeof(ST::pack_entry);
 
     long binary_size = get_file_size(result_binary_name);
 
@@ -211,6 +332,7 @@ TEST(loaders_tests, test_can_add_to_existing_binary){
 
     close_SDL();
     remove(result_binary_name.c_str());
+    remove((result_binary_name + ".manifest").c_str());
     ASSERT_EQ(0, chdir("../"));
 }
 
@@ -258,6 +380,7 @@ TEST(loaders_tests, test_exit_when_duplicate_name_found_in_exisitng_library) {
 
     close_SDL();
     remove(result_binary_name.c_str());
+    remove((result_binary_name + ".manifest").c_str());
     ASSERT_EQ(0, chdir("../"));
 }
 
@@ -305,6 +428,7 @@ TEST(loaders_tests, test_exit_when_duplicate_name_in_different_directory_found_i
 
     close_SDL();
     remove(result_binary_name.c_str());
+    remove((result_binary_name + ".manifest").c_str());
     ASSERT_EQ(0, chdir("../"));
 }
 
@@ -331,9 +455,203 @@ TEST(loaders_tests, test_pack_to_binary_calls_add_to_binary_on_existing_file) {
     //Tear down
     close_SDL();
     remove(result_binary_name.c_str());
+    remove((result_binary_name + ".manifest").c_str());
     ASSERT_EQ(0, chdir("../"));
 }
 
+TEST(loaders_tests, test_add_to_binary_in_place) {
+
+    //Set up
+    initialize_SDL();
+    std::vector<std::string> filenames = {"test_image_1.png", "test_sound_1.wav"};
+    std::string binary_name = "result_binary";
+    ASSERT_EQ(0, ST::pack_to_binary(binary_name, filenames, 0));
+    ST::pack* pack = ST::open_pack(binary_name);
+    ASSERT_TRUE(pack);
+    uint32_t toc_capacity = pack->header->toc_capacity;
+    uint64_t image_offset = ST::find_pack_entry(pack, ST::pack_name_hash("test_image_1.png"))->offset;
+    uint64_t names_offset = pack->header->names_offset;
+    ST::close_pack(pack);
+
+    //Test - the table of contents has free slots, so the existing assets must stay where they are
+    ASSERT_EQ(0, ST::add_to_binary(binary_name, {"test_image_3.webp"}, 0));
+    pack = ST::open_pack(binary_name);
+    ASSERT_TRUE(pack);
+    ASSERT_EQ(3, pack->header->entry_count);
+    ASSERT_EQ(toc_capacity, pack->header->toc_capacity);
+    ASSERT_EQ(image_offset, ST::find_pack_entry(pack, ST::pack_name_hash("test_image_1.png"))->offset);
+    const ST::pack_entry* entry = ST::find_pack_entry(pack, ST::pack_name_hash("test_image_3.webp"));
+    ASSERT_TRUE(entry);
+    EXPECT_EQ("test_image_3.webp", ST::get_pack_entry_name(pack, entry));
+    EXPECT_EQ(get_file_size("test_image_3.webp"), entry->size);
+    EXPECT_EQ(0, entry->offset % ST::pack_alignment);
+    //the new asset is written over the old names table, so no space is left unused
+    EXPECT_EQ((names_offset + ST::pack_alignment - 1) / ST::pack_alignment * ST::pack_alignment, entry->offset);
+    EXPECT_EQ(pack->header->names_offset + std::string("test_image_1.pngtest_sound_1.wavtest_image_3.webp").size(), pack->size);
+    ST::close_pack(pack);
+
+    ST::assets_named* result = ST::unpack_binary(binary_name);
+    ASSERT_TRUE(result);
+    ASSERT_EQ(2, result->surfaces.size());
+    ASSERT_EQ(1, result->chunks.size());
+
+    //Tear Down
+    SDL_FreeSurface(result->surfaces.at("test_image_1.png"));
+    SDL_FreeSurface(result->surfaces.at("test_image_3.webp"));
+    Mix_FreeChunk(result->chunks.at("test_sound_1.wav"));
+    delete result;
+    close_SDL();
+    remove(binary_name.c_str());
+    remove((binary_name + ".manifest").c_str());
+}
+
+/**
+ * Reads the manifest written next to a binary.
+ * @param binary The binary.
+ * @return The lines of the manifest by asset name.
+ */
+static std::map<std::string, std::string> read_manifest_lines(const std::string& binary){
+    std::map<std::string, std::string> lines;
+    std::ifstream manifest(binary + ".manifest");
+    std::string line;
+    while(std::getline(manifest, line)){
+        lines[line.substr(line.rfind(' ') + 1)] = line;
+    }
+    return lines;
+}
+
+/**
+ * Copies the data of an asset out of a pack, as it is stored in it.
+ * @param pack The pack.
+ * @param name The name of the asset.
+ * @return The stored data, empty if the asset is not in the pack.
+ */
+static std::string get_stored_data(const ST::pack* pack, const std::string& name){
+    const ST::pack_entry* entry = ST::find_pack_entry(pack, ST::pack_name_hash(name));
+    if(entry == nullptr){
+        return "";
+    }
+    return {pack->data + entry->offset, entry->size};
+}
+
+TEST(loaders_tests, test_rebuild_binary) {
+
+    //Set up - copies of the test files, so one of them can be changed
+    initialize_SDL();
+    std::string binary_name = "result_binary";
+    copy_file("test_sound_1.wav", "rebuild_sound.wav");
+    copy_file("test_sound_2.wav", "rebuild_changed.wav");
+    ASSERT_EQ(0, ST::pack_to_binary(binary_name, {"rebuild_sound.wav", "rebuild_changed.wav", "test_image_1.png", "test_music_1.ogg"}, 19));
+    ST::pack* pack = ST::open_pack(binary_name);
+    ASSERT_TRUE(pack);
+    std::string unchanged_data = get_stored_data(pack, "rebuild_sound.wav");
+    uint64_t unchanged_offset = ST::find_pack_entry(pack, ST::pack_name_hash("rebuild_sound.wav"))->offset;
+    ST::close_pack(pack);
+    std::map<std::string, std::string> manifest = read_manifest_lines(binary_name);
+    copy_file("test_sound_1.wav", "rebuild_changed.wav");
+
+    //Test - the binary must contain exactly the given files afterwards
+    ASSERT_EQ(0, ST::rebuild_binary(binary_name, {"rebuild_sound.wav", "rebuild_changed.wav", "test_image_3.webp"}, 19));
+    pack = ST::open_pack(binary_name);
+    ASSERT_TRUE(pack);
+    ASSERT_EQ(3, pack->header->entry_count);
+    const ST::pack_entry* entry = ST::find_pack_entry(pack, ST::pack_name_hash("rebuild_changed.wav"));
+    ASSERT_TRUE(entry);
+    EXPECT_EQ(ST::get_pack_compression(ST::asset_file_type::WAV, 19), entry->compression);
+    EXPECT_EQ(get_file_size("test_sound_1.wav"), entry->original_size);
+    EXPECT_TRUE(ST::find_pack_entry(pack, ST::pack_name_hash("test_image_3.webp")));
+    EXPECT_FALSE(ST::find_pack_entry(pack, ST::pack_name_hash("test_image_1.png")));
+
+    //Check result - the unchanged file is copied from the old binary as it was
+    EXPECT_EQ(unchanged_data, get_stored_data(pack, "rebuild_sound.wav"));
+    EXPECT_EQ(unchanged_offset, ST::find_pack_entry(pack, ST::pack_name_hash("rebuild_sound.wav"))->offset);
+    ST::close_pack(pack);
+
+    //Check result - only the changed file gets a new hash in the manifest
+    std::map<std::string, std::string> new_manifest = read_manifest_lines(binary_name);
+    ASSERT_EQ(3, new_manifest.size());
+    EXPECT_EQ(manifest.at("rebuild_sound.wav"), new_manifest.at("rebuild_sound.wav"));
+    EXPECT_NE(manifest.at("rebuild_changed.wav").substr(0, manifest.at("rebuild_changed.wav").find(' ')),
+              new_manifest.at("rebuild_changed.wav").substr(0, new_manifest.at("rebuild_changed.wav").find(' ')));
+    EXPECT_EQ(0, new_manifest.count("test_image_1.png"));
+
+    ST::assets_named* result = ST::unpack_binary(binary_name);
+    ASSERT_TRUE(result);
+    ASSERT_EQ(1, result->surfaces.size());
+    ASSERT_EQ(2, result->chunks.size());
+    ASSERT_EQ(0, result->music.size());
+
+    //Tear Down
+    SDL_FreeSurface(result->surfaces.at("test_image_3.webp"));
+    Mix_FreeChunk(result->chunks.at("rebuild_sound.wav"));
+    Mix_FreeChunk(result->chunks.at("rebuild_changed.wav"));
+    delete result;
+    close_SDL();
+    remove(binary_name.c_str());
+    remove((binary_name + ".manifest").c_str());
+    remove("rebuild_sound.wav");
+    remove("rebuild_changed.wav");
+}
+
+TEST(loaders_tests, test_rebuild_half_written_binary) {
+
+    //Set up - a binary that was being added to when the program stopped
+    initialize_SDL();
+    std::string binary_name = "result_binary";
+    ASSERT_EQ(0, ST::pack_to_binary(binary_name, {"test_image_1.png", "test_sound_1.wav"}, 0));
+    std::fstream binary(binary_name, std::ios::in | std::ios::out | std::ios::binary);
+    binary.write("STPU", 4);
+    binary.close();
+
+    //Test - it must not be read or added to, only written again
+    ASSERT_FALSE(ST::open_pack(binary_name));
+    ASSERT_EQ(-1, ST::add_to_binary(binary_name, {"test_image_3.webp"}));
+    ASSERT_EQ(0, ST::rebuild_binary(binary_name, {"test_image_1.png", "test_sound_1.wav"}));
+    ST::assets_named* result = ST::unpack_binary(binary_name);
+    ASSERT_TRUE(result);
+    ASSERT_EQ(1, result->surfaces.size());
+    ASSERT_EQ(1, result->chunks.size());
+
+    //Tear Down
+    SDL_FreeSurface(result->surfaces.at("test_image_1.png"));
+    Mix_FreeChunk(result->chunks.at("test_sound_1.wav"));
+    delete result;
+    close_SDL();
+    remove(binary_name.c_str());
+    remove((binary_name + ".manifest").c_str());
+}
+
+TEST(loaders_tests, test_pack_assets_with_colliding_ids) {
+
+    //Set up - these two names have the same id in the engine, which gives them different ids at runtime
+    initialize_SDL();
+    std::vector<std::string> filenames = {"test_image_77.png", "test_image_343.png"};
+    for(const auto& filename : filenames){
+        std::ifstream source("test_image_1.png", std::ios::binary);
+        std::ofstream destination(filename, std::ios::binary);
+        destination << source.rdbuf();
+    }
+    std::string binary_name = "result_binary";
+
+    //Test
+    ASSERT_EQ(0, ST::pack_to_binary(binary_name, filenames, 0));
+    ST::assets_named* result = ST::unpack_binary(binary_name);
+    ASSERT_TRUE(result);
+    ASSERT_EQ(2, result->surfaces.size());
+
+    //Tear Down
+    for(const auto& it : result->surfaces){
+        SDL_FreeSurface(it.second);
+    }
+    delete result;
+    close_SDL();
+    for(const auto& filename : filenames){
+        remove(filename.c_str());
+    }
+    remove(binary_name.c_str());
+    remove((binary_name + ".manifest").c_str());
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
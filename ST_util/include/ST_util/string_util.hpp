@@ -11,6 +11,8 @@
 #define ST_STRING_UTIL_HPP
 
 #include <string>
+#include <string_view>
+#include <cstdint>
 
 namespace ST {
 
@@ -20,5 +22,24 @@ namespace ST {
 
     uint16_t hash_string(const std::string &value);
 
+    bool reserve_string_id(const std::string &value);
+
+    /**
+     * FNV-1a hash of a string, folded to 16 bits.
+     * hash_string() gives every string this id unless another string already took it, so names known
+     * at compile time can be turned into ids without calling hash_string(), as long as they are reserved with
+     * reserve_string_id() before any other string is hashed.
+     * @param value The string to hash.
+     * @return The 16 bit hash of the string.
+     */
+    constexpr uint16_t fnv_hash_string(std::string_view value){
+        uint32_t hash = 2166136261U;
+        for(char c : value){
+            hash ^= static_cast<uint8_t>(c);
+            hash *= 16777619U;
+        }
+        return static_cast<uint16_t>((hash >> 16U) ^ (hash & 0xffffU));
+    }
+
 }
 #endif //ST_STRING_UTIL_HPP
@@ -8,7 +8,10 @@
  */
 
 #include <ST_util/string_util.hpp>
-#include <vector>
+#include <ST_util/bytell_hash_map.hpp>
+#include <bitset>
+#include <mutex>
+#include <shared_mutex>
 
 namespace ST {
 
@@ -32,28 +35,47 @@ namespace ST {
     }
 
 
-    static std::vector<size_t> string_hashes;
-    static uint16_t string_hashes_size;
-
-    static std::hash<std::string> hash_f;
+    //every string hashed so far and its id, shared by all threads
+    static ska::bytell_hash_map<std::string, uint16_t> string_ids;
+    static std::bitset<65536> used_ids;
+    static std::shared_mutex string_ids_mutex;
 
     /**
-     * Works by hashing the string using std::hash and saving hashed value in a vector.
+     * Gives each string a unique id, the same for the whole run of the game.
+     * The id is the fnv_hash_string() of the string, unless another string already has it, in which case
+     * the next free id is used. Safe to call from multiple threads.
      * @param value The string to hash.
      * @return a uint16_t hash value for the given string.
      */
     uint16_t hash_string(const std::string &value) {
-        size_t hashed_value = hash_f(value);
-
-        //Now just a simple linear search
-        uint16_t i;
-        for (i = 0; i < string_hashes_size; i++) {
-            if (string_hashes[i] == hashed_value) {
-                return i;
+        {
+            std::shared_lock lock(string_ids_mutex);
+            auto id = string_ids.find(value);
+            if(id != string_ids.end()) [[likely]] {
+                return id->second;
             }
         }
-        string_hashes.emplace_back(hashed_value);
-        ++string_hashes_size;
-        return i;
+        std::unique_lock lock(string_ids_mutex);
+        auto id = string_ids.find(value);
+        if(id != string_ids.end()){
+            return id->second;
+        }
+        uint16_t hashed_value = fnv_hash_string(value);
+        for(uint32_t i = 0; i < used_ids.size() && used_ids[hashed_value]; i++){
+            ++hashed_value;
+        }
+        used_ids[hashed_value] = true;
+        string_ids.emplace(value, hashed_value);
+        return hashed_value;
+    }
+
+    /**
+     * Reserves the id of a string that is used as a compile-time constant (see fnv_hash_string()).
+     * Must be called at startup, before other strings are hashed and can take the id.
+     * @param value The string.
+     * @return True if the string has its fnv_hash_string() as its id, false if another string took it first.
+     */
+    bool reserve_string_id(const std::string &value) {
+        return hash_string(value) == fnv_hash_string(value);
     }
 }
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+#include <ST_util/string_util.hpp>
+#include <future>
+#include <vector>
+
+//test_image_77.png and test_image_343.png have the same FNV hash
+static_assert(ST::fnv_hash_string("test_image_77.png") == ST::fnv_hash_string("test_image_343.png"));
+
+TEST(string_util_tests, hash_string_uses_fnv_hash){
+    ASSERT_EQ(ST::fnv_hash_string("test_string_1"), ST::hash_string("test_string_1"));
+    ASSERT_EQ(ST::fnv_hash_string("test_string_1"), ST::hash_string("test_string_1"));
+}
+
+TEST(string_util_tests, hash_string_collision){
+    uint16_t first = ST::hash_string("test_image_77.png");
+    uint16_t second = ST::hash_string("test_image_343.png");
+
+    ASSERT_EQ(ST::fnv_hash_string("test_image_77.png"), first);
+    ASSERT_NE(first, second);
+    ASSERT_EQ(second, ST::hash_string("test_image_343.png"));
+}
+
+TEST(string_util_tests, reserve_string_id){
+    ASSERT_TRUE(ST::reserve_string_id("test_reserved_string"));
+    ASSERT_TRUE(ST::reserve_string_id("test_reserved_string"));
+    ASSERT_EQ(ST::fnv_hash_string("test_reserved_string"), ST::hash_string("test_reserved_string"));
+}
+
+TEST(string_util_tests, reserve_string_id_taken){
+    //test_image_77.png was hashed first and has the id of test_image_343.png
+    ST::hash_string("test_image_77.png");
+
+    ASSERT_FALSE(ST::reserve_string_id("test_image_343.png"));
+}
+
+TEST(string_util_tests, hash_string_multiple_threads){
+    std::vector<std::future<std::vector<uint16_t>>> results;
+    for(uint8_t i = 0; i < 4; i++){
+        results.emplace_back(std::async(std::launch::async, []{
+            std::vector<uint16_t> ids;
+            for(uint16_t j = 0; j < 1000; j++){
+                ids.emplace_back(ST::hash_string("thread_string_" + std::to_string(j)));
+            }
+            return ids;
+        }));
+    }
+    std::vector<uint16_t> expected = results.at(0).get();
+    for(uint8_t i = 1; i < 4; i++){
+        ASSERT_EQ(expected, results.at(i).get());
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
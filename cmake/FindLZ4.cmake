@@ -0,0 +1,55 @@
+# Locate the LZ4 library
+# This module defines
+# LZ4_LIBRARY, the name of the library to link against
+# LZ4_FOUND, if false, do not try to link to LZ4
+# LZ4_INCLUDE_DIR, where to find lz4.h
+#
+# $LZ4 is an environment variable that can point to the prefix LZ4 was installed to.
+
+FIND_PATH(LZ4_INCLUDE_DIR lz4.h
+HINTS
+${LZ4}
+$ENV{LZ4}
+PATH_SUFFIXES include
+PATHS
+/usr/local/include
+/usr/include
+/sw # Fink
+/opt/local # DarwinPorts
+/opt/csw # Blastwave
+/opt
+)
+
+IF(CMAKE_SIZEOF_VOID_P EQUAL 8)
+FIND_LIBRARY(LZ4_LIBRARY
+NAMES lz4 liblz4
+HINTS
+${LZ4}
+$ENV{LZ4}
+PATH_SUFFIXES lib64 lib
+lib/x64
+PATHS
+/sw
+/opt/local
+/opt/csw
+/opt
+)
+ELSE(CMAKE_SIZEOF_VOID_P EQUAL 8)
+FIND_LIBRARY(LZ4_LIBRARY
+NAMES lz4 liblz4
+HINTS
+${LZ4}
+$ENV{LZ4}
+PATH_SUFFIXES lib
+lib/x86
+PATHS
+/sw
+/opt/local
+/opt/csw
+/opt
+)
+ENDIF(CMAKE_SIZEOF_VOID_P EQUAL 8)
+
+INCLUDE(FindPackageHandleStandardArgs)
+
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(LZ4 REQUIRED_VARS LZ4_LIBRARY LZ4_INCLUDE_DIR)
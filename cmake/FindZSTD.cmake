@@ -0,0 +1,55 @@
+# Locate the ZSTD library
+# This module defines
+# ZSTD_LIBRARY, the name of the library to link against
+# ZSTD_FOUND, if false, do not try to link to ZSTD
+# ZSTD_INCLUDE_DIR, where to find zstd.h
+#
+# $ZSTD is an environment variable that can point to the prefix zstd was installed to.
+
+FIND_PATH(ZSTD_INCLUDE_DIR zstd.h
+HINTS
+${ZSTD}
+$ENV{ZSTD}
+PATH_SUFFIXES include
+PATHS
+/usr/local/include
+/usr/include
+/sw # Fink
+/opt/local # DarwinPorts
+/opt/csw # Blastwave
+/opt
+)
+
+IF(CMAKE_SIZEOF_VOID_P EQUAL 8)
+FIND_LIBRARY(ZSTD_LIBRARY
+NAMES zstd libzstd
+HINTS
+${ZSTD}
+$ENV{ZSTD}
+PATH_SUFFIXES lib64 lib
+lib/x64
+PATHS
+/sw
+/opt/local
+/opt/csw
+/opt
+)
+ELSE(CMAKE_SIZEOF_VOID_P EQUAL 8)
+FIND_LIBRARY(ZSTD_LIBRARY
+NAMES zstd libzstd
+HINTS
+${ZSTD}
+$ENV{ZSTD}
+PATH_SUFFIXES lib
+lib/x86
+PATHS
+/sw
+/opt/local
+/opt/csw
+/opt
+)
+ENDIF(CMAKE_SIZEOF_VOID_P EQUAL 8)
+
+INCLUDE(FindPackageHandleStandardArgs)
+
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(ZSTD REQUIRED_VARS ZSTD_LIBRARY ZSTD_INCLUDE_DIR)